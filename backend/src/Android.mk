@@ -56,6 +56,10 @@ BACKEND_SRC_FILES:= \
     ir/value.hpp \
     ir/lowering.cpp \
     ir/lowering.hpp \
+    ir/licm.cpp \
+    ir/licm.hpp \
+    ir/pipelining.cpp \
+    ir/pipelining.hpp \
     ir/printf.cpp \
     ir/printf.hpp \
     ir/immediate.hpp \
@@ -84,7 +88,9 @@ BACKEND_SRC_FILES:= \
     llvm/StripAttributes.cpp \
     llvm/llvm_device_enqueue.cpp \
     llvm/llvm_to_gen.cpp \
+    llvm/llvm_kernel_fusion.cpp \
     llvm/llvm_loadstore_optimization.cpp \
+    llvm/llvm_int_division.cpp \
     llvm/llvm_gen_backend.hpp \
     llvm/llvm_gen_ocl_function.hxx \
     llvm/llvm_unroll.cpp \
@@ -72,6 +72,9 @@ namespace gbe
     void dumpFreeList();
     /*! the maximum offset */
     int32_t maxOffset;
+    /*! bytes currently allocated and the high water mark of it */
+    int32_t usedSize;
+    int32_t maxUsedSize;
     /*! Head and tail of the free list */
     Block *head;
     Block *tail;
@@ -94,6 +97,7 @@ namespace gbe
   class RegisterAllocator: public SimpleAllocator {
   public:
     RegisterAllocator(int32_t offset, int32_t size): SimpleAllocator(offset, size) {}
+    int32_t getMaxRegUsed() { return maxUsedSize; }
 
     GBE_CLASS(RegisterAllocator);
   };
@@ -113,7 +117,7 @@ namespace gbe
 
   SimpleAllocator::SimpleAllocator(int32_t startOffset,
                                    int32_t size)
-                                  : maxOffset(0) {
+                                  : maxOffset(0), usedSize(0), maxUsedSize(0) {
     tail = head = this->newBlock(startOffset, size);
   }
 
@@ -251,6 +255,8 @@ namespace gbe
       allocatedBlocks.insert(std::make_pair(aligned, size));
       // update max offset
       if(aligned + size > maxOffset) maxOffset = aligned + size;
+      usedSize += size;
+      if(usedSize > maxUsedSize) maxUsedSize = usedSize;
       // We have a valid offset now
       return aligned;
     }
@@ -298,6 +304,7 @@ namespace gbe
 
     // Do not track this allocation anymore
     allocatedBlocks.erase(it);
+    usedSize -= size;
   }
 
   void SimpleAllocator::coalesce(Block *left, Block *right) {
@@ -404,6 +411,10 @@ namespace gbe
 
   void Context::deallocate(int32_t offset) { registerAllocator->deallocate(offset); }
 
+  uint32_t Context::getMaxRegUsed(void) const {
+    return registerAllocator->getMaxRegUsed();
+  }
+
   void Context::splitBlock(int32_t offset, int32_t subOffset) {
     registerAllocator->splitBlock(offset, subOffset);
   }
@@ -503,6 +514,61 @@ namespace gbe
           break;
       }
     }
+    this->buildArgAccess();
+  }
+
+  void Context::buildArgAccess(void) {
+    using namespace ir;
+    set<LabelIndex> loopBlocks;
+    for (auto loop : fn.getLoops())
+      loopBlocks.insert(loop->bbs.begin(), loop->bbs.end());
+
+    // Accesses through a dynamic BTI, a stateless or a generic address may
+    // touch any buffer
+    bool anyBuffer = false;
+    uint32_t constantAccess = 0;
+    map<uint8_t, uint32_t> btiAccess;
+    auto recordAccess = [&](const MemInstruction &insn, uint32_t access) {
+      const AddressSpace space = insn.getAddressSpace();
+      if (space == MEM_CONSTANT)
+        constantAccess |= access;
+      else if (space == MEM_GENERIC)
+        anyBuffer = true;
+      else if (space == MEM_GLOBAL) {
+        if (insn.getAddressMode() == AM_StaticBti)
+          btiAccess[insn.getSurfaceIndex()] |= access;
+        else
+          anyBuffer = true;
+      }
+    };
+    fn.foreachBlock([&](BasicBlock &bb) {
+      const uint32_t reused = loopBlocks.find(bb.getLabelIndex()) != loopBlocks.end() ?
+                              GBE_ARG_ACCESS_REUSED : 0;
+      bb.foreach([&](const Instruction &insn) {
+        const Opcode opcode = insn.getOpcode();
+        if (opcode == OP_LOAD)
+          recordAccess(cast<LoadInstruction>(insn), GBE_ARG_ACCESS_READ | reused);
+        else if (opcode == OP_STORE)
+          recordAccess(cast<StoreInstruction>(insn), GBE_ARG_ACCESS_WRITE | reused);
+        else if (opcode == OP_ATOMIC)
+          recordAccess(cast<AtomicInstruction>(insn),
+                       GBE_ARG_ACCESS_READ | GBE_ARG_ACCESS_WRITE | reused);
+      });
+    });
+
+    const uint32_t unknownAccess = GBE_ARG_ACCESS_READ | GBE_ARG_ACCESS_WRITE | GBE_ARG_ACCESS_REUSED;
+    for (uint32_t argID = 0; argID < kernel->argNum; ++argID) {
+      KernelArgument &arg = kernel->args[argID];
+      if (arg.type == GBE_ARG_GLOBAL_PTR) {
+        auto it = btiAccess.find(arg.bti);
+        arg.access = anyBuffer ? unknownAccess : (it == btiAccess.end() ? 0 : it->second);
+      } else if (arg.type == GBE_ARG_CONSTANT_PTR)
+        arg.access = GBE_ARG_ACCESS_CONSTANT | (constantAccess & ~GBE_ARG_ACCESS_WRITE);
+      else if (arg.type == GBE_ARG_PIPE)
+        arg.access = unknownAccess;
+      else
+        arg.access = 0;
+    }
   }
 
   void Context::buildUsedLabels(void) {
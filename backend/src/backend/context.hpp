@@ -89,6 +89,8 @@ namespace gbe
     bool isSuperRegisterFree(int offset);
     /*! Deallocate previously allocated memory */
     void deallocate(int32_t offset);
+    /*! Peak number of bytes allocated in the register file */
+    uint32_t getMaxRegUsed(void) const;
     /*! Spilt a block into 2 blocks, for some registers allocate together but  deallocate seperate */
     void splitBlock(int32_t offset, int32_t subOffset);
     /*! allocate size scratch memory and return start address */
@@ -133,6 +135,8 @@ namespace gbe
     void buildStack(void);
     /*! Build the list of arguments to set to launch the kernel */
     void buildArgList(void);
+    /*! Record how the kernel accesses its buffer arguments */
+    void buildArgAccess(void);
     /*! Build the sets of used labels */
     void buildUsedLabels(void);
     /*! Build JIPs for each branch and possibly labels. Can be different from
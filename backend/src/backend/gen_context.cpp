@@ -3682,6 +3682,7 @@ namespace gbe
     genKernel->insnNum = p->store.size();
     genKernel->insns = GBE_NEW_ARRAY_NO_ARG(GenInstruction, genKernel->insnNum);
     std::memcpy(genKernel->insns, &p->store[0], genKernel->insnNum * sizeof(GenInstruction));
+    this->gatherStatistics(genKernel);
     if (OCL_OUTPUT_ASM)
       outputAssembly(stdout, genKernel);
 
@@ -3699,6 +3700,34 @@ namespace gbe
     return true;
   }
 
+  void GenContext::gatherStatistics(GenKernel *genKernel) {
+    KernelStatistics &stats = genKernel->stats;
+    stats = KernelStatistics();
+    for (auto &block : *sel->blockList)
+    for (auto &insn : block.insnList) {
+      if (insn.opcode == SEL_OP_SPILL_REG)
+        stats.spillNum++;
+      else if (insn.opcode == SEL_OP_UNSPILL_REG)
+        stats.unspillNum++;
+    }
+    // Walk the final stream, a native instruction takes two slots
+    for (uint32_t insnID = 0; insnID < genKernel->insnNum; ) {
+      GenCompactInstruction *pCom = (GenCompactInstruction*)&genKernel->insns[insnID];
+      stats.insnNum++;
+      if (pCom->bits1.cmpt_control == 1) {
+        insnID++;
+        continue;
+      }
+      const uint32_t opcode = ((GenNativeInstruction*)pCom)->header.opcode;
+      if (opcode == GEN_OPCODE_SEND || opcode == GEN_OPCODE_SENDC || opcode == GEN_OPCODE_SENDS)
+        stats.sendNum++;
+      insnID += 2;
+    }
+    stats.regUsed = this->getMaxRegUsed();
+    stats.flagSpillNum = ra->getFlagSpillNum();
+    stats.flagFixupNum = ra->getFlagFixupNum();
+  }
+
   Kernel *GenContext::allocateKernel(void) {
     return GBE_NEW(GenKernel, name, deviceID);
   }
@@ -256,6 +256,8 @@ namespace gbe
     void buildPatchList(void);
     /* Helper for printing the assembly */
     void outputAssembly(FILE *file, GenKernel* genKernel);
+    /*! Record the static resource usage of the emitted code */
+    void gatherStatistics(GenKernel* genKernel);
     /*! Calc the group's slm offset from R0.0, to work around HSW SLM bug*/
     virtual void emitSLMOffset(void) { };
     /*! new selection of device */
@@ -165,6 +165,8 @@ namespace gbe
     void clear(bool fullClear = false);
     /*! Get an index in the node array for the given register */
     uint32_t getIndex(GenRegister reg) const;
+    /*! Number of consecutive GRF indices the register covers after allocation */
+    uint32_t getGRFNum(const SelectionInstruction &insn, GenRegister reg) const;
     /*! Get an index in the node array for the given memory system */
     uint32_t getMemoryIndex() const;
     /*! Add a new dependency "node0 depends on node1" */
@@ -254,9 +256,7 @@ namespace gbe
       this->grfNum = selection.getRegNum();
       nodes.resize(grfNum + MAX_ARF_REGISTER + MAX_MEM_SYSTEM);
     } else {
-      const uint32_t simdWidth = scheduler.ctx.getSimdWidth();
-      GBE_ASSERT(simdWidth == 8 || simdWidth == 16);
-      this->grfNum = simdWidth == 8 ? 128 : 64;
+      this->grfNum = 128;
       nodes.resize(grfNum + MAX_ARF_REGISTER + MAX_MEM_SYSTEM);
     }
     insnNodes.resize(selection.getLargestBlockSize());
@@ -266,18 +266,18 @@ namespace gbe
   void DependencyTracker::addDependency(ScheduleDAGNode *node0, GenRegister reg, DepMode m) {
     if (this->ignoreDependency(reg) == false) {
       const uint32_t index = this->getIndex(reg);
-      this->addDependency(node0, index, m);
-      if (scheduler.policy == POST_ALLOC && (reg.isdf() || reg.isint64() || reg.is_unpacked_long()))
-        this->addDependency(node0, index + 1, m);
+      const uint32_t num = this->getGRFNum(node0->insn, reg);
+      for (uint32_t i = 0; i < num; ++i)
+        this->addDependency(node0, index + i, m);
     }
   }
 
   void DependencyTracker::addDependency(GenRegister reg, ScheduleDAGNode *node0, DepMode m) {
     if (this->ignoreDependency(reg) == false) {
       const uint32_t index = this->getIndex(reg);
-      this->addDependency(index, node0, m);
-      if (scheduler.policy == POST_ALLOC && (reg.isdf() || reg.isint64() || reg.is_unpacked_long()))
-        this->addDependency(index + 1, node0, m);
+      const uint32_t num = this->getGRFNum(node0->insn, reg);
+      for (uint32_t i = 0; i < num; ++i)
+        this->addDependency(index + i, node0, m);
     }
   }
 
@@ -352,22 +352,40 @@ namespace gbe
           NOT_SUPPORTED;
           return 0;
         }
-      } else {
-          const uint32_t simdWidth = scheduler.ctx.getSimdWidth();
-          return simdWidth == 8 ? reg.nr : reg.nr / 2;
-      }
+      } else
+        return reg.nr;
     }
     // We directly manipulate physical GRFs here
-    else if (scheduler.policy == POST_ALLOC) {
-      const GenRegister physical = scheduler.ctx.ra->genReg(reg);
-      const uint32_t simdWidth = scheduler.ctx.getSimdWidth();
-      return simdWidth == 8 ? physical.nr : physical.nr / 2;
-    }
+    else if (scheduler.policy == POST_ALLOC)
+      return scheduler.ctx.ra->genReg(reg).nr;
     // We use virtual registers since allocation is not done yet
     else
       return reg.value.reg;
   }
 
+  uint32_t DependencyTracker::getGRFNum(const SelectionInstruction &insn, GenRegister reg) const {
+    if (scheduler.policy == PRE_ALLOC || reg.file != GEN_GENERAL_REGISTER_FILE)
+      return 1;
+    // GRFs are tracked one by one, so registers do not need any alignment
+    // beyond a GRF. A register may span several of them (SIMD16, 64 bits...)
+    uint32_t subnr, size;
+    if (reg.physical) {
+      const bool scalar = reg.hstride == GEN_HORIZONTAL_STRIDE_0 &&
+                          reg.vstride == GEN_VERTICAL_STRIDE_0;
+      const uint32_t stride = reg.hstride == GEN_HORIZONTAL_STRIDE_0 ? 1 : 1 << (reg.hstride - 1);
+      subnr = reg.subnr;
+      size = (scalar ? 1 : insn.state.execWidth) * stride * typeSize(reg.type);
+    } else {
+      // The instruction may only touch a part of the virtual register (like
+      // one half of a 64 bit value), be conservative and take all of it
+      subnr = scheduler.ctx.ra->genReg(reg).subnr;
+      size = scheduler.ctx.ra->getRegSize(reg.reg());
+    }
+    const uint32_t index = this->getIndex(reg);
+    const uint32_t num = (subnr + size + GEN_REG_SIZE - 1) / GEN_REG_SIZE;
+    return std::max(1u, std::min(num, grfNum - std::min(index, grfNum)));
+  }
+
   uint32_t DependencyTracker::getMemoryIndex() const {
     const uint32_t memDelta = grfNum + MAX_ARF_REGISTER;
     return memDelta;
@@ -381,9 +399,9 @@ namespace gbe
       const GenRegister dst = insn.dst(dstID);
       if (this->ignoreDependency(dst) == false) {
         const uint32_t index = this->getIndex(dst);
-        this->nodes[index] = node;
-        if (scheduler.policy == POST_ALLOC && (dst.isdf() || dst.isint64() || dst.is_unpacked_long()))
-          this->nodes[index + 1] = node;
+        const uint32_t num = this->getGRFNum(insn, dst);
+        for (uint32_t i = 0; i < num; ++i)
+          this->nodes[index + i] = node;
       }
     }
 
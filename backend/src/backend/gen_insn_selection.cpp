@@ -465,6 +465,8 @@ namespace gbe
     }
 
     GenRegister getLaneIDReg();
+    /*! The required work group size fits in one hardware thread */
+    bool isSingleThreadWorkGroup(void) const;
     /*! Implement public class */
     INLINE uint32_t getRegNum(void) const { return file.regNum(); }
     /*! Implements public interface */
@@ -516,6 +518,8 @@ namespace gbe
     bool hasQWord(const ir::Instruction &insn);
     /*! A root instruction needs to be generated */
     bool isRoot(const ir::Instruction &insn) const;
+    /*! Estimate the peak size in bytes of the registers live in the block */
+    uint32_t estimateRegPressure(const ir::BasicBlock &bb) const;
     /*! Set debug infomation to Selection */
     void setDBGInfo_SEL(DebugInfo in) { DBGInfo = in; }
 
@@ -537,6 +541,8 @@ namespace gbe
     intrusive_list<SelectionBlock> blockList;
     /*! Currently processed block */
     SelectionBlock *block;
+    /*! The live registers of the current block almost fill the GRF */
+    bool highRegPressure;
     /*! Current instruction state to use */
     GenInstructionState curr;
     /*! We append new registers so we duplicate the function register file */
@@ -918,6 +924,7 @@ namespace gbe
     this->regNum = fn.regNum();
     this->regDAG.resize(regNum);
     this->insnDAG.resize(maxInsnNum);
+    this->highRegPressure = false;
   }
 
   Selection::Opaque::~Opaque(void) {
@@ -1292,6 +1299,17 @@ namespace gbe
     insn->dst(0) = dst;
   }
 
+  BVAR(OCL_SINGLE_THREAD_WORKGROUP, true);
+  bool Selection::Opaque::isSingleThreadWorkGroup(void) const {
+    if (!OCL_SINGLE_THREAD_WORKGROUP)
+      return false;
+    // Only known with reqd_work_group_size, the runtime rejects any other
+    // local size for the kernel
+    const size_t *wgSize = ctx.getFunction().getCompileWorkGroupSize();
+    const size_t itemNum = wgSize[0] * wgSize[1] * wgSize[2];
+    return itemNum != 0 && itemNum <= ctx.getSimdWidth();
+  }
+
   int Selection::Opaque::JMPI(Reg src, ir::LabelIndex index, ir::LabelIndex origin) {
     SelectionInstruction *insn = this->appendInsn(SEL_OP_JMPI, 0, 1);
     insn->src(0) = src;
@@ -2506,6 +2524,48 @@ namespace gbe
     return false;
   }
 
+  uint32_t Selection::Opaque::estimateRegPressure(const ir::BasicBlock &bb) const {
+    using namespace ir;
+    const uint32_t simdWidth = ctx.getSimdWidth();
+    auto regSize = [&](Register reg) -> uint32_t {
+      const RegisterData &regData = getRegisterData(reg);
+      uint32_t size;
+      if (regData.family == FAMILY_BOOL)
+        size = 2;
+      else if (regData.family > FAMILY_QWORD)
+        size = GEN_REG_SIZE;
+      else
+        size = getFamilySize(regData.family);
+      return regData.isUniform() ? size : size * simdWidth;
+    };
+
+    // Walk the block backward from its live out registers
+    set<Register> live(ctx.getLiveOut(&bb).begin(), ctx.getLiveOut(&bb).end());
+    vector<const Instruction*> insns;
+    const_cast<BasicBlock&>(bb).foreach([&](const Instruction &insn) {
+      insns.push_back(&insn);
+    });
+    uint32_t curr = 0;
+    for (auto reg : live)
+      curr += regSize(reg);
+    uint32_t peak = curr;
+    for (auto it = insns.rbegin(); it != insns.rend(); ++it) {
+      const Instruction &insn = **it;
+      for (uint32_t dstID = 0; dstID < insn.getDstNum(); ++dstID) {
+        const Register reg = insn.getDst(dstID);
+        if (live.erase(reg))
+          curr -= regSize(reg);
+      }
+      for (uint32_t srcID = 0; srcID < insn.getSrcNum(); ++srcID) {
+        const Register reg = insn.getSrc(srcID);
+        if (live.insert(reg).second)
+          curr += regSize(reg);
+      }
+      peak = std::max(peak, curr);
+    }
+    return peak;
+  }
+
   bool Selection::Opaque::hasQWord(const ir::Instruction &insn) {
     for (uint32_t i = 0; i < insn.getSrcNum(); i++) {
       const ir::Register reg = insn.getSrc(i);
@@ -2670,6 +2730,11 @@ extern bool OCL_DEBUGINFO; // first defined by calling BVAR in program.cpp
     fn.foreachBlock([&](const BasicBlock &bb) {
       this->dagPool.rewind();
       this->appendBlock(bb);
+      // Use 3/4 of the GRF (1/2 when retrying to avoid spills) as the limit
+      // above which the patterns must not extend the live ranges
+      const uint32_t grfSize = (128 - ctx.reservedSpillRegs) * GEN_REG_SIZE;
+      const uint32_t pressureLimit = ctx.limitRegisterPressure ? grfSize / 2 : grfSize * 3 / 4;
+      this->highRegPressure = this->estimateRegPressure(bb) > pressureLimit;
       const uint32_t insnNum = this->buildBasicBlockDAG(bb);
       this->matchBasicBlock(bb, insnNum);
     });
@@ -3693,15 +3758,9 @@ extern bool OCL_DEBUGINFO; // first defined by calling BVAR in program.cpp
     {
       using namespace ir;
 
-      // XXX TODO: we need a clean support of FP_CONTRACT to remove below line 'return false'
-      // if 'pragma FP_CONTRACT OFF' is used in cl kernel, we should not do mad optimization.
-      if (!sel.ctx.relaxMath)
-        return false;
       // MAD tend to increase liveness of the sources (since there are three of
-      // them). TODO refine this strategy. Well, we should be able at least to
-      // evaluate per basic block register pressure and selectively enable
-      // disable MADs
-       if (sel.ctx.limitRegisterPressure)
+      // them). Do not make it worse in the blocks which may already spill
+      if (sel.highRegPressure)
         return false;
 
       // We are good to try. We need a MUL for one of the two sources
@@ -3710,8 +3769,16 @@ extern bool OCL_DEBUGINFO; // first defined by calling BVAR in program.cpp
         return false;
       SelectionDAG *child0 = dag.child[0];
       SelectionDAG *child1 = dag.child[1];
+      // Fusing changes the rounding, it needs -cl-fast-relaxed-math or the
+      // FP_CONTRACT permission on both the MUL and the ADD
+      auto canContract = [&](const SelectionDAG *child) {
+        return sel.ctx.relaxMath ||
+               (insn.allowContract() && cast<ir::BinaryInstruction>(child->insn).allowContract());
+      };
+      const bool mad0 = child0 && child0->insn.getOpcode() == OP_MUL && canContract(child0);
+      const bool mad1 = child1 && child1->insn.getOpcode() == OP_MUL && canContract(child1);
       const GenRegister dst = sel.selReg(insn.getDst(0), TYPE_FLOAT);
-      if (child0 && child0->insn.getOpcode() == OP_MUL) {
+      if (mad0) {
         GBE_ASSERT(cast<ir::BinaryInstruction>(child0->insn).getType() == TYPE_FLOAT);
         const GenRegister src0 = sel.selReg(child0->insn.getSrc(0), TYPE_FLOAT);
         const GenRegister src1 = sel.selReg(child0->insn.getSrc(1), TYPE_FLOAT);
@@ -3727,7 +3794,7 @@ extern bool OCL_DEBUGINFO; // first defined by calling BVAR in program.cpp
         if (child1) child1->isRoot = 1;
         return true;
       }
-      if (child1 && child1->insn.getOpcode() == OP_MUL) {
+      if (mad1) {
         GBE_ASSERT(cast<ir::BinaryInstruction>(child1->insn).getType() == TYPE_FLOAT);
         GenRegister src0 = sel.selReg(child1->insn.getSrc(0), TYPE_FLOAT);
         const GenRegister src1 = sel.selReg(child1->insn.getSrc(1), TYPE_FLOAT);
@@ -4155,6 +4222,14 @@ extern bool OCL_DEBUGINFO; // first defined by calling BVAR in program.cpp
       const ir::Register reg = sel.reg(FAMILY_DWORD);
       const uint32_t params = insn.getParameters();
 
+      // The lanes of one thread already see their SLM accesses in order, only
+      // the global fence and the sampler cache flush of images are left
+      if (sel.isSingleThreadWorkGroup() && !(params & SYNC_IMAGE_FENCE)) {
+        if (params & (SYNC_GLOBAL_READ_FENCE | SYNC_GLOBAL_WRITE_FENCE))
+          sel.FENCE(sel.selReg(sel.reg(FAMILY_DWORD)));
+        return true;
+      }
+
       // A barrier is OK to start the thread synchronization *and* SLM fence
       sel.BARRIER(GenRegister::ud8grf(reg), sel.selReg(sel.reg(FAMILY_DWORD)), params);
       return true;
@@ -7890,15 +7965,79 @@ extern bool OCL_DEBUGINFO; // first defined by calling BVAR in program.cpp
     }
 
 
+    /* The work group is one thread: the lanes are the work items in the
+     * order of their local linear ID, the sub group algorithms do the job
+     * without SLM nor barrier */
+    INLINE bool emitInThreadReduce(Selection::Opaque &sel, const ir::WorkGroupInstruction &insn) const
+    {
+      using namespace ir;
+
+      GBE_ASSERT(insn.getSrcNum() == 3);
+
+      const WorkGroupOps workGroupOp = insn.getWorkGroupOpcode();
+      const Type type = insn.getType();
+      GenRegister dst = sel.selReg(insn.getDst(0), type);
+      GenRegister src = sel.selReg(insn.getSrc(2), type);
+      GenRegister tmpData1 = GenRegister::retype(sel.selReg(sel.reg(FAMILY_QWORD)), type);
+      GenRegister tmpData2 = GenRegister::retype(sel.selReg(sel.reg(FAMILY_QWORD)), type);
+
+      sel.SUBGROUP_OP(workGroupOp, dst, src, tmpData1, tmpData2);
+      return true;
+    }
+
+    INLINE bool emitInThreadBroadcast(Selection::Opaque &sel, const ir::WorkGroupInstruction &insn) const
+    {
+      using namespace ir;
+
+      const uint32_t srcNum = insn.getSrcNum();
+      GBE_ASSERT(srcNum >= 2);
+
+      const Type type = insn.getType();
+      const GenRegister src = sel.selReg(insn.getSrc(0), type);
+      const GenRegister dst = sel.selReg(insn.getDst(0), type);
+      const size_t *wgSize = sel.ctx.getFunction().getCompileWorkGroupSize();
+
+      // Every lane holds the value already
+      if (sel.isScalarReg(insn.getSrc(0))) {
+        sel.push();
+        if (sel.isScalarReg(insn.getDst(0))) {
+          sel.curr.execWidth = 1;
+          sel.curr.predicate = GEN_PREDICATE_NONE;
+          sel.curr.noMask = 1;
+        }
+        sel.MOV(dst, src);
+        sel.pop();
+        return true;
+      }
+
+      // lane = x + wg0 * (y + wg1 * z)
+      GenRegister lane = sel.selReg(sel.reg(FAMILY_DWORD), TYPE_U32);
+      sel.MOV(lane, sel.selReg(insn.getSrc(srcNum - 1), TYPE_U32));
+      for (int32_t dim = srcNum - 3; dim >= 0; --dim) {
+        sel.MUL(lane, lane, GenRegister::immuw(wgSize[dim]));
+        sel.ADD(lane, lane, sel.selReg(insn.getSrc(dim + 1), TYPE_U32));
+      }
+
+      const uint32_t SHLimm = typeSize(getGenType(type)) == 2 ? 1 : (typeSize(getGenType(type)) == 4 ? 2 : 3);
+      sel.SHL(lane, lane, GenRegister::immud(SHLimm));
+      sel.SIMD_SHUFFLE(dst, src, lane);
+      return true;
+    }
+
     INLINE bool emitOne(Selection::Opaque &sel, const ir::WorkGroupInstruction &insn, bool &markChildren) const
     {
       using namespace ir;
       const WorkGroupOps workGroupOp = insn.getWorkGroupOpcode();
+      const bool inThread = sel.isSingleThreadWorkGroup();
 
       if (workGroupOp == WORKGROUP_OP_BROADCAST){
+        if (inThread)
+          return emitInThreadBroadcast(sel, insn);
         return emitWGBroadcast(sel, insn);
       }
       else if (workGroupOp >= WORKGROUP_OP_ANY && workGroupOp <= WORKGROUP_OP_EXCLUSIVE_MAX){
+        if (inThread)
+          return emitInThreadReduce(sel, insn);
         return emitWGReduce(sel, insn);
       }
       else
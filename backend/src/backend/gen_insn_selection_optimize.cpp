@@ -642,6 +642,468 @@ namespace gbe
 
   }
 
+  BVAR(OCL_SEL_PEEPHOLE_SRCMOD, true);
+  BVAR(OCL_SEL_PEEPHOLE_SATURATE, true);
+  BVAR(OCL_SEL_PEEPHOLE_FLAG, true);
+  BVAR(OCL_SEL_PEEPHOLE_DCE, true);
+
+  /*! Peephole rules on the selection instructions of a basic block. Each rule
+   *  has its own switch:
+   *  - OCL_SEL_PEEPHOLE_SRCMOD folds a MOV applying a negate or abs into the
+   *    source of the instruction using it
+   *  - OCL_SEL_PEEPHOLE_SATURATE turns a clamp to [0, 1] into a saturated MOV
+   *    and folds a saturated MOV into the instruction computing its source
+   *  - OCL_SEL_PEEPHOLE_FLAG drops a CMP computing the flag again, and turns a
+   *    SEL keeping its destination into a predicated MOV
+   *  - OCL_SEL_PEEPHOLE_DCE removes the instructions whose results are unused
+   *  The MOVs building message payloads are left alone, they copy half
+   *  registers or convert the type, which the source instruction cannot do
+   */
+  class SelPeepholeOptimizer : public SelOptimizer
+  {
+  public:
+    SelPeepholeOptimizer(const GenContext& ctx,
+                         const ir::Liveness::LiveOut& liveout,
+                         uint32_t features,
+                         SelectionBlock &bb) :
+        SelOptimizer(ctx, features), bb(bb), liveout(liveout) {}
+    ~SelPeepholeOptimizer() {}
+    virtual void run();
+
+  private:
+    typedef intrusive_list<SelectionInstruction>::iterator InsnIterator;
+
+    void countUses();
+    bool isLocalTemp(const GenRegister &reg) const;
+    SelectionInstruction *findUse(SelectionInstruction &def, uint32_t &srcID,
+                                  const GenRegister *keep0, const GenRegister *keep1);
+    bool foldSourceModifier(SelectionInstruction &insn);
+    bool foldClamp(SelectionInstruction &insn);
+    bool foldSaturate(SelectionInstruction &insn);
+    bool reuseFlag(SelectionInstruction &insn);
+    bool selectToMov(SelectionInstruction &insn);
+    bool eliminateDeadInstructions();
+
+    SelectionBlock &bb;
+    const ir::Liveness::LiveOut& liveout;
+    map<ir::Register, uint32_t> useCount;
+    static const size_t MaxTries = 4;   //the max times of optimization try
+  };
+
+  /*! Virtual GRF which the peephole rules may rewrite */
+  static bool isVirtualGRF(const GenRegister &reg)
+  {
+    return reg.file == GEN_GENERAL_REGISTER_FILE && reg.physical == 0 &&
+           reg.address_mode == GEN_ADDRESS_DIRECT &&
+           reg.value.reg >= ir::ocl::regNum;
+  }
+
+  /*! use reads exactly the elements written through def */
+  static bool sameElements(const GenRegister &def, const GenRegister &use, uint32_t execWidth)
+  {
+    if (!isVirtualGRF(def) || !isVirtualGRF(use))
+      return false;
+    if (def.reg() != use.reg() || def.type != use.type || def.nr != use.nr ||
+        def.subnr != use.subnr || def.quarter != use.quarter)
+      return false;
+    if (GenRegister::vstride_size(def) != GenRegister::width_size(def) * GenRegister::hstride_size(def) ||
+        GenRegister::vstride_size(use) != GenRegister::width_size(use) * GenRegister::hstride_size(use))
+      return false;
+    return CalculateElements(def, execWidth) == CalculateElements(use, execWidth);
+  }
+
+  static bool sameOperand(const GenRegister &a, const GenRegister &b)
+  {
+    if (a.file != b.file || a.type != b.type || a.physical != b.physical ||
+        a.subphysical != b.subphysical || a.nr != b.nr || a.subnr != b.subnr ||
+        a.negation != b.negation || a.absolute != b.absolute ||
+        a.vstride != b.vstride || a.width != b.width || a.hstride != b.hstride ||
+        a.quarter != b.quarter || a.address_mode != b.address_mode ||
+        a.a0_subnr != b.a0_subnr || a.addr_imm != b.addr_imm)
+      return false;
+    if (a.file == GEN_IMMEDIATE_VALUE && typeSize(a.type) == 8)
+      return a.value.u64 == b.value.u64;
+    return a.value.ud == b.value.ud;
+  }
+
+  /*! Both instructions run on the same channels */
+  static bool sameChannels(const SelectionInstruction &a, const SelectionInstruction &b)
+  {
+    return a.state.execWidth == b.state.execWidth &&
+           a.state.quarterControl == b.state.quarterControl &&
+           a.state.nibControl == b.state.nibControl &&
+           a.state.noMask == b.state.noMask;
+  }
+
+  static bool writesReg(const SelectionInstruction &insn, ir::Register reg)
+  {
+    for (uint32_t i = 0; i < insn.dstNum; ++i)
+      if (insn.dst(i).reg() == reg && insn.dst(i).file == GEN_GENERAL_REGISTER_FILE)
+        return true;
+    return false;
+  }
+
+  static bool readsReg(const SelectionInstruction &insn, ir::Register reg)
+  {
+    for (uint32_t i = 0; i < insn.srcNum; ++i)
+      if (insn.src(i).reg() == reg && insn.src(i).file == GEN_GENERAL_REGISTER_FILE)
+        return true;
+    return false;
+  }
+
+  /*! A virtual flag is a boolean register, the predicate reads it too */
+  static bool usesVirtualFlag(const SelectionInstruction &insn)
+  {
+    return !insn.state.physicalFlag &&
+           (insn.state.predicate != GEN_PREDICATE_NONE || insn.state.modFlag ||
+            insn.opcode == SEL_OP_CMP || insn.opcode == SEL_OP_SEL_CMP);
+  }
+
+  /*! Plain ALU instruction, without side effect other than its destinations */
+  static bool isPureALU(const SelectionInstruction &insn)
+  {
+    switch (insn.opcode) {
+      case SEL_OP_MOV: case SEL_OP_NOT: case SEL_OP_LZD: case SEL_OP_FRC:
+      case SEL_OP_RNDZ: case SEL_OP_RNDE: case SEL_OP_RNDD: case SEL_OP_RNDU:
+      case SEL_OP_SEL: case SEL_OP_AND: case SEL_OP_OR: case SEL_OP_XOR:
+      case SEL_OP_SHR: case SEL_OP_SHL: case SEL_OP_ASR: case SEL_OP_ADD:
+      case SEL_OP_MUL: case SEL_OP_MAD: case SEL_OP_LRP: case SEL_OP_MATH:
+      case SEL_OP_CBIT: case SEL_OP_FBH: case SEL_OP_FBL: case SEL_OP_BFREV:
+      case SEL_OP_SEL_CMP:
+        break;
+      default:
+        return false;
+    }
+    return insn.dstNum >= 1 && !insn.state.modFlag && !insn.state.accWrEnable &&
+           !insn.state.flagGen;
+  }
+
+  /*! The source of these instructions can take a negate or abs modifier */
+  static bool supportSourceModifier(const SelectionInstruction &insn)
+  {
+    switch (insn.opcode) {
+      case SEL_OP_MOV: case SEL_OP_ADD: case SEL_OP_MUL: case SEL_OP_MAD:
+      case SEL_OP_SEL: case SEL_OP_SEL_CMP: case SEL_OP_CMP: case SEL_OP_FRC:
+      case SEL_OP_RNDZ: case SEL_OP_RNDE: case SEL_OP_RNDD: case SEL_OP_RNDU:
+        return true;
+      case SEL_OP_MATH:
+        return insn.extra.function != GEN_MATH_FUNCTION_INT_DIV_QUOTIENT &&
+               insn.extra.function != GEN_MATH_FUNCTION_INT_DIV_REMAINDER &&
+               insn.extra.function != GEN_MATH_FUNCTION_INT_DIV_QUOTIENT_AND_REMAINDER;
+      default:
+        return false;
+    }
+  }
+
+  void SelPeepholeOptimizer::countUses()
+  {
+    useCount.clear();
+    for (SelectionInstruction &insn : bb.insnList) {
+      for (uint32_t i = 0; i < insn.srcNum; ++i)
+        if (insn.src(i).file == GEN_GENERAL_REGISTER_FILE)
+          useCount[insn.src(i).reg()]++;
+      if (usesVirtualFlag(insn))
+        useCount[ir::Register(insn.state.flagIndex)]++;
+    }
+  }
+
+  /*! Only used once in this block */
+  bool SelPeepholeOptimizer::isLocalTemp(const GenRegister &reg) const
+  {
+    if (!isVirtualGRF(reg) || liveout.find(reg.reg()) != liveout.end())
+      return false;
+    auto it = useCount.find(reg.reg());
+    return it != useCount.end() && it->second == 1;
+  }
+
+  /*! Find the instruction reading the destination of def. keep0 and keep1
+   *  are registers which must not be written in between */
+  SelectionInstruction *SelPeepholeOptimizer::findUse(SelectionInstruction &def, uint32_t &srcID,
+                                                      const GenRegister *keep0, const GenRegister *keep1)
+  {
+    const ir::Register reg = def.dst(0).reg();
+    InsnIterator it(&def);
+    for (++it; it != bb.insnList.end(); ++it) {
+      SelectionInstruction &insn = *it;
+      for (uint32_t i = 0; i < insn.srcNum; ++i) {
+        if (insn.src(i).file == GEN_GENERAL_REGISTER_FILE && insn.src(i).reg() == reg) {
+          srcID = i;
+          return &insn;
+        }
+      }
+      if (writesReg(insn, reg))
+        return NULL;
+      if (keep0 && writesReg(insn, keep0->reg()))
+        return NULL;
+      if (keep1 && writesReg(insn, keep1->reg()))
+        return NULL;
+    }
+    return NULL;
+  }
+
+  /* mov t, -x
+     add d, t, y   ===>  add d, -x, y */
+  bool SelPeepholeOptimizer::foldSourceModifier(SelectionInstruction &insn)
+  {
+    if (insn.opcode != SEL_OP_MOV || insn.srcNum != 1 || insn.dstNum != 1)
+      return false;
+    const GenRegister &src = insn.src(0);
+    const GenRegister &dst = insn.dst(0);
+    if (!src.negation && !src.absolute)
+      return false;
+    if (src.file != GEN_GENERAL_REGISTER_FILE || src.type != dst.type ||
+        (dst.type != GEN_TYPE_F && dst.type != GEN_TYPE_D))
+      return false;
+    if (insn.state.saturate != GEN_MATH_SATURATE_NONE ||
+        insn.state.predicate != GEN_PREDICATE_NONE || !isPureALU(insn))
+      return false;
+    if (!isLocalTemp(dst))
+      return false;
+
+    uint32_t srcID;
+    SelectionInstruction *use = findUse(insn, srcID, &src, NULL);
+    if (use == NULL || !supportSourceModifier(*use) || use->isRead() || use->isWrite())
+      return false;
+    if (!sameChannels(insn, *use) || !sameElements(dst, use->src(srcID), insn.state.execWidth))
+      return false;
+
+    // Gen applies abs before negate: abs hides the inner negate
+    GenRegister &useSrc = use->src(srcID);
+    const uint32_t negation = useSrc.absolute ? useSrc.negation : useSrc.negation ^ src.negation;
+    const uint32_t absolute = useSrc.absolute | src.absolute;
+    GenRegister::propagateRegister(useSrc, src);
+    useSrc.negation = negation;
+    useSrc.absolute = absolute;
+    bb.insnList.erase(&insn);
+    return true;
+  }
+
+  /* sel_cmp.ge t, x, 0.0f
+     sel_cmp.l  d, t, 1.0f  ===>  mov.sat d, x
+     A NaN gives 0 in both cases, the opposite order would give 1. */
+  bool SelPeepholeOptimizer::foldClamp(SelectionInstruction &insn)
+  {
+    if (insn.opcode != SEL_OP_SEL_CMP || insn.dst(0).type != GEN_TYPE_F)
+      return false;
+    if (insn.extra.function != GEN_CONDITIONAL_GE && insn.extra.function != GEN_CONDITIONAL_G)
+      return false;
+    const GenRegister &x = insn.src(0);
+    const GenRegister &zero = insn.src(1);
+    if (zero.file != GEN_IMMEDIATE_VALUE || zero.type != GEN_TYPE_F || zero.value.f != 0.0f ||
+        zero.negation || zero.absolute || x.type != GEN_TYPE_F)
+      return false;
+    if (insn.state.predicate != GEN_PREDICATE_NONE || insn.state.saturate ||
+        !isPureALU(insn) || !isLocalTemp(insn.dst(0)))
+      return false;
+
+    uint32_t srcID;
+    SelectionInstruction *use = findUse(insn, srcID, &x, NULL);
+    if (use == NULL || use->opcode != SEL_OP_SEL_CMP || srcID != 0 ||
+        use->state.saturate || !isPureALU(*use))
+      return false;
+    if (use->extra.function != GEN_CONDITIONAL_L && use->extra.function != GEN_CONDITIONAL_LE)
+      return false;
+    const GenRegister &one = use->src(1);
+    if (one.file != GEN_IMMEDIATE_VALUE || one.type != GEN_TYPE_F || one.value.f != 1.0f ||
+        one.negation || one.absolute || use->dst(0).type != GEN_TYPE_F)
+      return false;
+    if (use->src(0).negation || use->src(0).absolute)
+      return false;
+    if (use->state.predicate != GEN_PREDICATE_NONE || !sameChannels(insn, *use) ||
+        !sameElements(insn.dst(0), use->src(0), insn.state.execWidth))
+      return false;
+
+    use->opcode = SEL_OP_MOV;
+    use->srcNum = 1;
+    use->src(0) = x;
+    use->extra.function = 0;
+    use->state.saturate = GEN_MATH_SATURATE_SATURATE;
+    bb.insnList.erase(&insn);
+    return true;
+  }
+
+  /* add t, x, y
+     mov.sat d, t   ===>  add.sat d, x, y */
+  bool SelPeepholeOptimizer::foldSaturate(SelectionInstruction &insn)
+  {
+    switch (insn.opcode) {
+      case SEL_OP_MOV: case SEL_OP_ADD: case SEL_OP_MUL: case SEL_OP_MAD:
+      case SEL_OP_LRP: case SEL_OP_FRC: case SEL_OP_RNDZ: case SEL_OP_RNDE:
+      case SEL_OP_RNDD: case SEL_OP_RNDU:
+        break;
+      default:
+        return false;
+    }
+    if (insn.dstNum != 1 || insn.dst(0).type != GEN_TYPE_F || !isPureALU(insn) ||
+        insn.state.saturate != GEN_MATH_SATURATE_NONE ||
+        insn.state.predicate != GEN_PREDICATE_NONE || !isLocalTemp(insn.dst(0)))
+      return false;
+    for (uint32_t i = 0; i < insn.srcNum; ++i)
+      if (insn.src(i).type != GEN_TYPE_F)
+        return false;
+
+    uint32_t srcID;
+    SelectionInstruction *use = findUse(insn, srcID, NULL, NULL);
+    if (use == NULL || use->opcode != SEL_OP_MOV || use->srcNum != 1 ||
+        use->state.saturate != GEN_MATH_SATURATE_SATURATE ||
+        use->state.predicate != GEN_PREDICATE_NONE || !isPureALU(*use))
+      return false;
+    const GenRegister &src = use->src(0);
+    const GenRegister &d = use->dst(0);
+    if (src.negation || src.absolute || !sameChannels(insn, *use) ||
+        !sameElements(insn.dst(0), src, insn.state.execWidth))
+      return false;
+    // d is written earlier now, it must keep the layout of t and must not be
+    // touched in between
+    if (!isVirtualGRF(d) || d.type != GEN_TYPE_F || !d.isSameRegion(insn.dst(0)) ||
+        readsReg(insn, d.reg()))
+      return false;
+    InsnIterator it(&insn);
+    for (++it; &*it != use; ++it)
+      if (readsReg(*it, d.reg()) || writesReg(*it, d.reg()))
+        return false;
+
+    insn.dst(0) = d;
+    insn.state.saturate = GEN_MATH_SATURATE_SATURATE;
+    bb.insnList.erase(use);
+    return true;
+  }
+
+  /* cmp.l f0 null, x, y
+     ...
+     cmp.l f0 null, x, y   ===>  removed if nothing changes x, y or the flag */
+  bool SelPeepholeOptimizer::reuseFlag(SelectionInstruction &insn)
+  {
+    if (insn.opcode != SEL_OP_CMP || !GenRegister::isNull(insn.dst(0)))
+      return false;
+
+    InsnIterator it(&insn);
+    for (++it; it != bb.insnList.end(); ++it) {
+      SelectionInstruction &next = *it;
+      if (next.opcode == SEL_OP_CMP) {
+        if (GenRegister::isNull(next.dst(0)) &&
+            next.extra.function == insn.extra.function &&
+            sameOperand(next.src(0), insn.src(0)) &&
+            sameOperand(next.src(1), insn.src(1)) &&
+            sameChannels(next, insn) &&
+            next.state.predicate == insn.state.predicate &&
+            next.state.inversePredicate == insn.state.inversePredicate &&
+            next.state.physicalFlag == insn.state.physicalFlag &&
+            next.state.flag == insn.state.flag &&
+            next.state.subFlag == insn.state.subFlag &&
+            next.state.flagIndex == insn.state.flagIndex &&
+            next.state.grfFlag == insn.state.grfFlag &&
+            next.state.externFlag == insn.state.externFlag &&
+            next.state.modFlag == insn.state.modFlag &&
+            next.state.flagGen == insn.state.flagGen) {
+          bb.insnList.erase(&next);
+          return true;
+        }
+        return false;
+      }
+      // Anything else may change the flag or the sources
+      if (!isPureALU(next) || next.opcode == SEL_OP_SEL_CMP)
+        return false;
+      if (!insn.state.physicalFlag && writesReg(next, ir::Register(insn.state.flagIndex)))
+        return false;
+      for (uint32_t i = 0; i < insn.srcNum; ++i)
+        if (insn.src(i).file == GEN_GENERAL_REGISTER_FILE && writesReg(next, insn.src(i).reg()))
+          return false;
+    }
+    return false;
+  }
+
+  /* (+f0) sel d, x, d   ===>  (+f0) mov d, x
+     (+f0) sel d, x, x   ===>  mov d, x */
+  bool SelPeepholeOptimizer::selectToMov(SelectionInstruction &insn)
+  {
+    if (insn.opcode != SEL_OP_SEL || insn.srcNum != 2 || insn.dstNum != 1 ||
+        insn.state.predicate == GEN_PREDICATE_NONE || insn.state.saturate)
+      return false;
+    const GenRegister &src1 = insn.src(1);
+    if (!src1.negation && !src1.absolute &&
+        sameElements(insn.dst(0), src1, insn.state.execWidth)) {
+      insn.opcode = SEL_OP_MOV;
+      insn.srcNum = 1;
+      return true;
+    }
+    if (sameOperand(insn.src(0), src1) && src1.file != GEN_IMMEDIATE_VALUE) {
+      insn.opcode = SEL_OP_MOV;
+      insn.srcNum = 1;
+      insn.state.predicate = GEN_PREDICATE_NONE;
+      insn.state.inversePredicate = 0;
+      return true;
+    }
+    return false;
+  }
+
+  /*! Walk the block backward, an instruction only writing registers nobody
+   *  reads later is removed */
+  bool SelPeepholeOptimizer::eliminateDeadInstructions()
+  {
+    set<ir::Register> live(liveout.begin(), liveout.end());
+    bool changed = false;
+    InsnIterator it = bb.insnList.rbegin();
+    while (it != bb.insnList.rend()) {
+      SelectionInstruction &insn = *it;
+      --it;
+      bool dead = isPureALU(insn) && !insn.isRead() && !insn.isWrite();
+      for (uint32_t i = 0; dead && i < insn.dstNum; ++i)
+        dead = isVirtualGRF(insn.dst(i)) && live.find(insn.dst(i).reg()) == live.end();
+      if (dead) {
+        bb.insnList.erase(&insn);
+        changed = true;
+        continue;
+      }
+      for (uint32_t i = 0; i < insn.srcNum; ++i)
+        if (insn.src(i).file == GEN_GENERAL_REGISTER_FILE)
+          live.insert(insn.src(i).reg());
+      if (usesVirtualFlag(insn))
+        live.insert(ir::Register(insn.state.flagIndex));
+      // A partial write does not kill the register, keep it live
+    }
+    return changed;
+  }
+
+  void SelPeepholeOptimizer::run()
+  {
+    for (size_t i = 0; i < MaxTries; ++i) {
+      bool optimized = false;
+
+      // The rules only remove uses, so the counts stay conservative while
+      // the list changes
+      countUses();
+      InsnIterator it = bb.insnList.begin();
+      while (it != bb.insnList.end()) {
+        SelectionInstruction &insn = *it;
+        InsnIterator next = it;
+        ++next;
+        // Either insn itself is removed, or an instruction after it
+        bool removed = false, changed = false;
+        if (OCL_SEL_PEEPHOLE_SATURATE) {
+          removed = foldClamp(insn);
+          changed = !removed && foldSaturate(insn);
+        }
+        if (!removed && !changed && OCL_SEL_PEEPHOLE_SRCMOD)
+          removed = foldSourceModifier(insn);
+        if (!removed && !changed && OCL_SEL_PEEPHOLE_FLAG)
+          changed = reuseFlag(insn) || selectToMov(insn);
+        optimized = optimized || removed || changed;
+        if (removed)
+          it = next;
+        else {
+          it = InsnIterator(&insn);
+          ++it;
+        }
+      }
+      if (OCL_SEL_PEEPHOLE_DCE)
+        optimized = eliminateDeadInstructions() || optimized;
+
+      if (!optimized)
+        break;      //break since no optimization found at this round
+    }
+  }
+
   BVAR(OCL_GLOBAL_IMM_OPTIMIZATION, true);
 
   void Selection::optimize()
@@ -657,6 +1119,8 @@ namespace gbe
     for (SelectionBlock &block : *blockList) {
       SelBasicBlockOptimizer bbopt(getCtx(), getCtx().getLiveOut(block.bb), opt_features, block);
       bbopt.run();
+      SelPeepholeOptimizer peephole(getCtx(), getCtx().getLiveOut(block.bb), opt_features, block);
+      peephole.run();
     }
 
     //do global optimization
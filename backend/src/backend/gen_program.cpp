@@ -255,6 +255,32 @@ namespace gbe {
 #endif
   }
 
+#ifdef GBE_COMPILER_AVAILABLE
+  // The dumps are printed while compiling, first defined by calling BVAR
+  extern int32_t OCL_OUTPUT_ASM, OCL_OUTPUT_REG_ALLOC, OCL_OUTPUT_SEL_IR,
+                 OCL_OUTPUT_SEL_IR_AFTER_SELECT, OCL_OUTPUT_GEN_IR, OCL_OUTPUT_CFG,
+                 OCL_OUTPUT_CFG_ONLY, OCL_OUTPUT_CFG_GEN_IR, OCL_OUTPUT_LLVM_BEFORE_LINK,
+                 OCL_OUTPUT_LLVM_AFTER_LINK, OCL_OUTPUT_LLVM_AFTER_GEN;
+  namespace ir { extern int32_t OCL_OUTPUT_STRUCTURIZE; }
+#endif
+
+  std::string GenProgram::getBuildCacheKey(int optLevel) const {
+    // Dumping the assembly or any IR needs a real build
+    if (asm_file_name != NULL)
+      return std::string();
+#ifdef GBE_COMPILER_AVAILABLE
+    if (OCL_OUTPUT_ASM || OCL_OUTPUT_REG_ALLOC || OCL_OUTPUT_SEL_IR ||
+        OCL_OUTPUT_SEL_IR_AFTER_SELECT || OCL_OUTPUT_GEN_IR || OCL_OUTPUT_CFG ||
+        OCL_OUTPUT_CFG_ONLY || OCL_OUTPUT_CFG_GEN_IR || OCL_OUTPUT_LLVM_BEFORE_LINK ||
+        OCL_OUTPUT_LLVM_AFTER_LINK || OCL_OUTPUT_LLVM_AFTER_GEN ||
+        ir::OCL_OUTPUT_STRUCTURIZE)
+      return std::string();
+#endif
+    std::ostringstream key;
+    key << deviceID << " " << optLevel << " " << fast_relaxed_math << "\n";
+    return key.str();
+  }
+
 #define GEN_BINARY_HEADER_LENGTH 8
 
   enum GEN_BINARY_HEADER_INDEX {
@@ -269,7 +295,7 @@ namespace gbe {
     GBHI_GLK = 8,
     GBHI_MAX,
   };
-#define GEN_BINARY_VERSION  1
+#define GEN_BINARY_VERSION  2
   static const unsigned char gen_binary_header[GBHI_MAX][GEN_BINARY_HEADER_LENGTH]= \
                                              {{GEN_BINARY_VERSION, 'G','E', 'N', 'C', 'B', 'Y', 'T'},
                                               {GEN_BINARY_VERSION, 'G','E', 'N', 'C', 'I', 'V', 'B'},
@@ -626,6 +652,47 @@ namespace gbe {
 #endif
   }
 
+  static gbe_program genProgramNewFused(uint32_t deviceID,
+                                       uint32_t kernelNum,
+                                       const gbe_program *programs,
+                                       const char **kernelNames,
+                                       const uint32_t *argMap,
+                                       uint32_t fusedArgNum,
+                                       const uint8_t *noAlias,
+                                       const char *fusedName,
+                                       size_t stringSize,
+                                       char *err,
+                                       size_t *errSize)
+  {
+#ifdef GBE_COMPILER_AVAILABLE
+    using namespace gbe;
+    std::string error;
+    std::vector<const void*> modules;
+    for (uint32_t i = 0; i < kernelNum; ++i)
+      modules.push_back(((GenProgram*)programs[i])->module);
+
+    acquireLLVMContextLock();
+    llvm::LLVMContext *ctx = new llvm::LLVMContext();
+    void *module = fuseKernels(ctx, &modules[0], kernelNames, kernelNum, argMap,
+                               fusedArgNum, noAlias, fusedName, error);
+    releaseLLVMContextLock();
+    if (module == NULL) {
+      delete ctx;
+      if (err != NULL && errSize != NULL && stringSize > 0u) {
+        const size_t msgSize = std::min(error.size(), stringSize-1u);
+        std::memcpy(err, error.c_str(), msgSize);
+        *errSize = error.size();
+      }
+      return NULL;
+    }
+    // The program owns the module and its context, see CleanLlvmResource
+    GenProgram *program = GBE_NEW(GenProgram, deviceID, module, ctx);
+    return (gbe_program) program;
+#else
+    return NULL;
+#endif
+  }
+
 } /* namespace gbe */
 
 void genSetupCallBacks(void)
@@ -637,4 +704,5 @@ void genSetupCallBacks(void)
   gbe_program_new_gen_program = gbe::genProgramNewGenProgram;
   gbe_program_link_from_llvm = gbe::genProgramLinkFromLLVM;
   gbe_program_build_from_llvm = gbe::genProgramBuildFromLLVM;
+  gbe_program_new_fused = gbe::genProgramNewFused;
 }
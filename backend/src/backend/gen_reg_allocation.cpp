@@ -84,6 +84,10 @@ namespace gbe
     }
     /*! Output the register allocation */
     void outputAllocation(void);
+    /*! Number of booleans evicted from their physical flag */
+    uint32_t flagSpillNum;
+    /*! Number of instructions added to move booleans between flags and GRFs */
+    uint32_t flagFixupNum;
     INLINE void getRegAttrib(ir::Register reg, uint32_t &regSize, ir::RegisterFamily *regFamily = NULL) const {
       // Note that byte vector registers use two bytes per byte (and can be
       // interleaved)
@@ -208,7 +212,8 @@ namespace gbe
   };
 
 
-  GenRegAllocator::Opaque::Opaque(GenContext &ctx) : ctx(ctx) {}
+  GenRegAllocator::Opaque::Opaque(GenContext &ctx) :
+    flagSpillNum(0), flagFixupNum(0), ctx(ctx) {}
   GenRegAllocator::Opaque::~Opaque(void) {}
 
   void GenRegAllocator::Opaque::allocatePayloadReg(ir::Register reg,
@@ -344,7 +349,10 @@ namespace gbe
     }
     if (RA.contains(reg) == true)
       return true; // already allocated
-    uint32_t grfOffset = allocateReg(interval, regSize, regSize);
+    // The scheduler tracks the GRFs one by one, so nothing larger than a GRF
+    // needs more alignment. SIMD16 64 bit values can then take any 4 GRFs
+    const uint32_t alignment = std::min(regSize, uint32_t(GEN_REG_SIZE));
+    uint32_t grfOffset = allocateReg(interval, regSize, alignment);
     if (grfOffset == 0) {
       return false;
     }
@@ -512,6 +520,7 @@ namespace gbe
     cmp0->dst(0) = GenRegister::retype(GenRegister::null(), GEN_TYPE_UW);
     cmp0->extra.function = GEN_CONDITIONAL_NEQ;
     insn.prepend(*cmp0);
+    flagFixupNum++;
     if (!IS_TEMP_FLAG(insn))
       validatedFlags.insert(insn.state.flagIndex);
     else {
@@ -553,13 +562,19 @@ namespace gbe
     // validation for the same flag. But if there is no enough physical flag,
     // we have to spill the previous allocated physical flag. And the spilling
     // policy is to spill the allocate flag which live to the last time end point.
+    // The live range of the spilled flag is split: it keeps its physical flag
+    // up to the instruction which takes the flag over, and only the later
+    // users have to revalidate it from the grf.
 
     // we have three flags we use for booleans f0.0 , f1.0 and f1.1
     set<const ir::BasicBlock *> liveInSet01;
+    flagSpillNum = flagFixupNum = 0;
     for (auto &block : *selection.blockList) {
       // Store the registers allocated in the map
       map<ir::Register, uint32_t> allocatedFlags;
       map<const GenRegInterval*, uint32_t> allocatedFlagIntervals;
+      // Spilled flags -> (physical flag, ID of the first insn which lost it)
+      map<ir::Register, std::pair<uint32_t, int32_t>> splitFlags;
 
       const uint32_t flagNum = 3;
       uint32_t freeFlags[] = {2, 3, 0};
@@ -634,6 +649,8 @@ namespace gbe
             allocatedFlagIntervals.insert(std::make_pair(interval, spill));
             allocatedFlags.erase(spillInterval->reg);
             allocatedFlagIntervals.erase(spillInterval);
+            splitFlags[spillInterval->reg] = std::make_pair(uint32_t(spill), interval->minID);
+            flagSpillNum++;
             // We spill this flag booleans register, so erase it from the flag boolean set.
             if (flagBooleans.contains(spillInterval->reg))
               flagBooleans.erase(spillInterval->reg);
@@ -654,13 +671,25 @@ namespace gbe
         // is called a "conditional modifier"). The other instructions just read
         // it
         if (insn.state.physicalFlag == 0) {
+          // A spilled flag is still in its physical flag before the split point
+          auto split = splitFlags.find(ir::Register(insn.state.flagIndex));
+          if (split != splitFlags.end()) {
+            if ((int32_t)insn.ID < split->second.second)
+              allocatedFlags[split->first] = split->second.first;
+            else {
+              allocatedFlags.erase(split->first);
+              splitFlags.erase(split);
+            }
+          }
           // SEL.bool instruction, the dst register should be stored in GRF
           // the pred flag is used by flag register
           if (insn.opcode == SEL_OP_SEL) {
             ir::Register dst = insn.dst(0).reg();
             if (ctx.sel->getRegisterFamily(dst) == ir::FAMILY_BOOL &&
-                allocatedFlags.find(dst) != allocatedFlags.end())
+                allocatedFlags.find(dst) != allocatedFlags.end()) {
               allocatedFlags.erase(dst);
+              splitFlags.erase(dst);
+            }
           }
           auto it = allocatedFlags.find(ir::Register(insn.state.flagIndex));
           if (it != allocatedFlags.end()) {
@@ -678,6 +707,7 @@ namespace gbe
               // need to use this flag.
               if (IS_SCALAR_FLAG(insn)) {
                 allocatedFlags.erase(ir::Register(insn.state.flagIndex));
+                splitFlags.erase(ir::Register(insn.state.flagIndex));
                 continue;
               }
               insn.extra.function = GEN_CONDITIONAL_NEQ;
@@ -744,6 +774,7 @@ namespace gbe
             sel0->dst(0) = GET_FLAG_REG(insn);
             liveInSet01.insert(insn.parent->bb);
             insn.append(*sel0);
+            flagFixupNum++;
             // We use the zero one after the liveness analysis, we have to update
             // the liveness data manually here.
             GenRegInterval &interval0 = intervals[ir::ocl::zero];
@@ -819,9 +850,8 @@ namespace gbe
           getRegAttrib(vector->reg[regID].reg(), alignment, NULL);
           size += alignment;
         }
-        // FIXME this is workaround for scheduling limitation, which requires 2*GEN_REG_SIZE under SIMD16.
-        const uint32_t maxAlignment = ctx.getSimdWidth()/8*GEN_REG_SIZE;
-        const uint32_t grfOffset = allocateReg(interval, size, maxAlignment);
+        // Vectors are message payloads or destinations which start on a GRF
+        const uint32_t grfOffset = allocateReg(interval, size, GEN_REG_SIZE);
         if(grfOffset == 0) {
           for(int i = vector->regNum-1; i >= 0; i--) {
             if (!spillReg(vector->reg[i].reg()))
@@ -1631,6 +1661,14 @@ do { \
     this->opaque->outputAllocation();
   }
 
+  uint32_t GenRegAllocator::getFlagSpillNum(void) const {
+    return this->opaque->flagSpillNum;
+  }
+
+  uint32_t GenRegAllocator::getFlagFixupNum(void) const {
+    return this->opaque->flagFixupNum;
+  }
+
   uint32_t GenRegAllocator::getRegSize(ir::Register reg) {
     uint32_t regSize;
     gbe_curbe_type curbeType = GBE_GEN_REG;
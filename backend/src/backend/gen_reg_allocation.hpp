@@ -71,6 +71,10 @@ namespace gbe
     void outputAllocation(void);
     /*! Get register actual size in byte. */
     uint32_t getRegSize(ir::Register reg);
+    /*! Number of booleans evicted from the flag registers */
+    uint32_t getFlagSpillNum(void) const;
+    /*! Number of CMP/SEL added to move booleans between flags and GRFs */
+    uint32_t getFlagFixupNum(void) const;
   private:
     /*! Actual implementation of the register allocator (use Pimpl) */
     class Opaque;
@@ -51,6 +51,7 @@
 #include <iostream>
 #include <unistd.h>
 #include <mutex>
+#include <list>
 
 #ifdef GBE_COMPILER_AVAILABLE
 
@@ -113,10 +114,83 @@ namespace gbe {
   BVAR(OCL_STRICT_CONFORMANCE, true);
   IVAR(OCL_PROFILING_LOG, 0, 0, 1); // Int for different profiling types.
   BVAR(OCL_OUTPUT_BUILD_LOG, false);
+  IVAR(OCL_BUILD_CACHE_SIZE, 0, 32, 1024);
+
+  /*! Serialized programs built from identical modules with the same options,
+   *  the most recently used first. Services creating one context per client
+   *  build the same programs again and again */
+  static std::mutex buildCacheMutex;
+  static std::list<std::pair<std::string, std::string>> buildCache;
+
+  /*! The module printed without its identifier and source file name */
+  static std::string getModuleKey(const llvm::Module &mod) {
+    std::string text;
+    llvm::raw_string_ostream os(text);
+    mod.print(os, NULL);
+    os.flush();
+    size_t start = 0;
+    while (text.compare(start, 10, "; ModuleID") == 0 ||
+           text.compare(start, 15, "source_filename") == 0) {
+      const size_t end = text.find('\n', start);
+      if (end == std::string::npos)
+        break;
+      start = end + 1;
+    }
+    return text.substr(start);
+  }
+
+  bool Program::buildFromCache(const std::string &key) {
+    std::string binary;
+    {
+      std::lock_guard<std::mutex> lock(buildCacheMutex);
+      for (auto it = buildCache.begin(); it != buildCache.end(); ++it)
+        if (it->first == key) {
+          binary = it->second;
+          buildCache.splice(buildCache.begin(), buildCache, it);
+          break;
+        }
+    }
+    if (binary.empty())
+      return false;
+    std::istringstream ins(binary, std::ios::binary);
+    const uint32_t sz = this->deserializeFromBin(ins);
+    GBE_ASSERTM(sz != 0, "Corrupted program in the build cache");
+    return sz != 0;
+  }
+
+  void Program::storeInCache(const std::string &key) {
+    // The serialized program has no printf, profiling or device enqueue
+    // information
+    if (OCL_PROFILING_LOG || !blockFuncs.empty())
+      return;
+    for (const auto &pair : kernels)
+      if (pair.second->getPrintfNum() != 0 || pair.second->getUseDeviceEnqueue())
+        return;
+
+    std::ostringstream outs(std::ios::binary);
+    if (this->serializeToBin(outs) == 0)
+      return;
+    std::lock_guard<std::mutex> lock(buildCacheMutex);
+    buildCache.emplace_front(key, outs.str());
+    while (buildCache.size() > (size_t) OCL_BUILD_CACHE_SIZE)
+      buildCache.pop_back();
+  }
 
   bool Program::buildFromLLVMModule(const void* module,
                                               std::string &error,
                                               int optLevel) {
+    // Identical modules give identical programs, llvmToGen changes the module
+    // so get the key first
+    std::string cacheKey;
+    if (OCL_BUILD_CACHE_SIZE > 0 && module != NULL) {
+      cacheKey = this->getBuildCacheKey(optLevel);
+      if (!cacheKey.empty()) {
+        cacheKey += getModuleKey(*(const llvm::Module*) module);
+        if (this->buildFromCache(cacheKey))
+          return true;
+      }
+    }
+
     ir::Unit *unit = new ir::Unit();
     bool ret = false;
 
@@ -144,6 +218,8 @@ namespace gbe {
       error = error + error2;
     }
     delete unit;
+    if (ret && !cacheKey.empty())
+      this->storeInCache(cacheKey);
     return ret;
   }
 
@@ -314,6 +390,7 @@ namespace gbe {
       OUT_UPDATE_SZ(arg.size);
       OUT_UPDATE_SZ(arg.align);
       OUT_UPDATE_SZ(arg.bti);
+      OUT_UPDATE_SZ(arg.access);
 
       OUT_UPDATE_SZ(arg.info.addrSpace);
 
@@ -360,6 +437,17 @@ namespace gbe {
     OUT_UPDATE_SZ(compileWgSize[0]);
     OUT_UPDATE_SZ(compileWgSize[1]);
     OUT_UPDATE_SZ(compileWgSize[2]);
+    sz = functionAttributes.size();
+    OUT_UPDATE_SZ(sz);
+    outs.write(functionAttributes.c_str(), functionAttributes.size());
+    ret_size += sizeof(char)*functionAttributes.size();
+    OUT_UPDATE_SZ(stats.insnNum);
+    OUT_UPDATE_SZ(stats.sendNum);
+    OUT_UPDATE_SZ(stats.spillNum);
+    OUT_UPDATE_SZ(stats.unspillNum);
+    OUT_UPDATE_SZ(stats.regUsed);
+    OUT_UPDATE_SZ(stats.flagSpillNum);
+    OUT_UPDATE_SZ(stats.flagFixupNum);
     /* samplers. */
     if (!samplerSet->empty()) {   //samplerSet is always valid, allocated in Function::Function
       has_samplerset = 1;
@@ -429,6 +517,7 @@ namespace gbe {
       IN_UPDATE_SZ(arg.size);
       IN_UPDATE_SZ(arg.align);
       IN_UPDATE_SZ(arg.bti);
+      IN_UPDATE_SZ(arg.access);
 
       IN_UPDATE_SZ(arg.info.addrSpace);
 
@@ -491,6 +580,18 @@ namespace gbe {
     IN_UPDATE_SZ(compileWgSize[0]);
     IN_UPDATE_SZ(compileWgSize[1]);
     IN_UPDATE_SZ(compileWgSize[2]);
+    uint32_t attr_len;
+    IN_UPDATE_SZ(attr_len);
+    functionAttributes.resize(attr_len);
+    ins.read(&functionAttributes[0], attr_len*sizeof(char));
+    total_size += sizeof(char)*attr_len;
+    IN_UPDATE_SZ(stats.insnNum);
+    IN_UPDATE_SZ(stats.sendNum);
+    IN_UPDATE_SZ(stats.spillNum);
+    IN_UPDATE_SZ(stats.unspillNum);
+    IN_UPDATE_SZ(stats.regUsed);
+    IN_UPDATE_SZ(stats.flagSpillNum);
+    IN_UPDATE_SZ(stats.flagFixupNum);
 
     IN_UPDATE_SZ(has_samplerset);
     if (has_samplerset) {
@@ -582,6 +683,7 @@ namespace gbe {
       outs << spaces_nl << "      size: "<< arg.size << "\n";
       outs << spaces_nl << "      align: "<< arg.align << "\n";
       outs << spaces_nl << "      bti: "<< arg.bti << "\n";
+      outs << spaces_nl << "      access: "<< arg.access << "\n";
     }
 
     outs << spaces_nl << "  Patches Number is " << patches.size() << "\n";
@@ -1360,6 +1462,12 @@ EXTEND_QUOTE:
     return kernel->getArgBTI(argID);
   }
 
+  static uint32_t kernelGetArgAccess(gbe_kernel genKernel, uint32_t argID) {
+    if (genKernel == NULL) return 0u;
+    const gbe::Kernel *kernel = (const gbe::Kernel*) genKernel;
+    return kernel->getArgAccess(argID);
+  }
+
   static uint32_t kernelGetArgAlign(gbe_kernel genKernel, uint32_t argID) {
     if (genKernel == NULL) return 0u;
     const gbe::Kernel *kernel = (const gbe::Kernel*) genKernel;
@@ -1529,6 +1637,7 @@ GBE_EXPORT_SYMBOL gbe_program_new_from_llvm_cb *gbe_program_new_from_llvm = NULL
 GBE_EXPORT_SYMBOL gbe_program_new_gen_program_cb *gbe_program_new_gen_program = NULL;
 GBE_EXPORT_SYMBOL gbe_program_link_from_llvm_cb *gbe_program_link_from_llvm = NULL;
 GBE_EXPORT_SYMBOL gbe_program_build_from_llvm_cb *gbe_program_build_from_llvm = NULL;
+GBE_EXPORT_SYMBOL gbe_program_new_fused_cb *gbe_program_new_fused = NULL;
 GBE_EXPORT_SYMBOL gbe_program_get_global_constant_size_cb *gbe_program_get_global_constant_size = NULL;
 GBE_EXPORT_SYMBOL gbe_program_get_global_constant_data_cb *gbe_program_get_global_constant_data = NULL;
 GBE_EXPORT_SYMBOL gbe_program_get_global_reloc_count_cb *gbe_program_get_global_reloc_count = NULL;
@@ -1547,6 +1656,7 @@ GBE_EXPORT_SYMBOL gbe_kernel_get_arg_num_cb *gbe_kernel_get_arg_num = NULL;
 GBE_EXPORT_SYMBOL gbe_kernel_get_arg_info_cb *gbe_kernel_get_arg_info = NULL;
 GBE_EXPORT_SYMBOL gbe_kernel_get_arg_size_cb *gbe_kernel_get_arg_size = NULL;
 GBE_EXPORT_SYMBOL gbe_kernel_get_arg_bti_cb *gbe_kernel_get_arg_bti = NULL;
+GBE_EXPORT_SYMBOL gbe_kernel_get_arg_access_cb *gbe_kernel_get_arg_access = NULL;
 GBE_EXPORT_SYMBOL gbe_kernel_get_arg_type_cb *gbe_kernel_get_arg_type = NULL;
 GBE_EXPORT_SYMBOL gbe_kernel_get_arg_align_cb *gbe_kernel_get_arg_align = NULL;
 GBE_EXPORT_SYMBOL gbe_kernel_get_simd_width_cb *gbe_kernel_get_simd_width = NULL;
@@ -1603,6 +1713,7 @@ namespace gbe
       gbe_kernel_get_arg_info = gbe::kernelGetArgInfo;
       gbe_kernel_get_arg_size = gbe::kernelGetArgSize;
       gbe_kernel_get_arg_bti = gbe::kernelGetArgBTI;
+      gbe_kernel_get_arg_access = gbe::kernelGetArgAccess;
       gbe_kernel_get_arg_type = gbe::kernelGetArgType;
       gbe_kernel_get_arg_align = gbe::kernelGetArgAlign;
       gbe_kernel_get_simd_width = gbe::kernelGetSIMDWidth;
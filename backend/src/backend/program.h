@@ -59,6 +59,14 @@ enum gbe_arg_type {
   GBE_ARG_INVALID = 0xffffffff
 };
 
+/*! How the kernel accesses a buffer argument */
+enum gbe_arg_access {
+  GBE_ARG_ACCESS_READ = 1 << 0,     // loaded from
+  GBE_ARG_ACCESS_WRITE = 1 << 1,    // stored to
+  GBE_ARG_ACCESS_REUSED = 1 << 2,   // accessed in a loop
+  GBE_ARG_ACCESS_CONSTANT = 1 << 3  // __constant
+};
+
 /*! Get argument info values */
 enum gbe_get_arg_info_value {
   GBE_GET_ARG_INFO_ADDRSPACE = 0,
@@ -265,6 +273,25 @@ typedef void gbe_program_build_from_llvm_cb(gbe_program program,
                                       const char *          options);
 extern gbe_program_build_from_llvm_cb *gbe_program_build_from_llvm;
 
+/*! Create a program whose only kernel, fused_name, runs the given kernels
+ *  one after the other for each work item. arg_map gives for every argument
+ *  of every kernel, in order, the argument of the fused kernel it is bound
+ *  to. The pointer arguments flagged in no_alias get the noalias attribute.
+ *  The programs must still have their LLVM module. The result has to be
+ *  built with gbe_program_build_from_llvm. */
+typedef gbe_program (gbe_program_new_fused_cb)(uint32_t deviceID,
+                                               uint32_t kernel_num,
+                                               const gbe_program *programs,
+                                               const char **kernel_names,
+                                               const uint32_t *arg_map,
+                                               uint32_t fused_arg_num,
+                                               const uint8_t *no_alias,
+                                               const char *fused_name,
+                                               size_t string_size,
+                                               char *err,
+                                               size_t *err_size);
+extern gbe_program_new_fused_cb *gbe_program_new_fused;
+
 /*! Get the size of global constants */
 typedef size_t (gbe_program_get_global_constant_size_cb)(gbe_program gbeProgram);
 extern gbe_program_get_global_constant_size_cb *gbe_program_get_global_constant_size;
@@ -345,6 +372,10 @@ extern gbe_kernel_get_arg_size_cb *gbe_kernel_get_arg_size;
 typedef uint8_t (gbe_kernel_get_arg_bti_cb)(gbe_kernel, uint32_t argID);
 extern gbe_kernel_get_arg_bti_cb *gbe_kernel_get_arg_bti;
 
+/*! Get the gbe_arg_access traits of a buffer argument */
+typedef uint32_t (gbe_kernel_get_arg_access_cb)(gbe_kernel, uint32_t argID);
+extern gbe_kernel_get_arg_access_cb *gbe_kernel_get_arg_access;
+
 /*! Get the type of the given argument */
 typedef enum gbe_arg_type (gbe_kernel_get_arg_type_cb)(gbe_kernel, uint32_t argID);
 extern gbe_kernel_get_arg_type_cb *gbe_kernel_get_arg_type;
@@ -49,6 +49,7 @@ namespace gbe {
     uint32_t size;     //!< Size of the argument
     uint32_t align;    //!< addr alignment of the argument
     uint8_t bti;      //!< binding table index for __global buffer
+    uint32_t access;  //!< gbe_arg_access traits of buffer arguments
 
     // Strings for arg info.
     struct ArgInfo {
@@ -78,6 +79,23 @@ namespace gbe {
     return i0.subType < i1.subType;
   }
 
+  /*! Static resource usage of the generated code. It is filled when the
+   *  kernel is compiled, kept in the binary, and is used to track code
+   *  quality regressions without running the kernel.
+   */
+  struct KernelStatistics {
+    INLINE KernelStatistics(void) :
+      insnNum(0), sendNum(0), spillNum(0), unspillNum(0), regUsed(0),
+      flagSpillNum(0), flagFixupNum(0) {}
+    uint32_t insnNum;    //!< Number of emitted Gen instructions (compact or not)
+    uint32_t sendNum;    //!< Number of SEND/SENDC/SENDS messages
+    uint32_t spillNum;   //!< Number of register spill (scratch write) instructions
+    uint32_t unspillNum; //!< Number of register fill (scratch read) instructions
+    uint32_t regUsed;    //!< Peak register file usage in bytes
+    uint32_t flagSpillNum; //!< Number of booleans evicted from the flag registers
+    uint32_t flagFixupNum; //!< Number of CMP/SEL moving booleans between flags and GRFs
+  };
+
   /*! Describe a compiled kernel */
   class Kernel : public NonCopyable, public Serializable
   {
@@ -104,6 +122,10 @@ namespace gbe {
     INLINE uint8_t getArgBTI(uint32_t argID) const {
       return argID >= argNum ? 0u : args[argID].bti;
     }
+    /*! Return how the kernel accesses the given buffer argument */
+    INLINE uint32_t getArgAccess(uint32_t argID) const {
+      return argID >= argNum ? 0u : args[argID].access;
+    }
     /*! Return the alignment of buffer argument */
     INLINE uint32_t getArgAlign(uint32_t argID) const {
       return argID >= argNum ? 0u : args[argID].align;
@@ -122,6 +144,8 @@ namespace gbe {
     INLINE uint32_t getScratchSize(void) const { return this->scratchSize; }
     /*! Get the SIMD width for the kernel */
     INLINE uint32_t getSIMDWidth(void) const { return this->simdWidth; }
+    /*! Get the static resource usage of the generated code */
+    INLINE const KernelStatistics &getStatistics(void) const { return this->stats; }
     /*! Says if SLM is needed for it */
     INLINE bool getUseSLM(void) const { return this->useSLM; }
     /*! get slm size for kernel local variable */
@@ -261,6 +285,7 @@ namespace gbe {
     uint32_t compileWgSize[3]; //!< required work group size by kernel attribute.
     std::string functionAttributes; //!< function attribute qualifiers combined.
     bool useDeviceEnqueue;          //!< Has device enqueue?
+    KernelStatistics stats;         //!< Static resource usage of the code
     GBE_CLASS(Kernel);         //!< Use custom allocators
   };
 
@@ -338,6 +363,12 @@ namespace gbe {
     uint32_t fast_relaxed_math : 1;
 
   protected:
+    /*! Build options part of the build cache key, empty to not use the cache */
+    virtual std::string getBuildCacheKey(int optLevel) const { return std::string(); }
+    /*! Deserialize the program built before from the same key */
+    bool buildFromCache(const std::string &key);
+    /*! Keep the serialized program for the next builds with the same key */
+    void storeInCache(const std::string &key);
     /*! Compile a kernel */
     virtual Kernel *compileKernel(const ir::Unit &unit, const std::string &name,
                                   bool relaxMath, int profiling) = 0;
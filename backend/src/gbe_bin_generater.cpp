@@ -57,6 +57,7 @@ protected:
     string build_opt;
     static string bin_path;
     static bool str_fmt_out;
+    static bool stats_out;
     int fd;
     int file_len;
     const char* code;
@@ -136,6 +137,14 @@ public:
         str_fmt_out = flag;
     }
 
+    static void set_stats_out (bool flag) {
+        stats_out = flag;
+    }
+
+    static bool get_stats_out (void) {
+        return stats_out;
+    }
+
     static int set_bin_path (const char* path) {
         if (bin_path.size())
             return 0;
@@ -146,10 +155,12 @@ public:
 
     void build_program(void) throw(int);
     void serialize_program(void) throw(int);
+    void print_statistics(void);
 };
 
 string program_build_instance::bin_path;
 bool program_build_instance::str_fmt_out = false;
+bool program_build_instance::stats_out = false;
 #define OUTS_UPDATE_SZ(elt) SERIALIZE_OUT(elt, oss, header_sz)
 #define OUTF_UPDATE_SZ(elt) SERIALIZE_OUT(elt, ofs, header_sz)
 
@@ -270,6 +281,24 @@ void program_build_instance::serialize_program(void) throw(int)
     }
 }
 
+/* One line per kernel, parsed by utests/kernel_stats_check.py. */
+void program_build_instance::print_statistics(void)
+{
+    for (uint32_t i = 0; i < gbe_prog->getKernelNum(); i++) {
+        const gbe::Kernel *kernel = gbe_prog->getKernel(i);
+        const gbe::KernelStatistics &stats = kernel->getStatistics();
+        cout << prog_path << ":" << kernel->getName()
+             << " simd=" << kernel->getSIMDWidth()
+             << " insn=" << stats.insnNum
+             << " send=" << stats.sendNum
+             << " spill=" << stats.spillNum
+             << " fill=" << stats.unspillNum
+             << " scratch=" << kernel->getScratchSize()
+             << " grf=" << stats.regUsed
+             << " fspill=" << stats.flagSpillNum
+             << " ffix=" << stats.flagFixupNum << endl;
+    }
+}
 
 void program_build_instance::build_program(void) throw(int)
 {
@@ -324,7 +353,7 @@ int main (int argc, const char **argv)
     deque<int> used_index;
 
     if (argc < 2) {
-        cout << "Usage: kernel_path [-pbuild_parameter] [-obin_path] [-tgen_pci_id]" << endl;
+        cout << "Usage: kernel_path [-pbuild_parameter] [-obin_path] [-tgen_pci_id] [-m]" << endl;
         return 0;
     }
 
@@ -335,7 +364,7 @@ int main (int argc, const char **argv)
         argv_saved.push_back(string(argv[i]));
     }
 
-    while ( (oc = getopt(argc, (char * const *)argv, "t:o:p:s")) != -1 ) {
+    while ( (oc = getopt(argc, (char * const *)argv, "t:o:p:sm")) != -1 ) {
         switch (oc) {
         case 'p':
         {
@@ -392,6 +421,11 @@ int main (int argc, const char **argv)
             used_index[optind-1] = 1;
             break;
 
+        case 'm':
+            program_build_instance::set_stats_out(true);
+            used_index[optind-1] = 1;
+            break;
+
         case ':':
             cout << "Miss the file option argument" << endl;
             return 1;
@@ -423,11 +457,19 @@ int main (int argc, const char **argv)
         }
     }
 
+    if (program_build_instance::get_stats_out() && !gen_pci_id) {
+        cout << "Statistics output needs a target device (-tgen_pci_id)" << endl;
+        return 1;
+    }
+
     for (auto& inst : prog_insts) {
         try {
             inst.file_map_open();
             inst.build_program();
-            inst.serialize_program();
+            if (program_build_instance::get_stats_out())
+                inst.print_statistics();
+            else
+                inst.serialize_program();
         }
         catch (int & err_no) {
             if (err_no == FILE_NOT_FIND_ERR) {
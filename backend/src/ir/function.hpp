@@ -352,6 +352,10 @@ namespace ir {
     INLINE void setRegister(Tuple ID, uint32_t which, Register reg) {
       file.set(ID, which, reg);
     }
+    /*! Create a new tuple from the given registers */
+    INLINE Tuple newTuple(const Register *reg, uint32_t regNum) {
+      return file.appendArrayTuple(reg, regNum);
+    }
     /*! Get the type from the tuple vector */
     INLINE uint8_t getType(Tuple ID, uint32_t which) const {
       return file.getType(ID, which);
@@ -537,7 +541,7 @@ namespace ir {
                  int parent,
                  const vector<LabelIndex> &bbs,
                  const vector<std::pair<LabelIndex, LabelIndex>> &exits);
-    INLINE const vector<Loop * > &getLoops() { return loops; }
+    INLINE const vector<Loop * > &getLoops() const { return loops; }
     int getLoopDepth(LabelIndex Block) const;
     vector<BasicBlock *> &getBlocks() { return blocks; }
     /*! Get surface starting address register from bti */
@@ -168,7 +168,10 @@ namespace ir {
         this->dst[0] = dst;
         this->src[0] = src0;
         this->src[1] = src1;
+        this->contract = false;
       }
+      INLINE bool allowContract(void) const { return contract; }
+      INLINE void setAllowContract(bool contract) { this->contract = contract; }
       INLINE bool commutes(void) const {
         switch (opcode) {
           case OP_ADD:
@@ -182,6 +185,7 @@ namespace ir {
             return false;
         }
       }
+      bool contract;  //!< May be fused with a dependent add or sub
     };
 
     class ALIGNED_INSTRUCTION TernaryInstruction :
@@ -2412,6 +2416,7 @@ DECL_MEM_FN(NullaryInstruction, Type, getType(void), getType())
 DECL_MEM_FN(UnaryInstruction, Type, getType(void), getType())
 DECL_MEM_FN(BinaryInstruction, Type, getType(void), getType())
 DECL_MEM_FN(BinaryInstruction, bool, commutes(void), commutes())
+DECL_MEM_FN(BinaryInstruction, bool, allowContract(void), allowContract())
 DECL_MEM_FN(SelectInstruction, Type, getType(void), getType())
 DECL_MEM_FN(TernaryInstruction, Type, getType(void), getType())
 DECL_MEM_FN(CompareInstruction, Type, getType(void), getType())
@@ -2501,6 +2506,10 @@ DECL_MEM_FN(MemInstruction, void,     setBtiReg(Register reg), setBtiReg(reg))
     return reinterpret_cast<const internal::LoadImmInstruction*>(this)->getImmediate(fn);
   }
 
+  void BinaryInstruction::setAllowContract(bool contract) {
+    reinterpret_cast<internal::BinaryInstruction*>(this)->setAllowContract(contract);
+  }
+
   void LoadImmInstruction::setImmediateIndex(ImmediateIndex immIndex) {
     reinterpret_cast<internal::LoadImmInstruction*>(this)->setImmediateIndex(immIndex);
   }
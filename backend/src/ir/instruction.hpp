@@ -254,6 +254,9 @@ namespace ir {
     Type getType(void) const;
     /*! Commutative instructions can allow better optimizations */
     bool commutes(void) const;
+    /*! The result may be fused with the next operation (FP_CONTRACT) */
+    bool allowContract(void) const;
+    void setAllowContract(bool contract);
     /*! Return true if the given instruction is an instance of this class */
     static bool isClassOf(const Instruction &insn);
   };
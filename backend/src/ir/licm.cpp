@@ -0,0 +1,255 @@
+/*
+ * Copyright © 2017 Intel Corporation
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library. If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+/**
+ * \file licm.cpp
+ */
+
+#include "ir/licm.hpp"
+#include "ir/function.hpp"
+#include "ir/liveness.hpp"
+#include "sys/map.hpp"
+#include "sys/set.hpp"
+#include <algorithm>
+
+namespace gbe {
+namespace ir {
+
+  class LoopInvariantMotion
+  {
+  public:
+    LoopInvariantMotion(Function &fn, uint32_t maxPressure) :
+      fn(fn), maxPressure(maxPressure) {}
+    /*! Process all the loops, innermost first */
+    uint32_t hoist(void);
+  private:
+    /*! Pure instructions we know how to move */
+    bool isHoistable(const Instruction &insn) const;
+    /*! Source is defined outside of the current loop or already hoisted */
+    bool isInvariantSrc(Register reg) const;
+    /*! Hoist the invariants of one loop into its preheader */
+    uint32_t hoistLoop(const Loop &loop, const Liveness &liveness);
+    /*! Get the instruction after which the hoisted instructions go */
+    Instruction *getInsertPoint(BasicBlock &preheader) const;
+    /*! Count definitions and uses of each register */
+    void buildRegInfo(void);
+    /*! Keep the per register vectors in sync with new registers */
+    void growRegInfo(void);
+    Function &fn;
+    uint32_t maxPressure;
+    vector<uint32_t> defNum;               //!< Definitions of each register
+    vector<uint32_t> useNum;               //!< Uses of each register
+    set<Register> loopDefs;                //!< Registers defined in the current loop
+    map<Register, Instruction*> loopImms;  //!< LOADIs of the current loop
+    map<Register, Register> hoistedImms;   //!< LOADIs duplicated in the preheader
+  };
+
+  void LoopInvariantMotion::buildRegInfo(void) {
+    const uint32_t regNum = fn.regNum();
+    defNum.assign(regNum, 0);
+    useNum.assign(regNum, 0);
+    fn.foreachInstruction([&](Instruction &insn) {
+      for (uint32_t srcID = 0; srcID < insn.getSrcNum(); ++srcID)
+        useNum[insn.getSrc(srcID)]++;
+      for (uint32_t dstID = 0; dstID < insn.getDstNum(); ++dstID)
+        defNum[insn.getDst(dstID)]++;
+    });
+  }
+
+  void LoopInvariantMotion::growRegInfo(void) {
+    const uint32_t regNum = fn.regNum();
+    defNum.resize(regNum, 0);
+    useNum.resize(regNum, 0);
+  }
+
+  bool LoopInvariantMotion::isHoistable(const Instruction &insn) const {
+    switch (insn.getOpcode()) {
+      case OP_MOV: case OP_ADD: case OP_SUB: case OP_MUL:
+      case OP_AND: case OP_OR: case OP_XOR:
+      case OP_SHL: case OP_SHR: case OP_ASR:
+      case OP_MUL_HI: case OP_MAD: case OP_SEL:
+      case OP_CVT: case OP_BITCAST:
+      case OP_RCP: case OP_RSQ: case OP_SQR:
+      case OP_GET_IMAGE_INFO:
+        break;
+      case OP_LOAD:
+      {
+        // Constant memory does not change during the kernel execution. Only
+        // take bounded (static BTI) accesses as the load may be speculated
+        const LoadInstruction &load = cast<LoadInstruction>(insn);
+        if (load.getAddressSpace() != MEM_CONSTANT ||
+            load.getAddressMode() != AM_StaticBti ||
+            load.isBlock())
+          return false;
+        break;
+      }
+      default:
+        return false;
+    }
+    for (uint32_t dstID = 0; dstID < insn.getDstNum(); ++dstID) {
+      const Register dst = insn.getDst(dstID);
+      if (defNum[dst] != 1 || fn.isSpecialReg(dst) || fn.isPayloadReg(dst))
+        return false;
+      // Keep the flag registers for the comparisons inside the loop
+      if (fn.getRegisterFamily(dst) == FAMILY_BOOL)
+        return false;
+    }
+    return true;
+  }
+
+  bool LoopInvariantMotion::isInvariantSrc(Register reg) const {
+    if (loopDefs.contains(reg) == false)
+      return true;
+    return loopImms.find(reg) != loopImms.end();
+  }
+
+  uint32_t getRegPressureWeight(Function &fn, Register reg) {
+    const RegisterFamily family = fn.getRegisterFamily(reg);
+    if (family == FAMILY_BOOL || fn.isUniformRegister(reg))
+      return 0;
+    return family == FAMILY_QWORD ? 2 : 1;
+  }
+
+  uint32_t getLoopPressure(Function &fn, const Loop &loop, const Liveness &liveness) {
+    uint32_t pressure = 0;
+    for (auto label : loop.bbs) {
+      uint32_t blockPressure = 0;
+      for (auto reg : liveness.getLiveIn(&fn.getBlock(label)))
+        blockPressure += getRegPressureWeight(fn, reg);
+      pressure = std::max(pressure, blockPressure);
+    }
+    return pressure;
+  }
+
+  Instruction *LoopInvariantMotion::getInsertPoint(BasicBlock &preheader) const {
+    Instruction *last = preheader.getLastInstruction();
+    if (last->isMemberOf<BranchInstruction>())
+      return static_cast<Instruction*>(last->prev);
+    return last;
+  }
+
+  uint32_t LoopInvariantMotion::hoistLoop(const Loop &loop, const Liveness &liveness) {
+    if (loop.bbs.size() == 0)
+      return 0;
+
+    // We need a dedicated preheader: a block outside of the loop whose only
+    // successor is the loop header
+    BasicBlock &header = fn.getBlock(loop.bbs[0]);
+    BasicBlock &preheader = fn.getBlock(loop.preheader);
+    if (std::find(loop.bbs.begin(), loop.bbs.end(), loop.preheader) != loop.bbs.end() ||
+        preheader.getSuccessorSet().size() != 1 ||
+        preheader.getSuccessorSet().contains(&header) == false)
+      return 0;
+
+    uint32_t pressure = getLoopPressure(fn, loop, liveness);
+    if (pressure >= maxPressure)
+      return 0;
+
+    loopDefs.clear();
+    loopImms.clear();
+    hoistedImms.clear();
+    for (auto label : loop.bbs)
+      fn.getBlock(label).foreach([&](Instruction &insn) {
+        for (uint32_t dstID = 0; dstID < insn.getDstNum(); ++dstID)
+          loopDefs.insert(insn.getDst(dstID));
+        if (insn.getOpcode() == OP_LOADI && defNum[insn.getDst(0)] == 1)
+          loopImms[insn.getDst(0)] = &insn;
+      });
+
+    // Sources must be hoisted before their users, so iterate until no more
+    // instruction can move
+    uint32_t hoistedNum = 0;
+    bool changed = true;
+    while (changed && pressure < maxPressure) {
+      changed = false;
+      for (auto label : loop.bbs) {
+        BasicBlock &bb = fn.getBlock(label);
+        bb.foreach([&](Instruction &insn) {
+          if (pressure >= maxPressure || !isHoistable(insn))
+            return;
+          for (uint32_t srcID = 0; srcID < insn.getSrcNum(); ++srcID)
+            if (!isInvariantSrc(insn.getSrc(srcID)))
+              return;
+
+          // Duplicate the LOADIs in the preheader, the original ones stay for
+          // the users remaining in the loop
+          Instruction *insertPoint = getInsertPoint(preheader);
+          for (uint32_t srcID = 0; srcID < insn.getSrcNum(); ++srcID) {
+            const Register src = insn.getSrc(srcID);
+            auto imm = loopImms.find(src);
+            if (imm == loopImms.end())
+              continue;
+            auto hoistedImm = hoistedImms.find(src);
+            Register newSrc;
+            if (hoistedImm == hoistedImms.end()) {
+              newSrc = fn.newRegister(fn.getRegisterFamily(src), fn.isUniformRegister(src));
+              growRegInfo();
+              Instruction loadImm(*imm->second);
+              loadImm.setDst(0, newSrc);
+              loadImm.insert(insertPoint, &insertPoint);
+              defNum[newSrc] = 1;
+              hoistedImms[src] = newSrc;
+            } else
+              newSrc = hoistedImm->second;
+            insn.setSrc(srcID, newSrc);
+            useNum[src]--;
+            useNum[newSrc]++;
+          }
+
+          for (uint32_t dstID = 0; dstID < insn.getDstNum(); ++dstID) {
+            loopDefs.erase(insn.getDst(dstID));
+            pressure += getRegPressureWeight(fn, insn.getDst(dstID));
+          }
+          insn.insert(insertPoint);
+          insn.remove();
+          hoistedNum++;
+          changed = true;
+        });
+      }
+    }
+
+    // LOADIs whose all users were hoisted are dead now
+    for (auto &imm : loopImms)
+      if (useNum[imm.first] == 0) {
+        defNum[imm.first] = 0;
+        imm.second->remove();
+      }
+    return hoistedNum;
+  }
+
+  uint32_t LoopInvariantMotion::hoist(void) {
+    const vector<Loop *> &loops = fn.getLoops();
+    if (loops.size() == 0)
+      return 0;
+    buildRegInfo();
+    Liveness liveness(fn);
+    uint32_t hoistedNum = 0;
+    // Loops are stored outermost first. Inner loops go first so that their
+    // invariants may be hoisted again out of the parent loop
+    for (int32_t loopID = loops.size() - 1; loopID >= 0; --loopID)
+      hoistedNum += hoistLoop(*loops[loopID], liveness);
+    return hoistedNum;
+  }
+
+  uint32_t hoistLoopInvariant(Function &fn, uint32_t maxPressure) {
+    LoopInvariantMotion licm(fn, maxPressure);
+    return licm.hoist();
+  }
+
+} /* namespace ir */
+} /* namespace gbe */
@@ -0,0 +1,62 @@
+/*
+ * Copyright © 2017 Intel Corporation
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library. If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+/**
+ * \file licm.hpp
+ *  Loop invariant code motion on GEN IR
+ */
+
+#ifndef __GBE_IR_LICM_HPP__
+#define __GBE_IR_LICM_HPP__
+
+#include "sys/platform.hpp"
+
+namespace gbe {
+namespace ir {
+
+  // Structure to update
+  class Function;
+  class Liveness;
+  class Register;
+  struct Loop;
+
+  /*! Rough number of values a register takes in the register file */
+  uint32_t getRegPressureWeight(Function &fn, Register reg);
+
+  /*! Estimated number of values alive in the loop (max over its blocks) */
+  uint32_t getLoopPressure(Function &fn, const Loop &loop, const Liveness &liveness);
+
+  /*! LLVM LICM runs before llvmToGen, but the translation to GEN IR creates
+   *  new invariant instructions inside loops: image info reads, address
+   *  computations from kernel arguments, loads from __constant memory through
+   *  a static BTI and so on. This pass hoists them into the loop preheader
+   *  using the loop information gathered by GenWriter::gatherLoopInfo.
+   *
+   *  Only instructions without side effect whose destinations are defined once
+   *  in the function and whose sources are defined outside of the loop (or by
+   *  already hoisted instructions) are moved. LOADIs are duplicated instead of
+   *  moved so that the in-loop users can still fold them as immediates.
+   *  Hoisting stops for a loop when the estimated number of values alive in
+   *  the loop reaches maxPressure. Returns the number of hoisted instructions.
+   */
+  uint32_t hoistLoopInvariant(Function &fn, uint32_t maxPressure);
+
+} /* namespace ir */
+} /* namespace gbe */
+
+#endif /* __GBE_IR_LICM_HPP__ */
@@ -0,0 +1,282 @@
+/*
+ * Copyright © 2017 Intel Corporation
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library. If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+/**
+ * \file pipelining.cpp
+ */
+
+#include "ir/pipelining.hpp"
+#include "ir/licm.hpp"
+#include "ir/function.hpp"
+#include "ir/liveness.hpp"
+#include "sys/map.hpp"
+#include "sys/set.hpp"
+#include <algorithm>
+
+namespace gbe {
+namespace ir {
+
+  /*! Longest address computation we duplicate for one load */
+  static const uint32_t maxChainSize = 16;
+
+  class LoopLoadPipeliner
+  {
+  public:
+    LoopLoadPipeliner(Function &fn, uint32_t maxLoads, uint32_t maxPressure) :
+      fn(fn), maxLoads(maxLoads), maxPressure(maxPressure) {}
+    /*! Process all the innermost loops */
+    uint32_t pipeline(void);
+  private:
+    /*! Loads we know how to issue one iteration ahead */
+    bool isPipelinable(const Instruction &insn) const;
+    /*! Pure instructions we may duplicate to compute the next address */
+    bool isChainable(const Instruction &insn) const;
+    /*! Last definition of reg in the loop body before position pos */
+    Instruction *getLastDef(uint32_t pos, Register reg) const;
+    /*! Gather the in-loop instructions computing the address of the load */
+    bool gatherChain(Instruction &load);
+    /*! Emit the address computation and the load before the block branch */
+    void emitLoad(BasicBlock &bb, LoadInstruction &load, Tuple values);
+    /*! Pipeline the loads of a single block innermost loop */
+    uint32_t pipelineLoop(const Loop &loop, const Liveness &liveness);
+    /*! Number the instructions of the loop body */
+    void buildPosition(BasicBlock &bb);
+    Function &fn;
+    uint32_t maxLoads;
+    uint32_t maxPressure;
+    vector<Instruction*> body;                      //!< Loop body in order
+    map<const Instruction*, uint32_t> position;     //!< Index in body
+    vector<Instruction*> chain;                     //!< Address computation
+    map<const Instruction*, vector<Instruction*>> srcDefs; //!< In-loop def of each source
+    map<const Instruction*, Register> renamed;      //!< New dst of the chain copies
+    set<const Instruction*> prefetchMovs;           //!< MOVs replacing the loads
+    set<const Instruction*> prefetchLoads;          //!< Loads issued one iteration ahead
+  };
+
+  bool LoopLoadPipeliner::isPipelinable(const Instruction &insn) const {
+    if (insn.getOpcode() != OP_LOAD || prefetchLoads.contains(&insn))
+      return false;
+    // Out of bound reads through a static BTI return 0, so issuing the load
+    // one more time than the original loop is harmless
+    const LoadInstruction &load = cast<LoadInstruction>(insn);
+    const AddressSpace space = load.getAddressSpace();
+    if ((space != MEM_GLOBAL && space != MEM_CONSTANT) ||
+        load.getAddressMode() != AM_StaticBti ||
+        load.isBlock())
+      return false;
+    for (uint32_t valueID = 0; valueID < load.getValueNum(); ++valueID) {
+      const Register value = load.getValue(valueID);
+      if (fn.isSpecialReg(value) || fn.isPayloadReg(value))
+        return false;
+    }
+    return true;
+  }
+
+  bool LoopLoadPipeliner::isChainable(const Instruction &insn) const {
+    // Only instructions whose sources and destination are stored in the
+    // instruction itself, the copies are renamed with setSrc/setDst
+    switch (insn.getOpcode()) {
+      case OP_LOADI: case OP_MOV: case OP_CVT:
+      case OP_ADD: case OP_SUB: case OP_MUL:
+      case OP_AND: case OP_OR: case OP_XOR:
+      case OP_SHL: case OP_SHR: case OP_ASR:
+      case OP_MUL_HI:
+        break;
+      default:
+        return false;
+    }
+    if (prefetchMovs.contains(&insn))
+      return false;
+    const Register dst = insn.getDst(0);
+    return fn.getRegisterFamily(dst) != FAMILY_BOOL &&
+           !fn.isSpecialReg(dst) && !fn.isPayloadReg(dst);
+  }
+
+  void LoopLoadPipeliner::buildPosition(BasicBlock &bb) {
+    body.clear();
+    position.clear();
+    bb.foreach([&](Instruction &insn) {
+      position[&insn] = body.size();
+      body.push_back(&insn);
+    });
+  }
+
+  Instruction *LoopLoadPipeliner::getLastDef(uint32_t pos, Register reg) const {
+    for (int32_t insnID = int32_t(pos) - 1; insnID >= 0; --insnID) {
+      Instruction *insn = body[insnID];
+      for (uint32_t dstID = 0; dstID < insn->getDstNum(); ++dstID)
+        if (insn->getDst(dstID) == reg)
+          return insn;
+    }
+    return NULL;
+  }
+
+  bool LoopLoadPipeliner::gatherChain(Instruction &load) {
+    chain.clear();
+    srcDefs.clear();
+    vector<Instruction*> worklist;
+    worklist.push_back(&load);
+    while (worklist.size() != 0) {
+      Instruction *insn = worklist.back();
+      worklist.pop_back();
+      vector<Instruction*> &defs = srcDefs[insn];
+      for (uint32_t srcID = 0; srcID < insn->getSrcNum(); ++srcID) {
+        // A source without definition before the user is loop invariant or
+        // carried by the back edge. Either way the value it holds at the end
+        // of the body is the one the next iteration starts with
+        Instruction *def = getLastDef(position[insn], insn->getSrc(srcID));
+        defs.push_back(def);
+        if (def == NULL || srcDefs.find(def) != srcDefs.end() ||
+            std::find(worklist.begin(), worklist.end(), def) != worklist.end())
+          continue;
+        if (!isChainable(*def) || chain.size() == maxChainSize)
+          return false;
+        chain.push_back(def);
+        worklist.push_back(def);
+      }
+    }
+    std::sort(chain.begin(), chain.end(),
+      [&](const Instruction *a, const Instruction *b) {
+        return position[a] < position[b];
+      });
+    return true;
+  }
+
+  void LoopLoadPipeliner::emitLoad(BasicBlock &bb, LoadInstruction &load, Tuple values) {
+    Instruction *insertPoint = bb.getLastInstruction();
+    if (insertPoint->isMemberOf<BranchInstruction>())
+      insertPoint = static_cast<Instruction*>(insertPoint->prev);
+
+    for (auto insn : chain) {
+      Instruction copy(*insn);
+      copy.setDst(0, renamed[insn]);
+      const vector<Instruction*> &defs = srcDefs[insn];
+      for (uint32_t srcID = 0; srcID < copy.getSrcNum(); ++srcID)
+        if (defs[srcID] != NULL)
+          copy.setSrc(srcID, renamed[defs[srcID]]);
+      copy.insert(insertPoint, &insertPoint);
+    }
+
+    Instruction *addressDef = srcDefs[&load][0];
+    const Register address = addressDef ? renamed[addressDef] : load.getAddressRegister();
+    Instruction prefetch = LOAD(load.getValueType(), values, address,
+                                load.getAddressSpace(), load.getValueNum(),
+                                load.isAligned(), AM_StaticBti,
+                                load.getSurfaceIndex());
+    prefetch.insert(insertPoint, &insertPoint);
+    // The body scan reaches it when the loop has no store, it must not be
+    // pipelined again
+    prefetchLoads.insert(insertPoint);
+  }
+
+  uint32_t LoopLoadPipeliner::pipelineLoop(const Loop &loop, const Liveness &liveness) {
+    if (loop.bbs.size() != 1)
+      return 0;
+
+    // The body must branch back to itself and have a dedicated preheader
+    BasicBlock &bb = fn.getBlock(loop.bbs[0]);
+    BasicBlock &preheader = fn.getBlock(loop.preheader);
+    const Instruction *last = bb.getLastInstruction();
+    if (last->getOpcode() != OP_BRA ||
+        cast<BranchInstruction>(*last).getLabelIndex() != loop.bbs[0])
+      return 0;
+    if (loop.preheader == loop.bbs[0] ||
+        preheader.getSuccessorSet().size() != 1 ||
+        preheader.getSuccessorSet().contains(&bb) == false)
+      return 0;
+
+    uint32_t pressure = getLoopPressure(fn, loop, liveness);
+    uint32_t pipelinedNum = 0;
+    buildPosition(bb);
+    for (uint32_t insnID = 0; insnID < body.size() && pipelinedNum < maxLoads; ++insnID) {
+      Instruction &insn = *body[insnID];
+      // Issuing the load earlier must not move it above a store, a barrier
+      // or an atomic of the next iteration
+      if (insn.hasSideEffect() ||
+          insn.getOpcode() == OP_WORKGROUP ||
+          insn.getOpcode() == OP_CALC_TIMESTAMP)
+        break;
+      if (!isPipelinable(insn) || !gatherChain(insn))
+        continue;
+
+      // The prefetched values are alive across the whole loop
+      LoadInstruction &load = cast<LoadInstruction>(insn);
+      uint32_t weight = 0;
+      for (uint32_t valueID = 0; valueID < load.getValueNum(); ++valueID)
+        weight += getRegPressureWeight(fn, load.getValue(valueID));
+      if (pressure + weight > maxPressure)
+        break;
+      pressure += weight;
+
+      renamed.clear();
+      for (auto def : chain) {
+        const Register dst = def->getDst(0);
+        renamed[def] = fn.newRegister(fn.getRegisterFamily(dst), fn.isUniformRegister(dst));
+      }
+      vector<Register> prefetched;
+      for (uint32_t valueID = 0; valueID < load.getValueNum(); ++valueID) {
+        const Register value = load.getValue(valueID);
+        prefetched.push_back(fn.newRegister(fn.getRegisterFamily(value),
+                                            fn.isUniformRegister(value)));
+      }
+      const Tuple values = fn.newTuple(&prefetched[0], prefetched.size());
+
+      // First iteration in the preheader, next iteration at the end of the body
+      emitLoad(preheader, load, values);
+      emitLoad(bb, load, values);
+
+      // The original load just picks the prefetched values
+      const Type type = load.getValueType();
+      Instruction *insertPoint = &insn;
+      for (uint32_t valueID = 0; valueID < load.getValueNum(); ++valueID) {
+        Instruction mov = MOV(type, load.getValue(valueID), prefetched[valueID]);
+        mov.insert(insertPoint, &insertPoint);
+        prefetchMovs.insert(insertPoint);
+      }
+      insn.remove();
+      pipelinedNum++;
+      buildPosition(bb);
+      insnID = position[insertPoint];
+    }
+    return pipelinedNum;
+  }
+
+  uint32_t LoopLoadPipeliner::pipeline(void) {
+    const vector<Loop *> &loops = fn.getLoops();
+    if (loops.size() == 0 || maxLoads == 0)
+      return 0;
+    Liveness liveness(fn);
+    uint32_t pipelinedNum = 0;
+    for (uint32_t loopID = 0; loopID < loops.size(); ++loopID) {
+      bool innermost = true;
+      for (auto loop : loops)
+        if (loop->parent == int(loopID))
+          innermost = false;
+      if (innermost)
+        pipelinedNum += pipelineLoop(*loops[loopID], liveness);
+    }
+    return pipelinedNum;
+  }
+
+  uint32_t pipelineLoopLoads(Function &fn, uint32_t maxLoads, uint32_t maxPressure) {
+    LoopLoadPipeliner pipeliner(fn, maxLoads, maxPressure);
+    return pipeliner.pipeline();
+  }
+
+} /* namespace ir */
+} /* namespace gbe */
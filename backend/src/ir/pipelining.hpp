@@ -0,0 +1,58 @@
+/*
+ * Copyright © 2017 Intel Corporation
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library. If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+/**
+ * \file pipelining.hpp
+ *  Software pipelining of the loads of innermost loops on GEN IR
+ */
+
+#ifndef __GBE_IR_PIPELINING_HPP__
+#define __GBE_IR_PIPELINING_HPP__
+
+#include "sys/platform.hpp"
+
+namespace gbe {
+namespace ir {
+
+  // Structure to update
+  class Function;
+
+  /*! Gen threads stall on the first use of a loaded value. In a loop like
+   *  "for (...) sum += a[i] * b[i];" the sends are issued at the top of the
+   *  body and the math waits for them right away on every iteration.
+   *
+   *  For innermost loops made of a single block, this pass issues the loads
+   *  of iteration i+1 at the end of iteration i (and the ones of the first
+   *  iteration in the preheader) together with their address computation.
+   *  The original load is replaced by a MOV from the prefetched values, so
+   *  the memory latency overlaps the rest of the body. Only global and
+   *  constant loads through a static BTI which are not preceded by an
+   *  instruction with side effect in the loop body are handled: the load
+   *  issued by the last iteration is a bounds checked speculative read whose
+   *  result is never used.
+   *
+   *  At most maxLoads loads are pipelined per loop and pipelining stops when
+   *  the estimated number of values alive in the loop reaches maxPressure.
+   *  Returns the number of pipelined loads.
+   */
+  uint32_t pipelineLoopLoads(Function &fn, uint32_t maxLoads, uint32_t maxPressure);
+
+} /* namespace ir */
+} /* namespace gbe */
+
+#endif /* __GBE_IR_PIPELINING_HPP__ */
@@ -170,6 +170,41 @@ OVERLOADABLE short f32to16_rtz(float f) {
     return s;
 }
 
+// The aligned variants read and write the whole vector with one message and
+// convert the elements afterwards
+INLINE_OVERLOADABLE float2 f16to32_vec(short2 h) {
+  return (float2)(__gen_ocl_f16to32(h.s0), __gen_ocl_f16to32(h.s1));
+}
+INLINE_OVERLOADABLE float4 f16to32_vec(short4 h) {
+  return (float4)(f16to32_vec(h.lo), f16to32_vec(h.hi));
+}
+INLINE_OVERLOADABLE float8 f16to32_vec(short8 h) {
+  return (float8)(f16to32_vec(h.lo), f16to32_vec(h.hi));
+}
+INLINE_OVERLOADABLE float16 f16to32_vec(short16 h) {
+  return (float16)(f16to32_vec(h.lo), f16to32_vec(h.hi));
+}
+
+#define DECL_HALF_CVT_ROUND(ROUND, FUNC) \
+INLINE_OVERLOADABLE short2 f32to16##ROUND##_vec(float2 f) { \
+  return (short2)(FUNC(f.s0), FUNC(f.s1)); \
+} \
+INLINE_OVERLOADABLE short4 f32to16##ROUND##_vec(float4 f) { \
+  return (short4)(f32to16##ROUND##_vec(f.lo), f32to16##ROUND##_vec(f.hi)); \
+} \
+INLINE_OVERLOADABLE short8 f32to16##ROUND##_vec(float8 f) { \
+  return (short8)(f32to16##ROUND##_vec(f.lo), f32to16##ROUND##_vec(f.hi)); \
+} \
+INLINE_OVERLOADABLE short16 f32to16##ROUND##_vec(float16 f) { \
+  return (short16)(f32to16##ROUND##_vec(f.lo), f32to16##ROUND##_vec(f.hi)); \
+}
+
+DECL_HALF_CVT_ROUND(  , __gen_ocl_f32to16)
+DECL_HALF_CVT_ROUND(_rte, __gen_ocl_f32to16)
+DECL_HALF_CVT_ROUND(_rtz, f32to16_rtz)
+DECL_HALF_CVT_ROUND(_rtp, f32to16_rtp)
+DECL_HALF_CVT_ROUND(_rtn, f32to16_rtn)
+
 #define DECL_HALF_LD_SPACE(SPACE) \
 OVERLOADABLE float vload_half(size_t offset, const SPACE half *p) { \
   return __gen_ocl_f16to32(*(SPACE short *)(p + offset)); \
@@ -182,8 +217,7 @@ OVERLOADABLE float2 vload_half2(size_t offset, const SPACE half *p) { \
                   vload_half(offset*2 + 1, p)); \
 } \
 OVERLOADABLE float2 vloada_half2(size_t offset, const SPACE half *p) { \
-  return (float2)(vloada_half(offset*2, p), \
-                  vloada_half(offset*2 + 1, p)); \
+  return f16to32_vec(*(SPACE short2 *)(p + offset*2)); \
 } \
 OVERLOADABLE float3 vload_half3(size_t offset, const SPACE half *p) { \
   return (float3)(vload_half(offset*3, p), \
@@ -191,8 +225,7 @@ OVERLOADABLE float3 vload_half3(size_t offset, const SPACE half *p) { \
                   vload_half(offset*3 + 2, p)); \
 } \
 OVERLOADABLE float3 vloada_half3(size_t offset, const SPACE half *p) { \
-  return (float3)(vload_half(offset*4, p), \
-                  vload_half(offset*4 + 1, p), \
+  return (float3)(f16to32_vec(*(SPACE short2 *)(p + offset*4)), \
                   vload_half(offset*4 + 2, p)); \
 } \
 OVERLOADABLE float4 vload_half4(size_t offset, const SPACE half *p) { \
@@ -200,24 +233,21 @@ OVERLOADABLE float4 vload_half4(size_t offset, const SPACE half *p) { \
                   vload_half2(offset*2 + 1, p)); \
 } \
 OVERLOADABLE float4 vloada_half4(size_t offset, const SPACE half *p) { \
-  return (float4)(vloada_half2(offset*2, p), \
-                  vloada_half2(offset*2 + 1, p)); \
+  return f16to32_vec(*(SPACE short4 *)(p + offset*4)); \
 } \
 OVERLOADABLE float8 vload_half8(size_t offset, const SPACE half *p) { \
   return (float8)(vload_half4(offset*2, p), \
                   vload_half4(offset*2 + 1, p)); \
 } \
 OVERLOADABLE float8 vloada_half8(size_t offset, const SPACE half *p) { \
-  return (float8)(vloada_half4(offset*2, p), \
-                  vloada_half4(offset*2 + 1, p)); \
+  return f16to32_vec(*(SPACE short8 *)(p + offset*8)); \
 } \
 OVERLOADABLE float16 vload_half16(size_t offset, const SPACE half *p) { \
   return (float16)(vload_half8(offset*2, p), \
                    vload_half8(offset*2 + 1, p)); \
 }\
 OVERLOADABLE float16 vloada_half16(size_t offset, const SPACE half *p) { \
-  return (float16)(vloada_half8(offset*2, p), \
-                   vloada_half8(offset*2 + 1, p)); \
+  return f16to32_vec(*(SPACE short16 *)(p + offset*16)); \
 }\
 
 #define DECL_HALF_ST_SPACE_ROUND(SPACE, ROUND, FUNC) \
@@ -232,7 +262,7 @@ OVERLOADABLE void vstore_half2##ROUND(float2 data, size_t offset, SPACE half *p)
   vstore_half##ROUND(data.hi, offset*2 + 1, p); \
 } \
 OVERLOADABLE void vstorea_half2##ROUND(float2 data, size_t offset, SPACE half *p) { \
-  vstore_half2##ROUND(data, offset, p); \
+  *(SPACE short2 *)(p + offset*2) = f32to16##ROUND##_vec(data); \
 } \
 OVERLOADABLE void vstore_half3##ROUND(float3 data, size_t offset, SPACE half *p) { \
   vstore_half##ROUND(data.s0, offset*3, p); \
@@ -240,8 +270,7 @@ OVERLOADABLE void vstore_half3##ROUND(float3 data, size_t offset, SPACE half *p)
   vstore_half##ROUND(data.s2, offset*3 + 2, p); \
 } \
 OVERLOADABLE void vstorea_half3##ROUND(float3 data, size_t offset, SPACE half *p) { \
-  vstore_half##ROUND(data.s0, offset*4, p); \
-  vstore_half##ROUND(data.s1, offset*4 + 1, p); \
+  *(SPACE short2 *)(p + offset*4) = f32to16##ROUND##_vec(data.s01); \
   vstore_half##ROUND(data.s2, offset*4 + 2, p); \
 } \
 OVERLOADABLE void vstore_half4##ROUND(float4 data, size_t offset, SPACE half *p) { \
@@ -249,21 +278,21 @@ OVERLOADABLE void vstore_half4##ROUND(float4 data, size_t offset, SPACE half *p)
   vstore_half2##ROUND(data.hi, offset*2 + 1, p); \
 } \
 OVERLOADABLE void vstorea_half4##ROUND(float4 data, size_t offset, SPACE half *p) { \
-  vstore_half4##ROUND(data, offset, p); \
+  *(SPACE short4 *)(p + offset*4) = f32to16##ROUND##_vec(data); \
 } \
 OVERLOADABLE void vstore_half8##ROUND(float8 data, size_t offset, SPACE half *p) { \
   vstore_half4##ROUND(data.lo, offset*2, p); \
   vstore_half4##ROUND(data.hi, offset*2 + 1, p); \
 } \
 OVERLOADABLE void vstorea_half8##ROUND(float8 data, size_t offset, SPACE half *p) { \
-  vstore_half8##ROUND(data, offset, p); \
+  *(SPACE short8 *)(p + offset*8) = f32to16##ROUND##_vec(data); \
 } \
 OVERLOADABLE void vstore_half16##ROUND(float16 data, size_t offset, SPACE half *p) { \
   vstore_half8##ROUND(data.lo, offset*2, p); \
   vstore_half8##ROUND(data.hi, offset*2 + 1, p); \
 } \
 OVERLOADABLE void vstorea_half16##ROUND(float16 data, size_t offset, SPACE half *p) { \
-  vstore_half16##ROUND(data, offset, p); \
+  *(SPACE short16 *)(p + offset*16) = f32to16##ROUND##_vec(data); \
 }
 
 #define DECL_HALF_ST_SPACE(SPACE) \
@@ -282,3 +311,4 @@ DECL_HALF_ST_SPACE(__generic)
 #undef DECL_HALF_LD_SPACE
 #undef DECL_HALF_ST_SPACE
 #undef DECL_HALF_ST_SPACE_ROUND
+#undef DECL_HALF_CVT_ROUND
@@ -79,6 +79,8 @@
 #include "ir/half.hpp"
 #include "ir/liveness.hpp"
 #include "ir/value.hpp"
+#include "ir/licm.hpp"
+#include "ir/pipelining.hpp"
 #include "sys/set.hpp"
 #include "sys/cvar.hpp"
 #include "backend/program.h"
@@ -104,6 +106,20 @@ using namespace llvm;
 namespace gbe
 {
   extern bool OCL_DEBUGINFO; // first defined by calling BVAR in program.cpp
+  extern int32_t OCL_SINGLE_THREAD_WORKGROUP; // first defined by calling BVAR in gen_insn_selection.cpp
+
+  /*! The work group fits in one thread whatever SIMD width is picked later,
+   *  the instruction selection then lowers the work group functions to the
+   *  sub group ones, without SLM */
+  static bool isSingleThreadWorkGroup(const ir::Function &f)
+  {
+    if (!OCL_SINGLE_THREAD_WORKGROUP)
+      return false;
+    const size_t *wgSize = f.getCompileWorkGroupSize();
+    const size_t itemNum = wgSize[0] * wgSize[1] * wgSize[2];
+    return itemNum != 0 && itemNum <= 8;
+  }
+
   /*! Gen IR manipulates only scalar types */
   static bool isScalarType(const Type *type)
   {
@@ -2948,6 +2964,11 @@ namespace gbe
 
   BVAR(OCL_OPTIMIZE_PHI_MOVES, true);
   BVAR(OCL_OPTIMIZE_LOADI, true);
+  BVAR(OCL_OPTIMIZE_LICM, true);
+  IVAR(OCL_LICM_MAX_PRESSURE, 0, 48, 256);
+  BVAR(OCL_OPTIMIZE_PIPELINE_LOADS, true);
+  IVAR(OCL_PIPELINE_MAX_LOADS, 0, 4, 16);
+  IVAR(OCL_PIPELINE_MAX_PRESSURE, 0, 40, 256);
 
   static const Instruction *getInstructionUseLocal(const Value *v) {
     // Local variable can only be used in one kernel function. So, if we find
@@ -3250,6 +3271,10 @@ namespace gbe
       this->postPhiCopyOptimization(liveness, fn, replaceMap, redundantPhiCopyMap);
       this->removeMOVs(liveness, fn);
     }
+    if (OCL_OPTIMIZE_LICM)
+      ir::hoistLoopInvariant(fn, OCL_LICM_MAX_PRESSURE);
+    if (OCL_OPTIMIZE_PIPELINE_LOADS)
+      ir::pipelineLoopLoads(fn, OCL_PIPELINE_MAX_LOADS, OCL_PIPELINE_MAX_PRESSURE);
   }
 
   void GenWriter::regAllocateReturnInst(ReturnInst &I) {}
@@ -3270,6 +3295,23 @@ namespace gbe
     this->newRegister(&I);
   }
 
+  /*! The floating point operation may be fused with the next one, either
+   *  through its fast math flags or -cl-mad-enable */
+  static bool allowFPContract(const Instruction &I) {
+    if (!isa<FPMathOperator>(&I))
+      return false;
+    const Function *F = I.getParent()->getParent();
+    if (F->getFnAttribute("less-precise-fpmad").getValueAsString() == "true")
+      return true;
+#if LLVM_VERSION_MAJOR >= 6
+    return I.isFast() || I.hasAllowContract();
+#elif LLVM_VERSION_MAJOR >= 5
+    return I.hasUnsafeAlgebra() || I.hasAllowContract();
+#else
+    return I.hasUnsafeAlgebra();
+#endif
+  }
+
   void GenWriter::emitBinaryOperator(Instruction &I) {
 #if GBE_DEBUG
     GBE_ASSERT(I.getType()->isPointerTy() == false);
@@ -3343,6 +3385,13 @@ namespace gbe
       case Instruction::AShr: ctx.ASR(type, dst, src0, src1); break;
       default: NOT_SUPPORTED;
     }
+
+    // Let the instruction selection form MADs from the contractable MUL/ADD
+    if (allowFPContract(I)) {
+      ir::Instruction *insn = ctx.getBlock()->getLastInstruction();
+      if (insn && insn->isMemberOf<ir::BinaryInstruction>())
+        ir::cast<ir::BinaryInstruction>(*insn).setAllowContract(true);
+    }
   }
 
   void GenWriter::regAllocateICmpInst(ICmpInst &I) {
@@ -3954,11 +4003,23 @@ namespace gbe
         break;
       case GEN_OCL_FORCE_SIMD8:
       case GEN_OCL_FORCE_SIMD16:
+        ctx.getFunction().setUseSLM(true);
+        break;
       case GEN_OCL_LBARRIER:
       case GEN_OCL_GBARRIER:
       case GEN_OCL_BARRIER:
-        ctx.getFunction().setUseSLM(true);
+      {
+        // The instruction selection drops the barriers of a single thread
+        // work group, but the ones fencing images
+        bool imageFence = false;
+        if (genIntrinsicID == GEN_OCL_BARRIER) {
+          Constant *CPV = dyn_cast<Constant>(I.getArgOperand(0));
+          imageFence = CPV != NULL && (processConstantImm(CPV).getIntegerValue() & 0x4);
+        }
+        if (imageFence || !isSingleThreadWorkGroup(ctx.getFunction()))
+          ctx.getFunction().setUseSLM(true);
         break;
+      }
       case GEN_OCL_WRITE_IMAGE_I:
       case GEN_OCL_WRITE_IMAGE_UI:
       case GEN_OCL_WRITE_IMAGE_F:
@@ -4359,7 +4420,11 @@ namespace gbe
   void GenWriter::emitWorkGroupInst(CallInst &I, CallSite &CS, ir::WorkGroupOps opcode) {
     ir::Function &f = ctx.getFunction();
 
-    if (f.getwgBroadcastSLM() < 0 && opcode == ir::WORKGROUP_OP_BROADCAST) {
+    if (isSingleThreadWorkGroup(f)) {
+      /* No SLM for the thread communication */
+    }
+
+    else if (f.getwgBroadcastSLM() < 0 && opcode == ir::WORKGROUP_OP_BROADCAST) {
       uint32_t mapSize = 8;
       f.setUseSLM(true);
       uint32_t oldSlm = f.getSLMSize();
@@ -0,0 +1,281 @@
+/*
+ * Copyright © 2017 Intel Corporation
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * \file llvm_int_division.cpp
+ *
+ *  The 32-bit integer division runs on the math unit at reduced width and the
+ *  64-bit one is a long emulated sequence. This pass replaces the divisions
+ *  and remainders by:
+ *  - a constant: the usual multiply by a magic number and shift, for 32-bit
+ *    and 64-bit types. The signed division by a power of 2 becomes shifts.
+ *  - a uniform 32-bit value (kernel argument, group sizes, ...): the
+ *    reciprocal (2^32 - 1) / d is computed once where d is defined, every lane
+ *    then only does a mul_hi, a multiply and two corrections.
+ */
+
+#include "llvm_includes.hpp"
+
+#include "llvm/llvm_gen_backend.hpp"
+#include "sys/map.hpp"
+
+using namespace llvm;
+
+namespace gbe {
+  class GenIntDivision : public FunctionPass
+  {
+  public:
+    static char ID;
+    GenIntDivision() : FunctionPass(ID) {}
+
+    virtual bool runOnFunction(Function &F);
+
+#if LLVM_VERSION_MAJOR * 10 + LLVM_VERSION_MINOR >= 40
+    virtual StringRef getPassName() const
+#else
+    virtual const char *getPassName() const
+#endif
+    {
+      return "Strength reduce the integer divisions for Gen";
+    }
+
+  private:
+    Value *mulHi(IRBuilder<> &builder, Value *a, Value *b, bool isSigned);
+    Value *reciprocal(Value *d, bool isSigned);
+    Value *divideByConstant(IRBuilder<> &builder, BinaryOperator *I);
+    Value *divideByUniform(IRBuilder<> &builder, BinaryOperator *I);
+
+    Module *mod;
+    /*! Reciprocal of the uniform divisors, computed once */
+    map<std::pair<Value *, bool>, Value *> reciprocals;
+  };
+
+  char GenIntDivision::ID = 0;
+
+  // Work item functions returning the same value for the whole work group
+  static bool isUniformBuiltin(const StringRef &name) {
+    static const char *uniformBuiltins[] = {
+      "__gen_ocl_get_group_id",
+      "__gen_ocl_get_num_groups",
+      "__gen_ocl_get_local_size",
+      "__gen_ocl_get_enqueued_local_size",
+      "__gen_ocl_get_global_size",
+      "__gen_ocl_get_global_offset",
+      "__gen_ocl_get_work_dim"
+    };
+    for (auto builtin : uniformBuiltins)
+      if (name.startswith(builtin))
+        return true;
+    return false;
+  }
+
+  // A simple version of the uniform analysis of the backend: 32-bit values
+  // only computed from the kernel arguments and the uniform builtins.
+  static bool isUniformValue(Value *V, uint32_t depth) {
+    if (isa<Argument>(V) || isa<Constant>(V))
+      return true;
+    Instruction *I = dyn_cast<Instruction>(V);
+    if (I == NULL || depth == 0 || I->getType()->isIntegerTy(64))
+      return false;
+    if (CallInst *call = dyn_cast<CallInst>(I)) {
+      Function *F = call->getCalledFunction();
+      return F != NULL && isUniformBuiltin(F->getName());
+    }
+    if (!isa<BinaryOperator>(I) && !isa<CastInst>(I) &&
+        !isa<SelectInst>(I) && !isa<CmpInst>(I))
+      return false;
+    for (Value *op : I->operands())
+      if (!isUniformValue(op, depth - 1))
+        return false;
+    return true;
+  }
+
+  Value *GenIntDivision::mulHi(IRBuilder<> &builder, Value *a, Value *b, bool isSigned) {
+    Type *type = a->getType();
+    const char *name;
+    if (type->isIntegerTy(64))
+      name = isSigned ? "_Z16__gen_ocl_mul_hill" : "_Z16__gen_ocl_mul_himm";
+    else
+      name = isSigned ? "_Z16__gen_ocl_mul_hiii" : "_Z16__gen_ocl_mul_hijj";
+    Function *F = mod->getFunction(name);
+    if (F == NULL) {
+      Type *params[] = {type, type};
+      F = Function::Create(FunctionType::get(type, params, false),
+                           GlobalValue::ExternalLinkage, name, mod);
+    }
+    Value *args[] = {a, b};
+    return builder.CreateCall(F, args);
+  }
+
+  Value *GenIntDivision::divideByConstant(IRBuilder<> &builder, BinaryOperator *I) {
+    const Instruction::BinaryOps op = I->getOpcode();
+    const bool isSigned = op == Instruction::SDiv || op == Instruction::SRem;
+    const bool isRem = op == Instruction::URem || op == Instruction::SRem;
+    const APInt &d = cast<ConstantInt>(I->getOperand(1))->getValue();
+    const uint32_t bits = d.getBitWidth();
+    Value *n = I->getOperand(0);
+    Type *type = n->getType();
+    Value *q = NULL;
+
+    // 0 and 1 are left to the other passes, unsigned powers of 2 are shifts
+    // and masks already
+    if (d == 0 || d == 1 || (isSigned && d.isAllOnesValue()))
+      return NULL;
+    if (!isSigned && d.isPowerOf2())
+      return NULL;
+
+    if (isSigned) {
+      const APInt absD = d.abs();
+      if (absD.isPowerOf2()) {
+        // Round toward zero: add d - 1 to the negative numerators
+        const uint32_t k = absD.logBase2();
+        Value *sign = builder.CreateAShr(n, bits - 1);
+        Value *bias = builder.CreateLShr(sign, bits - k);
+        q = builder.CreateAShr(builder.CreateAdd(n, bias), k);
+      } else {
+        APInt::ms magics = d.magic();
+        q = mulHi(builder, n, ConstantInt::get(type, magics.m), true);
+        if (d.isStrictlyPositive() && magics.m.isNegative())
+          q = builder.CreateAdd(q, n);
+        else if (d.isNegative() && magics.m.isStrictlyPositive())
+          q = builder.CreateSub(q, n);
+        if (magics.s > 0)
+          q = builder.CreateAShr(q, magics.s);
+        q = builder.CreateAdd(q, builder.CreateLShr(q, bits - 1));
+      }
+      if (d.isNegative() && absD.isPowerOf2())
+        q = builder.CreateNeg(q);
+    } else {
+      APInt::mu magics = d.magicu();
+      q = mulHi(builder, n, ConstantInt::get(type, magics.m), false);
+      if (magics.a) {
+        Value *t = builder.CreateLShr(builder.CreateSub(n, q), 1);
+        q = builder.CreateAdd(t, q);
+        if (magics.s > 1)
+          q = builder.CreateLShr(q, magics.s - 1);
+      } else if (magics.s > 0)
+        q = builder.CreateLShr(q, magics.s);
+    }
+
+    if (!isRem)
+      return q;
+    return builder.CreateSub(n, builder.CreateMul(q, I->getOperand(1)));
+  }
+
+  // (2^32 - 1) / |d| computed right after d, d == 0 gives a reciprocal too
+  // as the division may be guarded by a test of d.
+  Value *GenIntDivision::reciprocal(Value *d, bool isSigned) {
+    auto it = reciprocals.find(std::make_pair(d, isSigned));
+    if (it != reciprocals.end())
+      return it->second;
+
+    Instruction *insertPt;
+    if (Instruction *I = dyn_cast<Instruction>(d))
+      insertPt = I->getNextNode();
+    else
+      insertPt = &*cast<Argument>(d)->getParent()->getEntryBlock().getFirstInsertionPt();
+    IRBuilder<> builder(insertPt);
+    Type *type = d->getType();
+    Value *zero = ConstantInt::get(type, 0);
+    Value *absD = d;
+    if (isSigned)
+      absD = builder.CreateSelect(builder.CreateICmpSLT(d, zero), builder.CreateNeg(d), d);
+    Value *safeD = builder.CreateSelect(builder.CreateICmpEQ(absD, zero),
+                                        ConstantInt::get(type, 1), absD);
+    Value *rcp = builder.CreateUDiv(ConstantInt::get(type, -1), safeD);
+    reciprocals[std::make_pair(d, isSigned)] = rcp;
+    return rcp;
+  }
+
+  // q = mul_hi(n, rcp) is at most 2 below n / d, two corrections fix it
+  Value *GenIntDivision::divideByUniform(IRBuilder<> &builder, BinaryOperator *I) {
+    const Instruction::BinaryOps op = I->getOpcode();
+    const bool isSigned = op == Instruction::SDiv || op == Instruction::SRem;
+    const bool isRem = op == Instruction::URem || op == Instruction::SRem;
+    Value *n = I->getOperand(0);
+    Value *d = I->getOperand(1);
+    Type *type = n->getType();
+    Value *rcp = reciprocal(d, isSigned);
+    Value *zero = ConstantInt::get(type, 0);
+    Value *one = ConstantInt::get(type, 1);
+
+    Value *absN = n, *absD = d;
+    if (isSigned) {
+      absN = builder.CreateSelect(builder.CreateICmpSLT(n, zero), builder.CreateNeg(n), n);
+      absD = builder.CreateSelect(builder.CreateICmpSLT(d, zero), builder.CreateNeg(d), d);
+    }
+    Value *q = mulHi(builder, absN, rcp, false);
+    Value *r = builder.CreateSub(absN, builder.CreateMul(q, absD));
+    for (int i = 0; i < 2; ++i) {
+      Value *over = builder.CreateICmpUGE(r, absD);
+      q = builder.CreateSelect(over, builder.CreateAdd(q, one), q);
+      r = builder.CreateSelect(over, builder.CreateSub(r, absD), r);
+    }
+
+    Value *result = isRem ? r : q;
+    if (isSigned) {
+      // The quotient is negative when the signs differ, the remainder takes
+      // the sign of n
+      Value *sign = isRem ? n : builder.CreateXor(n, d);
+      sign = builder.CreateAShr(sign, 31);
+      result = builder.CreateSub(builder.CreateXor(result, sign), sign);
+    }
+    return result;
+  }
+
+  bool GenIntDivision::runOnFunction(Function &F) {
+    mod = F.getParent();
+    reciprocals.clear();
+
+    SmallVector<BinaryOperator *, 16> divisions;
+    for (BasicBlock &BB : F)
+      for (Instruction &I : BB) {
+        BinaryOperator *binary = dyn_cast<BinaryOperator>(&I);
+        if (binary == NULL)
+          continue;
+        const Instruction::BinaryOps op = binary->getOpcode();
+        if (op != Instruction::UDiv && op != Instruction::SDiv &&
+            op != Instruction::URem && op != Instruction::SRem)
+          continue;
+        if (binary->getType()->isIntegerTy(32) || binary->getType()->isIntegerTy(64))
+          divisions.push_back(binary);
+      }
+
+    bool changed = false;
+    for (auto I : divisions) {
+      IRBuilder<> builder(I);
+      Value *d = I->getOperand(1);
+      Value *result = NULL;
+      if (isa<ConstantInt>(d))
+        result = divideByConstant(builder, I);
+      // 64-bit values are never uniform in the backend
+      else if (I->getType()->isIntegerTy(32) && !isa<Constant>(d) && isUniformValue(d, 8))
+        result = divideByUniform(builder, I);
+      if (result == NULL)
+        continue;
+      result->takeName(I);
+      I->replaceAllUsesWith(result);
+      I->eraseFromParent();
+      changed = true;
+    }
+    return changed;
+  }
+
+  FunctionPass *createIntDivisionPass() {
+    return new GenIntDivision();
+  }
+} /* namespace gbe */
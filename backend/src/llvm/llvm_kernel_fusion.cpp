@@ -0,0 +1,276 @@
+/*
+ * Copyright © 2017 Intel Corporation
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library. If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+/**
+ * \file llvm_kernel_fusion.cpp
+ *
+ * Build the module of a kernel which runs a sequence of kernels one after the
+ * other for each work item. The modules of the programs are linked together,
+ * the kernels become always inline functions and the new kernel calls them in
+ * order. The usual inlining and GVN of llvmToGen then forward the values
+ * stored by a kernel to the loads of the next ones.
+ */
+
+#include "llvm_includes.hpp"
+#include "llvm-c/Core.h"
+#include "llvm-c/BitReader.h"
+#include "llvm-c/BitWriter.h"
+#include "llvm/llvm_gen_backend.hpp"
+#include "llvm/llvm_to_gen.hpp"
+#include <sstream>
+#include <vector>
+
+using namespace llvm;
+
+namespace gbe
+{
+#if LLVM_VERSION_MAJOR * 10 + LLVM_VERSION_MINOR >= 39
+  /*! Per argument metadata the backend reads from the kernels */
+  static const char *kernelArgMD[] = {
+    "kernel_arg_addr_space",
+    "kernel_arg_access_qual",
+    "kernel_arg_type",
+    "kernel_arg_base_type",
+    "kernel_arg_type_qual",
+    "kernel_arg_name"
+  };
+  static const uint32_t kernelArgMDNum = sizeof(kernelArgMD) / sizeof(kernelArgMD[0]);
+
+  /*! Per kernel metadata, the first kernel of the sequence defining it wins */
+  static const char *kernelMD[] = {
+    "reqd_work_group_size",
+    "work_group_size_hint",
+    "vec_type_hint",
+    "intel_reqd_sub_group_size"
+  };
+  static const uint32_t kernelMDNum = sizeof(kernelMD) / sizeof(kernelMD[0]);
+
+  static std::string modulePrefix(uint32_t moduleID) {
+    std::ostringstream prefix;
+    prefix << "__fused" << moduleID << "_";
+    return prefix.str();
+  }
+
+  /*! Two programs may define the same kernels or helper functions, give the
+   *  definitions of each module its own prefix before linking */
+  static void prefixDefinitions(Module &mod, const std::string &prefix) {
+    for (Function &F : mod)
+      if (!F.isDeclaration() && !F.hasLocalLinkage())
+        F.setName(prefix + F.getName().str());
+    for (GlobalVariable &GV : mod.globals())
+      if (!GV.isDeclaration() && !GV.hasLocalLinkage())
+        GV.setName(prefix + GV.getName().str());
+  }
+
+  /*! Copy the module into ctx through its bitcode */
+  static Module *copyModule(LLVMContext &ctx, const Module *src) {
+    LLVMModuleRef modRef;
+    LLVMMemoryBufferRef buffer = LLVMWriteBitcodeToMemoryBuffer(wrap(const_cast<Module*>(src)));
+    const bool failed = LLVMParseBitcodeInContext2(wrap(&ctx), buffer, &modRef);
+    LLVMDisposeMemoryBuffer(buffer);
+    return failed ? NULL : unwrap(modRef);
+  }
+
+  /*! The kernel becomes a plain function inlined in the fused kernel */
+  static void demoteKernel(Function &F) {
+    for (uint32_t i = 0; i < kernelArgMDNum; ++i)
+      F.setMetadata(kernelArgMD[i], NULL);
+    for (uint32_t i = 0; i < kernelMDNum; ++i)
+      F.setMetadata(kernelMD[i], NULL);
+    F.setCallingConv(CallingConv::SPIR_FUNC);
+    F.setLinkage(GlobalValue::InternalLinkage);
+    F.removeFnAttr(Attribute::NoInline);
+    F.addFnAttr(Attribute::AlwaysInline);
+    for (User *user : F.users())
+      if (CallInst *call = dyn_cast<CallInst>(user))
+        call->setCallingConv(CallingConv::SPIR_FUNC);
+  }
+
+  static Module *buildFusedModule(LLVMContext &ctx, const void **modules,
+                                  const char **kernelNames, uint32_t kernelNum,
+                                  const uint32_t *argMap, uint32_t fusedArgNum,
+                                  const uint8_t *noAlias, const char *fusedName,
+                                  std::string &errors)
+  {
+    // Link every program once
+    std::vector<const void*> uniqueModules;
+    std::vector<uint32_t> moduleIDs;
+    for (uint32_t kernelID = 0; kernelID < kernelNum; ++kernelID) {
+      if (modules[kernelID] == NULL) {
+        errors = std::string("no LLVM module kept for kernel ") + kernelNames[kernelID];
+        return NULL;
+      }
+      uint32_t moduleID = 0;
+      while (moduleID < uniqueModules.size() && uniqueModules[moduleID] != modules[kernelID])
+        moduleID++;
+      if (moduleID == uniqueModules.size())
+        uniqueModules.push_back(modules[kernelID]);
+      moduleIDs.push_back(moduleID);
+    }
+
+    Module *fused = NULL;
+    for (uint32_t moduleID = 0; moduleID < uniqueModules.size(); ++moduleID) {
+      Module *mod = copyModule(ctx, (const Module*) uniqueModules[moduleID]);
+      if (mod == NULL) {
+        errors = "can not copy the module of a program";
+        delete fused;
+        return NULL;
+      }
+      prefixDefinitions(*mod, modulePrefix(moduleID));
+      if (fused == NULL)
+        fused = mod;
+      else if (LLVMLinkModules2(wrap(fused), wrap(mod))) {
+        errors = "can not link the modules of the programs";
+        delete fused;
+        return NULL;
+      }
+    }
+
+    // Arguments of the fused kernel: type and metadata of the first kernel
+    // argument bound to each of them
+    std::vector<Function*> kernels;
+    std::vector<Type*> argTypes(fusedArgNum, (Type*) NULL);
+    std::vector<std::vector<Metadata*>> argMD(kernelArgMDNum,
+                                              std::vector<Metadata*>(fusedArgNum, (Metadata*) NULL));
+    MDNode *attrMD[kernelMDNum] = {NULL};
+    uint32_t argID = 0;
+    for (uint32_t kernelID = 0; kernelID < kernelNum; ++kernelID) {
+      Function *F = fused->getFunction(modulePrefix(moduleIDs[kernelID]) + kernelNames[kernelID]);
+      if (F == NULL || !isKernelFunction(*F)) {
+        errors = std::string("can not find kernel ") + kernelNames[kernelID];
+        delete fused;
+        return NULL;
+      }
+      kernels.push_back(F);
+      for (uint32_t i = 0; i < kernelMDNum; ++i)
+        if (attrMD[i] == NULL)
+          attrMD[i] = F->getMetadata(kernelMD[i]);
+
+      FunctionType *FT = F->getFunctionType();
+      for (uint32_t paramID = 0; paramID < FT->getNumParams(); ++paramID, ++argID) {
+        const uint32_t fusedArgID = argMap[argID];
+        Type *type = FT->getParamType(paramID);
+        if (fusedArgID >= fusedArgNum) {
+          errors = "invalid argument map";
+          delete fused;
+          return NULL;
+        }
+        if (argTypes[fusedArgID] != NULL) {
+          // Merged arguments only differ by their pointee type
+          Type *fusedType = argTypes[fusedArgID];
+          if (fusedType != type &&
+              (!fusedType->isPointerTy() || !type->isPointerTy() ||
+               fusedType->getPointerAddressSpace() != type->getPointerAddressSpace())) {
+            errors = std::string("incompatible merged argument in kernel ") + kernelNames[kernelID];
+            delete fused;
+            return NULL;
+          }
+          continue;
+        }
+        argTypes[fusedArgID] = type;
+        for (uint32_t i = 0; i < kernelArgMDNum; ++i) {
+          MDNode *node = F->getMetadata(kernelArgMD[i]);
+          if (node == NULL || node->getNumOperands() != FT->getNumParams()) {
+            errors = std::string("missing argument information in kernel ") + kernelNames[kernelID];
+            delete fused;
+            return NULL;
+          }
+          argMD[i][fusedArgID] = node->getOperand(paramID).get();
+        }
+      }
+    }
+    for (uint32_t fusedArgID = 0; fusedArgID < fusedArgNum; ++fusedArgID)
+      if (argTypes[fusedArgID] == NULL) {
+        errors = "unused argument in the argument map";
+        delete fused;
+        return NULL;
+      }
+
+    // Only the fused kernel stays a kernel
+    std::vector<Function*> allKernels;
+    for (Function &F : *fused)
+      if (isKernelFunction(F))
+        allKernels.push_back(&F);
+    for (auto F : allKernels)
+      demoteKernel(*F);
+
+    FunctionType *fusedType = FunctionType::get(Type::getVoidTy(ctx), argTypes, false);
+    Function *fusedFn = Function::Create(fusedType, GlobalValue::ExternalLinkage, fusedName, fused);
+    fusedFn->setCallingConv(CallingConv::SPIR_KERNEL);
+    for (uint32_t fusedArgID = 0; fusedArgID < fusedArgNum; ++fusedArgID) {
+      if (!noAlias[fusedArgID] || !argTypes[fusedArgID]->isPointerTy())
+        continue;
+#if LLVM_VERSION_MAJOR >= 5
+      fusedFn->addParamAttr(fusedArgID, Attribute::NoAlias);
+#else
+      fusedFn->addAttribute(fusedArgID + 1, Attribute::NoAlias);
+#endif
+    }
+    for (uint32_t i = 0; i < kernelArgMDNum; ++i)
+      fusedFn->setMetadata(kernelArgMD[i], MDNode::get(ctx, argMD[i]));
+    for (uint32_t i = 0; i < kernelMDNum; ++i)
+      if (attrMD[i] != NULL)
+        fusedFn->setMetadata(kernelMD[i], attrMD[i]);
+
+    std::vector<Value*> fusedArgs;
+    for (Argument &arg : fusedFn->args())
+      fusedArgs.push_back(&arg);
+    BasicBlock *entry = BasicBlock::Create(ctx, "entry", fusedFn);
+    IRBuilder<> builder(entry);
+    argID = 0;
+    for (auto F : kernels) {
+      std::vector<Value*> callArgs;
+      FunctionType *FT = F->getFunctionType();
+      for (uint32_t paramID = 0; paramID < FT->getNumParams(); ++paramID, ++argID) {
+        Value *value = fusedArgs[argMap[argID]];
+        if (value->getType() != FT->getParamType(paramID))
+          value = builder.CreatePointerCast(value, FT->getParamType(paramID));
+        callArgs.push_back(value);
+      }
+      CallInst *call = builder.CreateCall(F, callArgs);
+      call->setCallingConv(CallingConv::SPIR_FUNC);
+    }
+    builder.CreateRetVoid();
+
+    std::string verifyErrors;
+    raw_string_ostream verifyStream(verifyErrors);
+    if (verifyModule(*fused, &verifyStream)) {
+      errors = "invalid fused module: " + verifyStream.str();
+      delete fused;
+      return NULL;
+    }
+    return fused;
+  }
+#endif /* LLVM_VERSION_MAJOR * 10 + LLVM_VERSION_MINOR >= 39 */
+
+  void *fuseKernels(void *llvmContext, const void **modules,
+                    const char **kernelNames, uint32_t kernelNum,
+                    const uint32_t *argMap, uint32_t fusedArgNum,
+                    const uint8_t *noAlias, const char *fusedName,
+                    std::string &errors)
+  {
+#if LLVM_VERSION_MAJOR * 10 + LLVM_VERSION_MINOR >= 39
+    LLVMContext &ctx = *(LLVMContext*) llvmContext;
+    return buildFusedModule(ctx, modules, kernelNames, kernelNum, argMap,
+                            fusedArgNum, noAlias, fusedName, errors);
+#else
+    errors = "kernel fusion needs LLVM 3.9 or later";
+    return NULL;
+#endif
+  }
+} /* namespace gbe */
@@ -20,52 +20,78 @@
  * then merge successive load/store that are compatible is beneficial.
  * The method of checking whether two load/store is compatible are borrowed
  * from Vectorize passes in llvm.
+ *
+ * Accesses of the same size are merged even if their types differ (int and
+ * float views of one buffer). Alias analysis (restrict arguments, TBAA and
+ * the disjoint OpenCL address spaces) tells which memory accesses in between
+ * the merged ones can be crossed. Before merging, the loads at the top of the
+ * join block of a simple diamond are hoisted into its head, and the stores at
+ * the end of the head are sunk into the join, so accesses split by an if
+ * statement can be merged too.
  */
 
 #include "llvm_includes.hpp"
+#include "llvm/Analysis/AliasAnalysis.h"
 
 using namespace llvm;
 namespace gbe {
-  class GenLoadStoreOptimization : public BasicBlockPass {
+  class GenLoadStoreOptimization : public FunctionPass {
 
   public:
     static char ID;
     ScalarEvolution *SE;
     const DataLayout *TD;
-    GenLoadStoreOptimization() : BasicBlockPass(ID) {}
+    AliasAnalysis *AA;
+    GenLoadStoreOptimization() : FunctionPass(ID) {}
 
     void getAnalysisUsage(AnalysisUsage &AU) const {
 #if LLVM_VERSION_MAJOR * 10 + LLVM_VERSION_MINOR >= 38
+      AU.addRequired<AAResultsWrapperPass>();
       AU.addRequired<ScalarEvolutionWrapperPass>();
       AU.addPreserved<ScalarEvolutionWrapperPass>();
 #else
+      AU.addRequired<AliasAnalysis>();
       AU.addRequired<ScalarEvolution>();
       AU.addPreserved<ScalarEvolution>();
 #endif
       AU.setPreservesCFG();
     }
 
-    virtual bool runOnBasicBlock(BasicBlock &BB) {
+    virtual bool runOnFunction(Function &F) {
 #if LLVM_VERSION_MAJOR * 10 + LLVM_VERSION_MINOR >= 38
+      AA = &getAnalysis<AAResultsWrapperPass>().getAAResults();
       SE = &getAnalysis<ScalarEvolutionWrapperPass>().getSE();
 #else
+      AA = &getAnalysis<AliasAnalysis>();
       SE = &getAnalysis<ScalarEvolution>();
 #endif
       #if LLVM_VERSION_MAJOR * 10 + LLVM_VERSION_MINOR >= 37
-        TD = &BB.getModule()->getDataLayout();
+        TD = &F.getParent()->getDataLayout();
       #elif LLVM_VERSION_MINOR >= 5
         DataLayoutPass *DLP = getAnalysisIfAvailable<DataLayoutPass>();
         TD = DLP ? &DLP->getDataLayout() : nullptr;
       #else
         TD = getAnalysisIfAvailable<DataLayout>();
       #endif
-      return optimizeLoadStore(BB);
+      bool changed = false;
+      for (BasicBlock &BB : F)
+        changed |= moveAcrossDiamond(BB);
+      for (BasicBlock &BB : F)
+        changed |= optimizeLoadStore(BB);
+      return changed;
     }
     Type *getValueType(Value *insn);
     Value *getPointerOperand(Value *I);
     unsigned getAddressSpace(Value *I);
     bool isSimpleLoadStore(Value *I);
+    bool mayAlias(Instruction *A, Instruction *B);
     bool optimizeLoadStore(BasicBlock &BB);
+    bool moveAcrossDiamond(BasicBlock &BB);
+    bool canHoistLoad(LoadInst *ld, BasicBlock &head, BasicBlock &join,
+                      SmallVector<BasicBlock *, 2> &sides,
+                      SmallVector<Instruction *, 16> &writes);
+    bool canSinkStore(StoreInst *st, BasicBlock &join,
+                      SmallVector<Instruction *, 16> &accesses);
 
     bool isLoadStoreCompatible(Value *A, Value *B, int *dist, int *elementSize,
                                int maxVecSize);
@@ -113,6 +139,42 @@ namespace gbe {
     return NULL;
   }
 
+  // Scalar types which may share a vector once bitcasted
+  static bool isMergeableType(Type *ty) {
+    return ty->isFloatTy() || ty->isHalfTy() || ty->isIntegerTy(32) ||
+           ty->isIntegerTy(16) || ty->isIntegerTy(8);
+  }
+
+  static unsigned getMaxVecSize(Type *ty) {
+    unsigned bits = ty->getPrimitiveSizeInBits();
+    return bits == 32 ? 4 : (bits == 16 ? 8 : 16);
+  }
+
+  // Only the generic address space overlaps the other ones
+  static bool isDisjointAddressSpace(unsigned A, unsigned B) {
+    const unsigned genericAddrSpace = 4;
+    return A != B && A != genericAddrSpace && B != genericAddrSpace;
+  }
+
+#if LLVM_VERSION_MAJOR * 10 + LLVM_VERSION_MINOR >= 37
+  static MemoryLocation getLocation(AliasAnalysis *AA, Instruction *I) {
+    if (LoadInst *ld = dyn_cast<LoadInst>(I)) return MemoryLocation::get(ld);
+    return MemoryLocation::get(cast<StoreInst>(I));
+  }
+#else
+  static AliasAnalysis::Location getLocation(AliasAnalysis *AA, Instruction *I) {
+    if (LoadInst *ld = dyn_cast<LoadInst>(I)) return AA->getLocation(ld);
+    return AA->getLocation(cast<StoreInst>(I));
+  }
+#endif
+
+  // A and B are simple loads or stores
+  bool GenLoadStoreOptimization::mayAlias(Instruction *A, Instruction *B) {
+    if (isDisjointAddressSpace(getAddressSpace(A), getAddressSpace(B)))
+      return false;
+    return !AA->isNoAlias(getLocation(AA, A), getLocation(AA, B));
+  }
+
   bool GenLoadStoreOptimization::isLoadStoreCompatible(Value *A, Value *B, int *dist, int* elementSize, int maxVecSize) {
     Value *ptrA = getPointerOperand(A);
     Value *ptrB = getPointerOperand(B);
@@ -123,8 +185,11 @@ namespace gbe {
     if (!ptrA || !ptrB || (ASA != ASB)) return false;
 
     if(!isSimpleLoadStore(A) || !isSimpleLoadStore(B)) return false;
-    // Check that A and B are of the same type.
-    if (ptrA->getType() != ptrB->getType()) return false;
+    // Check that A and B have the same size, they are bitcasted if needed.
+    Type *tyA = getValueType(A);
+    Type *tyB = getValueType(B);
+    if (!isMergeableType(tyA) || !isMergeableType(tyB)) return false;
+    if (TD->getTypeStoreSize(tyA) != TD->getTypeStoreSize(tyB)) return false;
 
     // Calculate the distance.
     const SCEV *ptrSCEVA = SE->getSCEV(ptrA);
@@ -136,10 +201,9 @@ namespace gbe {
     if (!constOffSCEV) return false;
 
     int64_t offset = constOffSCEV->getValue()->getSExtValue();
-    Type *Ty = cast<PointerType>(ptrA->getType())->getElementType();
     // The Instructions are connsecutive if the size of the first load/store is
     // the same as the offset.
-    int64_t sz = TD->getTypeStoreSize(Ty);
+    int64_t sz = TD->getTypeStoreSize(tyA);
     *dist = -offset;
     *elementSize = sz;
 
@@ -184,6 +248,8 @@ namespace gbe {
 
     for (unsigned i = 0; i < size; ++i) {
       Value *S = Builder.CreateExtractElement(vecValue, Builder.getInt32(i));
+      if (S->getType() != values[i]->getType())
+        S = Builder.CreateBitCast(S, values[i]->getType());
       values[i]->replaceAllUsesWith(S);
     }
   }
@@ -208,9 +274,10 @@ namespace gbe {
 
   // When searching for consecutive memory access, we do it in a small window,
   // if the window is too large, it would take up too much compiling time.
-  // An Important rule we have followed is don't try to change load/store order.
-  // But an exeption is 'load& store that are from different address spaces. The
-  // return value will indicate wheter such kind of reorder happens.
+  // The merged loads move up to the first one and the merged stores move down
+  // to the last one, so the memory accesses they cross must not alias them.
+  // Calls and atomics stop the search. The return value will indicate whether
+  // such kind of reorder happens.
   bool
   GenLoadStoreOptimization::findConsecutiveAccess(BasicBlock &BB,
                             SmallVector<Instruction*, 16> &merged,
@@ -222,17 +289,18 @@ namespace gbe {
                             Instruction *&last) {
     if(!isSimpleLoadStore(&*start)) return false;
 
-    unsigned targetAddrSpace = getAddressSpace(&*start);
-
     BasicBlock::iterator E = BB.end();
     BasicBlock::iterator J = start;
     ++J;
 
+    // Only the memory accesses count in the window
     unsigned maxLimit = maxVecSize * 8;
-    bool crossAddressSpace = false;
-    // When we are merging loads and there are some other AddressSpace stores
-    // lies among them, we are saying that loadStoreReorder happens. The same
-    // for merging stores and there are some other AddressSpace load among them.
+    unsigned maxInsn = maxVecSize * 32;
+    // Memory accesses lying among the candidates: stores when merging loads,
+    // loads and stores when merging stores.
+    SmallVector<Instruction *, 16> crossed;
+    // When some of them lies before a candidate, we are saying that
+    // loadStoreReorder happens.
     bool loadStoreReorder = false;
     bool ready = false;
     int elementSize;
@@ -244,38 +312,52 @@ namespace gbe {
     meInfoArray[indx++].init(&*start, 0);
     searchInsnArray.push_back(&meInfoArray[0]);
 
-    for(unsigned ss = 0; J!= E && ss <= maxLimit; ++ss, ++J) {
+    for(unsigned ss = 0, insn = 0; J!= E && ss <= maxLimit && insn <= maxInsn; ++insn, ++J) {
+      if (!J->mayReadOrWriteMemory())
+        continue;
+      ++ss;
+      if (!isSimpleLoadStore(&*J))
+        break;
       if((isLoad && isa<LoadInst>(*J)) || (!isLoad && isa<StoreInst>(*J))) {
           int distance;
-          if(isLoadStoreCompatible(searchInsnArray[0]->mInsn, &*J, &distance, &elementSize, maxVecSize))
+          bool compatible = isLoadStoreCompatible(searchInsnArray[0]->mInsn, &*J, &distance, &elementSize, maxVecSize);
+          bool aliased = false;
+          if (isLoad) {
+            // J is loaded before the stores it crosses
+            for (auto X : crossed)
+              aliased = aliased || mayAlias(X, &*J);
+          } else if (compatible) {
+            // Two stores writing the same bytes must keep their order
+            for (auto info : searchInsnArray)
+              aliased = aliased || std::abs(info->mOffset - distance) < elementSize;
+          }
+          if (compatible && !aliased)
           {
             meInfoArray[indx].init(&*J, distance);
             searchInsnArray.push_back(&meInfoArray[indx]);
             indx++;
-            if (crossAddressSpace)
+            if (!crossed.empty())
               loadStoreReorder = true;
 
             if(indx >= 32)
               break;
+            continue;
           }
-      } else if((isLoad && isa<StoreInst>(*J))) {
-        // simple stop to keep read/write order
-        StoreInst *st = cast<StoreInst>(&*J);
-        unsigned addrSpace = st->getPointerAddressSpace();
-        if (addrSpace != targetAddrSpace) {
-          crossAddressSpace = true;
-        } else {
-          break;
-        }
-      } else if ((!isLoad && isa<LoadInst>(*J))) {
-        LoadInst *ld = cast<LoadInst>(&*J);
-        unsigned addrSpace = ld->getPointerAddressSpace();
-        if (addrSpace != targetAddrSpace) {
-          crossAddressSpace = true;
-        } else {
+          // loads are free to be skipped, a skipped store is crossed
+          if (isLoad)
+            continue;
+      } else if (isLoad && isa<LoadInst>(*J)) {
+        continue;
+      }
+      // The stores merged so far are written after J
+      if (!isLoad) {
+        bool aliased = false;
+        for (auto info : searchInsnArray)
+          aliased = aliased || mayAlias(info->mInsn, &*J);
+        if (aliased)
           break;
-        }
       }
+      crossed.push_back(&*J);
     }
 
 
@@ -360,7 +442,10 @@ namespace gbe {
     VectorType *vecTy = VectorType::get(dataTy, size);
     Value * parent = UndefValue::get(vecTy);
     for(unsigned i = 0; i < size; i++) {
-      parent = Builder.CreateInsertElement(parent, values[i], ConstantInt::get(IntegerType::get(st->getContext(), 32), i));
+      Value *value = values[i];
+      if (value->getType() != dataTy)
+        value = Builder.CreateBitCast(value, dataTy);
+      parent = Builder.CreateInsertElement(parent, value, ConstantInt::get(IntegerType::get(st->getContext(), 32), i));
     }
 
     Value * stPointer = st->getPointerOperand();
@@ -410,6 +495,173 @@ namespace gbe {
     return safe;
   }
 
+  static BasicBlock *getUnconditionalSuccessor(BasicBlock *BB) {
+    BranchInst *br = dyn_cast<BranchInst>(BB->getTerminator());
+    return (br && br->isUnconditional()) ? br->getSuccessor(0) : NULL;
+  }
+
+  // Find the join of the simple diamond (or triangle) BB starts, sides gets
+  // the blocks between BB and the join.
+  static BasicBlock *getDiamondJoin(BasicBlock &BB, SmallVector<BasicBlock *, 2> &sides) {
+    BranchInst *br = dyn_cast<BranchInst>(BB.getTerminator());
+    if (br == NULL || !br->isConditional())
+      return NULL;
+    BasicBlock *T = br->getSuccessor(0);
+    BasicBlock *F = br->getSuccessor(1);
+    if (T == F || T == &BB || F == &BB)
+      return NULL;
+
+    BasicBlock *join = NULL;
+    BasicBlock *TS = T->getSinglePredecessor() == &BB ? getUnconditionalSuccessor(T) : NULL;
+    BasicBlock *FS = F->getSinglePredecessor() == &BB ? getUnconditionalSuccessor(F) : NULL;
+    if (TS != NULL && TS == FS) {
+      sides.push_back(T);
+      sides.push_back(F);
+      join = TS;
+    } else if (TS == F) {
+      sides.push_back(T);
+      join = F;
+    } else if (FS == T) {
+      sides.push_back(F);
+      join = T;
+    } else
+      return NULL;
+    if (join == &BB)
+      return NULL;
+
+    // The join must only be reached through the diamond
+    for (pred_iterator PI = pred_begin(join), E = pred_end(join); PI != E; ++PI)
+      if (*PI != &BB && std::find(sides.begin(), sides.end(), *PI) == sides.end())
+        return NULL;
+    return join;
+  }
+
+  // The load of the join moves to the end of the head, where a compatible load
+  // can be merged with it.
+  bool GenLoadStoreOptimization::canHoistLoad(LoadInst *ld, BasicBlock &head, BasicBlock &join,
+                                              SmallVector<BasicBlock *, 2> &sides,
+                                              SmallVector<Instruction *, 16> &writes) {
+    if (!ld->isSimple() || !isMergeableType(ld->getType()))
+      return false;
+    if (Instruction *ptr = dyn_cast<Instruction>(ld->getPointerOperand()))
+      if (ptr->getParent() == &join ||
+          std::find(sides.begin(), sides.end(), ptr->getParent()) != sides.end())
+        return false;
+    for (auto X : writes)
+      if (mayAlias(X, ld))
+        return false;
+
+    const unsigned maxVecSize = getMaxVecSize(ld->getType());
+    unsigned insn = 0;
+    for (BasicBlock::iterator J(head.getTerminator()); J != head.begin() && insn <= maxVecSize * 32; ++insn) {
+      --J;
+      if (!J->mayReadOrWriteMemory())
+        continue;
+      if (!isSimpleLoadStore(&*J))
+        return false;
+      int distance, elementSize;
+      if (isa<LoadInst>(*J) &&
+          isLoadStoreCompatible(&*J, ld, &distance, &elementSize, maxVecSize))
+        return true;
+      if (isa<StoreInst>(*J) && mayAlias(&*J, ld))
+        return false;
+    }
+    return false;
+  }
+
+  // The store of the head moves to the beginning of the join, where a
+  // compatible store can be merged with it.
+  bool GenLoadStoreOptimization::canSinkStore(StoreInst *st, BasicBlock &join,
+                                              SmallVector<Instruction *, 16> &accesses) {
+    if (!st->isSimple() || !isMergeableType(st->getValueOperand()->getType()))
+      return false;
+    for (auto X : accesses)
+      if (mayAlias(X, st))
+        return false;
+
+    const unsigned maxVecSize = getMaxVecSize(st->getValueOperand()->getType());
+    unsigned insn = 0;
+    for (BasicBlock::iterator J(join.getFirstNonPHI()); J != join.end() && insn <= maxVecSize * 32; ++J, ++insn) {
+      if (!J->mayReadOrWriteMemory())
+        continue;
+      if (!isSimpleLoadStore(&*J))
+        return false;
+      int distance, elementSize;
+      if (isa<StoreInst>(*J) &&
+          isLoadStoreCompatible(st, &*J, &distance, &elementSize, maxVecSize))
+        return true;
+      if (mayAlias(&*J, st))
+        return false;
+    }
+    return false;
+  }
+
+  // For a simple diamond, hoist the loads of the join into the head and sink
+  // the stores of the head into the join. Both blocks run together, so nothing
+  // is speculated, the accesses only need to not alias the ones they cross.
+  bool GenLoadStoreOptimization::moveAcrossDiamond(BasicBlock &BB) {
+    SmallVector<BasicBlock *, 2> sides;
+    BasicBlock *join = getDiamondJoin(BB, sides);
+    if (join == NULL)
+      return false;
+
+    // Memory accesses of the sides, calls and atomics stop everything
+    SmallVector<Instruction *, 16> writes, accesses;
+    for (auto side : sides)
+      for (Instruction &I : *side) {
+        if (!I.mayReadOrWriteMemory())
+          continue;
+        if (!isSimpleLoadStore(&I))
+          return false;
+        accesses.push_back(&I);
+        if (isa<StoreInst>(I))
+          writes.push_back(&I);
+      }
+
+    bool changed = false;
+    const unsigned maxInsn = 128;
+    unsigned insn = 0;
+    for (BasicBlock::iterator J(join->getFirstNonPHI()); J != join->end() && insn < maxInsn; ++insn) {
+      Instruction *I = &*J;
+      ++J;
+      if (!I->mayReadOrWriteMemory())
+        continue;
+      if (!isSimpleLoadStore(I))
+        break;
+      if (LoadInst *ld = dyn_cast<LoadInst>(I))
+        if (canHoistLoad(ld, BB, *join, sides, writes)) {
+          ld->moveBefore(BB.getTerminator());
+          changed = true;
+          continue;
+        }
+      if (isa<StoreInst>(I))
+        writes.push_back(I);
+    }
+
+    SmallVector<Instruction *, 32> headInsns;
+    for (Instruction &I : BB)
+      headInsns.push_back(&I);
+    Instruction *insertPt = &*join->getFirstInsertionPt();
+    insn = 0;
+    for (auto it = headInsns.rbegin(); it != headInsns.rend() && insn < maxInsn; ++it, ++insn) {
+      Instruction *I = *it;
+      if (!I->mayReadOrWriteMemory())
+        continue;
+      if (!isSimpleLoadStore(I))
+        break;
+      // The stores sunk before keep their order, they are after this one
+      if (StoreInst *st = dyn_cast<StoreInst>(I))
+        if (canSinkStore(st, *join, accesses)) {
+          st->moveBefore(insertPt);
+          insertPt = st;
+          changed = true;
+          continue;
+        }
+      accesses.push_back(I);
+    }
+    return changed;
+  }
+
   bool GenLoadStoreOptimization::optimizeLoadStore(BasicBlock &BB) {
     bool changed = false;
     SmallVector<Instruction*, 16> merged;
@@ -421,13 +673,12 @@ namespace gbe {
         if(ty->isVectorTy()) continue;
         // TODO Support DWORD/WORD/BYTE LOAD for store support DWORD only now.
         if (!(ty->isFloatTy() || ty->isIntegerTy(32) ||
-             ((ty->isIntegerTy(8) || ty->isIntegerTy(16)) && isLoad)))
+             ((ty->isIntegerTy(8) || ty->isIntegerTy(16) || ty->isHalfTy()) && isLoad)))
           continue;
 
         int addrOffset = 0;
         Instruction *first = nullptr, *last = nullptr;
-        unsigned maxVecSize = (ty->isFloatTy() || ty->isIntegerTy(32)) ? 4 :
-                              (ty->isIntegerTy(16) ? 8 : 16);
+        unsigned maxVecSize = getMaxVecSize(ty);
         bool reorder = findConsecutiveAccess(BB, merged, BBI, maxVecSize,
                                              isLoad, &addrOffset, first, last);
         uint32_t size = merged.size();
@@ -466,7 +717,7 @@ namespace gbe {
     return changed;
   }
 
-  BasicBlockPass *createLoadStoreOptimizationPass() {
+  FunctionPass *createLoadStoreOptimizationPass() {
     return new GenLoadStoreOptimization();
   }
 };
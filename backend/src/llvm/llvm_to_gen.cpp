@@ -44,6 +44,7 @@ namespace gbe
   BVAR(OCL_OUTPUT_CFG, false);
   BVAR(OCL_OUTPUT_CFG_ONLY, false);
   BVAR(OCL_OUTPUT_CFG_GEN_IR, false);
+  BVAR(OCL_OPTIMIZE_INT_DIVISION, true);
   using namespace llvm;
 
 #if LLVM_VERSION_MAJOR * 10 + LLVM_VERSION_MINOR >= 37
@@ -356,6 +357,14 @@ namespace gbe
     passes.add(createSROAPass());
 #else
     passes.add(createScalarReplAggregatesPass(64, true, -1, -1, 64));
+#endif
+    // The load/store merging crosses the accesses alias analysis proves apart
+#if LLVM_VERSION_MAJOR * 10 + LLVM_VERSION_MINOR >= 38
+    passes.add(createTypeBasedAAWrapperPass());
+    passes.add(createBasicAAWrapperPass());
+#else
+    passes.add(createTypeBasedAliasAnalysisPass());
+    passes.add(createBasicAliasAnalysisPass());
 #endif
     passes.add(createLoadStoreOptimizationPass());
     passes.add(createConstantPropagationPass());
@@ -365,6 +374,8 @@ namespace gbe
     passes.add(createPrintfParserPass(unit));
     passes.add(createExpandConstantExprPass());    // expand ConstantExpr
     passes.add(createScalarizePass());             // Expand all vector ops
+    if (OCL_OPTIMIZE_INT_DIVISION)
+      passes.add(createIntDivisionPass());         // Divide by constants and uniform values with mul_hi
     passes.add(createExpandLargeIntegersPass());   // legalize large integer operation
     passes.add(createInstructionCombiningPass());  // legalize will generate some silly instructions
     passes.add(createConstantPropagationPass());   // propagate constant after scalarize/legalize
@@ -37,6 +37,15 @@ namespace gbe {
 		  optLevel 0 equal to clang -O1 and 1 equal to clang -O2*/
   bool llvmToGen(ir::Unit &unit, const void* module,
                  int optLevel, bool strictMath, int profiling, std::string &errors);
+
+  /*! Build in llvmContext the module of the kernel fusedName calling the
+      kernels in sequence, see gbe_program_new_fused. Returns NULL and sets
+      errors if the kernels can not be fused */
+  void *fuseKernels(void *llvmContext, const void **modules,
+                    const char **kernelNames, uint32_t kernelNum,
+                    const uint32_t *argMap, uint32_t fusedArgNum,
+                    const uint8_t *noAlias, const char *fusedName,
+                    std::string &errors);
 } /* namespace gbe */
 
 #endif /* __GBE_IR_LLVM_TO_GEN_HPP__ */
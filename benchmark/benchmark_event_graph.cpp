@@ -0,0 +1,67 @@
+#include "utests/utest_helper.hpp"
+#include <sys/time.h>
+
+/* Markers do not submit anything to the GPU, so this only measures how fast
+ * the queues resolve a deep dependency graph gated by a user event. Each queue
+ * runs a chain of markers, every marker also waits for the previous marker of
+ * the next queue and for the user event. */
+double benchmark_event_graph(void)
+{
+  struct timeval start, stop;
+  const int queue_num = 8;
+  const int depth = 256;
+  const int loop = 20;
+  cl_command_queue queues[queue_num];
+  cl_event *markers = new cl_event[queue_num * depth];
+  cl_int err;
+
+  for (int q = 0; q < queue_num; q++) {
+    queues[q] = clCreateCommandQueue(ctx, device, 0, &err);
+    OCL_ASSERT(err == CL_SUCCESS);
+  }
+
+  gettimeofday(&start, 0);
+  for (int l = 0; l < loop; l++) {
+    cl_event user = clCreateUserEvent(ctx, &err);
+    OCL_ASSERT(err == CL_SUCCESS);
+
+    for (int d = 0; d < depth; d++) {
+      for (int q = 0; q < queue_num; q++) {
+        cl_event wait_list[3];
+        cl_uint wait_num = 0;
+        wait_list[wait_num++] = user;
+        if (d > 0) {
+          wait_list[wait_num++] = markers[(d - 1) * queue_num + q];
+          wait_list[wait_num++] = markers[(d - 1) * queue_num + (q + 1) % queue_num];
+        }
+        OCL_CALL(clEnqueueMarkerWithWaitList, queues[q], wait_num, wait_list,
+                 &markers[d * queue_num + q]);
+      }
+    }
+
+    OCL_CALL(clSetUserEventStatus, user, CL_COMPLETE);
+    for (int q = 0; q < queue_num; q++)
+      OCL_CALL(clFinish, queues[q]);
+
+    for (int i = 0; i < queue_num * depth; i++) {
+      cl_int status;
+      OCL_CALL(clGetEventInfo, markers[i], CL_EVENT_COMMAND_EXECUTION_STATUS,
+               sizeof(status), &status, NULL);
+      OCL_ASSERT(status == CL_COMPLETE);
+      clReleaseEvent(markers[i]);
+    }
+    clReleaseEvent(user);
+  }
+  gettimeofday(&stop, 0);
+
+  for (int q = 0; q < queue_num; q++)
+    clReleaseCommandQueue(queues[q]);
+  delete [] markers;
+
+  double elapsed = time_subtract(&stop, &start, 0);
+
+  /* Thousands of events per second */
+  return (double)(loop * queue_num * depth) / elapsed;
+}
+
+MAKE_BENCHMARK_FROM_FUNCTION(benchmark_event_graph, "KEvents/s");
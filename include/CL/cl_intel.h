@@ -170,6 +170,41 @@ typedef CL_API_ENTRY cl_mem (CL_API_CALL *clCreateImageFromFdINTEL_fn)(
                              const cl_import_image_info_intel *    /* info */,
                              cl_int *                              /* errcode_ret */);
 
+/* Set all the arguments of a kernel in one call. args points to the
+ * arguments in order without padding: values take their size, buffers, images
+ * and pipes a cl_mem, samplers a cl_sampler and __local arguments a size_t
+ * giving their size. args_size must be the total size. */
+extern CL_API_ENTRY cl_int CL_API_CALL
+clSetKernelArgsIntel(cl_kernel    /* kernel */,
+                     size_t       /* args_size */,
+                     const void * /* args */);
+
+typedef CL_API_ENTRY cl_int (CL_API_CALL *clSetKernelArgsIntel_fn)(
+                             cl_kernel    /* kernel */,
+                             size_t       /* args_size */,
+                             const void * /* args */);
+
+/* Create a kernel running the given kernels one after the other in each work
+ * item, to enqueue instead of the sequence with the same NDRange. The kernels
+ * must have their arguments set, the fused kernel gets the same values. A
+ * buffer used by several kernels becomes one argument and the values a kernel
+ * writes are forwarded to the loads of the same work item in the next ones,
+ * so a work item may only read what itself wrote in the earlier kernels.
+ * Only buffer and value arguments are supported, distinct buffers must not
+ * overlap, and the programs of the kernels must have the same build options.
+ * The fused kernels are cached by the context. */
+extern CL_API_ENTRY cl_kernel CL_API_CALL
+clCreateFusedKernelIntel(cl_context        /* context */,
+                         cl_uint           /* num_kernels */,
+                         const cl_kernel * /* kernels */,
+                         cl_int *          /* errcode_ret */);
+
+typedef CL_API_ENTRY cl_kernel (CL_API_CALL *clCreateFusedKernelIntel_fn)(
+                             cl_context        /* context */,
+                             cl_uint           /* num_kernels */,
+                             const cl_kernel * /* kernels */,
+                             cl_int *          /* errcode_ret */);
+
 #ifndef CL_VERSION_2_0
 typedef cl_uint  cl_kernel_sub_group_info;
 
@@ -198,6 +233,18 @@ typedef CL_API_ENTRY cl_int
 						      size_t* /*param_value_size_ret*/ );
 #endif
 
+/* Context properties placing the host memory of the CL_MEM_ALLOC_HOST_PTR
+ * buffers. They override the OCL_HOST_ALLOC_PAGES and OCL_HOST_ALLOC_NUMA_NODE
+ * environment variables. A huge page allocation falls back to normal pages
+ * when the system has none available */
+#define CL_CONTEXT_HOST_ALLOC_PAGES_INTEL               0x4210
+#define CL_CONTEXT_HOST_ALLOC_NUMA_NODE_INTEL           0x4211
+
+/* cl_context_properties values for CL_CONTEXT_HOST_ALLOC_PAGES_INTEL */
+#define CL_HOST_ALLOC_PAGES_DEFAULT_INTEL               0
+#define CL_HOST_ALLOC_PAGES_TRANSPARENT_HUGE_INTEL      1
+#define CL_HOST_ALLOC_PAGES_EXPLICIT_HUGE_INTEL         2
+
 /* cl_intel_required_subgroup_size extension*/
 #define CL_DEVICE_SUB_GROUP_SIZES_INTEL                 0x4108
 #define CL_KERNEL_SPILL_MEM_SIZE_INTEL                  0x4109
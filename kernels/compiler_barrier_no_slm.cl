@@ -0,0 +1,17 @@
+/* Barrier without local memory, the work group spans several threads */
+__kernel void compiler_barrier_no_slm(__global int *dst, __global int *tmp) {
+  const int lid = get_local_id(0);
+  const int base = get_group_id(0) * get_local_size(0);
+  tmp[base + lid] = get_global_id(0);
+  barrier(CLK_GLOBAL_MEM_FENCE);
+  dst[base + lid] = tmp[base + get_local_size(0) - 1 - lid];
+}
+
+/* Same with local memory, to switch the L3 configuration in between */
+__kernel void compiler_barrier_no_slm_local(__global int *dst) {
+  __local int tmp[256];
+  const int lid = get_local_id(0);
+  tmp[lid] = get_global_id(0);
+  barrier(CLK_LOCAL_MEM_FENCE);
+  dst[get_global_id(0)] = tmp[get_local_size(0) - 1 - lid];
+}
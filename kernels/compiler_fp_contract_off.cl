@@ -0,0 +1,7 @@
+#pragma OPENCL FP_CONTRACT OFF
+kernel void compiler_fp_contract_off(global float *src0, global float *src1,
+                                     global float *src2, global float *dst)
+{
+  int id = (int)get_global_id(0);
+  dst[id] = src0[id] * src1[id] + src2[id];
+}
@@ -0,0 +1,27 @@
+kernel void compiler_int_division(global uint *usrc, global int *isrc,
+                                  global ulong *lsrc, global uint *udst,
+                                  global int *idst, global ulong *ldst,
+                                  uint ud, int id)
+{
+  int i = (int)get_global_id(0);
+  uint u = usrc[i];
+  int s = isrc[i];
+  ulong l = lsrc[i];
+
+  udst[6 * i + 0] = u / 7;
+  udst[6 * i + 1] = u % 10;
+  udst[6 * i + 2] = u / ud;
+  udst[6 * i + 3] = u % ud;
+  udst[6 * i + 4] = u / 0x80000001u;
+  udst[6 * i + 5] = u / (ud * 3);
+
+  idst[6 * i + 0] = s / 7;
+  idst[6 * i + 1] = s % -10;
+  idst[6 * i + 2] = s / 16;
+  idst[6 * i + 3] = s / id;
+  idst[6 * i + 4] = s % id;
+  idst[6 * i + 5] = s / -8;
+
+  ldst[2 * i + 0] = l / 1000003;
+  ldst[2 * i + 1] = l % 12345678901ul;
+}
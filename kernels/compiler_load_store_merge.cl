@@ -0,0 +1,34 @@
+/* Accesses the load/store merging handles: int and float views of one
+ * buffer, a store to another restrict buffer in between, and accesses split
+ * by an if statement */
+kernel void compiler_load_store_merge(global int * restrict src,
+                                      global int * restrict dst,
+                                      global float * restrict tmp,
+                                      local int *slm)
+{
+  int id = (int)get_global_id(0);
+  int lid = (int)get_local_id(0);
+  global float *srcf = (global float *)src;
+
+  int a = src[4 * id];
+  tmp[id] = 1.0f;
+  float b = srcf[4 * id + 1];
+  int c = 0;
+  if (a & 1)
+    c = a * 3;
+  else
+    c = a + 5;
+  int d = src[4 * id + 2];
+  int e = src[4 * id + 3];
+
+  slm[2 * lid] = a + c;
+  if (d > e)
+    tmp[id] = 2.0f;
+  slm[2 * lid + 1] = d - e;
+  barrier(CLK_LOCAL_MEM_FENCE);
+
+  dst[4 * id] = slm[2 * lid];
+  ((global float *)dst)[4 * id + 1] = b * 2.0f;
+  dst[4 * id + 2] = slm[2 * lid + 1];
+  dst[4 * id + 3] = c;
+}
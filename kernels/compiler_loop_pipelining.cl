@@ -0,0 +1,9 @@
+kernel void compiler_loop_pipelining(global int *dst, global const int *a,
+                                     global const int *b, int n)
+{
+  int id = get_global_id(0);
+  int sum = 0;
+  for (int i = 0; i < n; ++i)
+    sum += a[id * n + i] * b[i];
+  dst[id] = sum;
+}
@@ -0,0 +1,41 @@
+kernel void compiler_sel_peephole(global float *src0, global float *src1,
+                                  global float4 *dst)
+{
+  int id = (int)get_global_id(0);
+  float a = src0[id], b = src1[id];
+  float4 r;
+  r.x = fmin(fmax(a + b, 0.0f), 1.0f);
+  r.y = fabs(-a) * -b;
+  r.z = a > b ? a - b : a * b;
+  r.w = -fabs(a) + b;
+  if (a > b)
+    r.w = -r.w;
+  dst[id] = r;
+}
+
+/* One kernel per peephole rule, utests/sel_peephole_check.py compares the
+ * instruction count of each with its rule on and off */
+kernel void compiler_sel_peephole_srcmod(global float *src0, global float *src1,
+                                         global float *dst)
+{
+  int id = (int)get_global_id(0);
+  dst[id] = fabs(src0[id]) * src1[id];
+}
+
+kernel void compiler_sel_peephole_saturate(global float *src0, global float *src1,
+                                           global float *dst)
+{
+  int id = (int)get_global_id(0);
+  dst[id] = fmin(fmax(src0[id] + src1[id], 0.0f), 1.0f);
+}
+
+kernel void compiler_sel_peephole_flag(global float *src0, global float *src1,
+                                       global float2 *dst)
+{
+  int id = (int)get_global_id(0);
+  float a = src0[id], b = src1[id];
+  float2 r;
+  r.x = a > b ? a - b : a * b;
+  r.y = a > b ? a + b : b;
+  dst[id] = r;
+}
@@ -0,0 +1,13 @@
+kernel void compiler_vloada_half4(global half *src, global half *dst)
+{
+  int id = (int)get_global_id(0);
+  float4 v = vloada_half4(id, src);
+  vstorea_half4(v * 2.0f, id, dst);
+}
+
+kernel void compiler_vloada_half3(global half *src, global half *dst)
+{
+  int id = (int)get_global_id(0);
+  float3 v = vloada_half3(id, src);
+  vstorea_half3_rtz(v + 1.0f, id, dst);
+}
@@ -0,0 +1,23 @@
+/* The 4x2 work groups fit in one thread: the barriers and the work group
+ * functions are compiled without SLM nor thread synchronization */
+kernel __attribute__((reqd_work_group_size(4, 2, 1)))
+void compiler_workgroup_single_thread(global int *src, global int *dst, int bias)
+{
+  local int tile[8];
+  const uint lid = get_local_id(1) * 4 + get_local_id(0);
+  const uint gid = get_group_id(0) * 8 + lid;
+  const int val = src[gid];
+
+  tile[lid] = val;
+  barrier(CLK_LOCAL_MEM_FENCE);
+  const int reversed = tile[7 - lid];
+  barrier(CLK_LOCAL_MEM_FENCE);
+  tile[lid] = reversed;
+  barrier(CLK_LOCAL_MEM_FENCE);
+
+  dst[gid * 5 + 0] = tile[(lid + 1) & 7];
+  dst[gid * 5 + 1] = work_group_reduce_add(val);
+  dst[gid * 5 + 2] = work_group_scan_exclusive_add(val);
+  dst[gid * 5 + 3] = work_group_broadcast(val, 3, 1);
+  dst[gid * 5 + 4] = work_group_broadcast(bias, 2, 0);
+}
@@ -0,0 +1,13 @@
+__kernel void
+runtime_kernel_fusion_scale(__global const float *src, __global float *dst, float scale)
+{
+  int i = get_global_id(0);
+  dst[i] = src[i] * scale;
+}
+
+__kernel void
+runtime_kernel_fusion_offset(__global const float *src, __global float *dst, float offset)
+{
+  int i = get_global_id(0);
+  dst[i] = src[i] + offset;
+}
@@ -18,3 +18,10 @@ set_kernel_arg(__global unsigned int *dst, float3 src)
       break;
   }
 }
+
+__kernel void
+set_kernel_arg_packed(char bias, __global unsigned int *dst)
+{
+  size_t gid = get_global_id(0);
+  dst[gid] = gid + bias;
+}
@@ -62,7 +62,12 @@ KERNEL_NAMES := cl_internal_copy_buf_align4 \
                 cl_internal_fill_image_1d_array \
                 cl_internal_fill_image_2d \
                 cl_internal_fill_image_2d_array \
-                cl_internal_fill_image_3d
+                cl_internal_fill_image_3d \
+                cl_internal_scan_intel \
+                cl_internal_reduce_segments_intel \
+                cl_internal_radix_sort_intel \
+                cl_internal_transpose_intel \
+                cl_internal_pyramid_down_intel
 BUILT_IN_NAME := cl_internal_built_in_kernel
 
 GBE_BIN_GENERATER := $(HOST_OUT_EXECUTABLES)/gbe_bin_generater
@@ -97,6 +102,7 @@ LOCAL_SRC_FILES:= \
     cl_api_program.c \
     cl_alloc.c \
     cl_kernel.c \
+    cl_kernel_fusion.c \
     cl_program.c \
     cl_gbe_loader.cpp \
     cl_sampler.c \
@@ -121,6 +127,7 @@ LOCAL_SRC_FILES:= \
     intel/intel_gpgpu.c \
     intel/intel_batchbuffer.c \
     intel/intel_driver.c \
+    cl_trace.c \
     performance.c
 
 LOCAL_SHARED_LIBRARIES := \
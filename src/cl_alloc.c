@@ -19,18 +19,43 @@
 
 #include "cl_alloc.h"
 #include "cl_utils.h"
+#include "CL/cl_intel.h"
 
 #include <stdlib.h>
 #include <assert.h>
 #include <malloc.h>
+#include <string.h>
+#include <pthread.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
 
-static volatile int32_t cl_alloc_n = 0;
+/* The number of allocations is counted in per thread shards so that threads
+ * allocating at the same time do not bounce the same cache line */
+#define CL_ALLOC_SHARD_NUM 16
+
+typedef struct _cl_alloc_shard {
+  atomic_t n;
+  char pad[64 - sizeof(atomic_t)];
+} cl_alloc_shard;
+
+static cl_alloc_shard cl_alloc_n[CL_ALLOC_SHARD_NUM] __attribute__((aligned(64)));
+static atomic_t cl_alloc_shard_next = 0;
+static __thread int cl_alloc_shard_id = -1;
+
+static INLINE atomic_t *
+cl_alloc_counter(void)
+{
+  if (UNLIKELY(cl_alloc_shard_id < 0))
+    cl_alloc_shard_id = (uint32_t)atomic_inc(&cl_alloc_shard_next) % CL_ALLOC_SHARD_NUM;
+  return &cl_alloc_n[cl_alloc_shard_id].n;
+}
 
 LOCAL void*
 cl_malloc(size_t sz)
 {
   void * p = NULL;
-  atomic_inc(&cl_alloc_n);
+  atomic_inc(cl_alloc_counter());
   p = malloc(sz);
   assert(p);
   return p;
@@ -40,7 +65,7 @@ LOCAL void*
 cl_aligned_malloc(size_t sz, size_t align)
 {
   void * p = NULL;
-  atomic_inc(&cl_alloc_n);
+  atomic_inc(cl_alloc_counter());
   p = memalign(align, sz);
   assert(p);
   return p;
@@ -50,7 +75,7 @@ LOCAL void*
 cl_calloc(size_t n, size_t elem_size)
 {
   void *p = NULL;
-  atomic_inc(&cl_alloc_n);
+  atomic_inc(cl_alloc_counter());
   p = calloc(n, elem_size);
   assert(p);
   return p;
@@ -60,7 +85,7 @@ LOCAL void*
 cl_realloc(void *ptr, size_t sz)
 {
   if (ptr == NULL)
-    atomic_inc(&cl_alloc_n);
+    atomic_inc(cl_alloc_counter());
   return realloc(ptr, sz);
 }
 
@@ -69,20 +94,268 @@ cl_free(void *ptr)
 {
   if (ptr == NULL)
     return;
-  atomic_dec(&cl_alloc_n);
+  atomic_dec(cl_alloc_counter());
   free(ptr);
   ptr = NULL;
 }
 
+#define CL_HUGE_PAGE_SIZE (2u << 20)
+#define CL_HOST_PREFAULT_CHUNK (16u << 20)
+#define CL_HOST_PREFAULT_MAX_THREADS 8
+#define CL_MPOL_PREFERRED 1
+
+typedef struct _cl_host_prefault {
+  volatile char *start;
+  size_t sz;
+  size_t stride;
+} cl_host_prefault;
+
+static void *
+cl_host_prefault_range(void *data)
+{
+  cl_host_prefault *range = data;
+  size_t i;
+  for (i = 0; i < range->sz; i += range->stride)
+    range->start[i] = 0;
+  return NULL;
+}
+
+/* Fault the pages in now so that they are placed by the policy and not by
+ * the first thread touching them, and so that pinning the userptr does not
+ * fault them one by one. Big blocks are split between several threads */
+static void
+cl_host_prefault_pages(char *ptr, size_t sz, size_t stride)
+{
+  cl_host_prefault range[CL_HOST_PREFAULT_MAX_THREADS];
+  pthread_t threads[CL_HOST_PREFAULT_MAX_THREADS];
+  int started[CL_HOST_PREFAULT_MAX_THREADS] = {0};
+  long cpu_n = sysconf(_SC_NPROCESSORS_ONLN);
+  size_t thread_n = sz / CL_HOST_PREFAULT_CHUNK, chunk;
+  size_t i;
+
+  if (thread_n > (size_t)cpu_n)
+    thread_n = cpu_n;
+  if (thread_n > CL_HOST_PREFAULT_MAX_THREADS)
+    thread_n = CL_HOST_PREFAULT_MAX_THREADS;
+  if (thread_n <= 1) {
+    range[0].start = ptr;
+    range[0].sz = sz;
+    range[0].stride = stride;
+    cl_host_prefault_range(&range[0]);
+    return;
+  }
+
+  chunk = ALIGN(sz / thread_n, stride);
+  for (i = 0; i < thread_n; i++) {
+    range[i].start = ptr + i * chunk;
+    range[i].sz = i == thread_n - 1 ? sz - i * chunk : chunk;
+    range[i].stride = stride;
+  }
+  /* The calling thread takes the first range */
+  for (i = 1; i < thread_n; i++)
+    started[i] = pthread_create(&threads[i], NULL, cl_host_prefault_range, &range[i]) == 0;
+  cl_host_prefault_range(&range[0]);
+  for (i = 1; i < thread_n; i++) {
+    if (started[i])
+      pthread_join(threads[i], NULL);
+    else
+      cl_host_prefault_range(&range[i]);
+  }
+}
+
+/* Anonymous mapping aligned on the huge page size */
+static void *
+cl_host_map_aligned(size_t sz)
+{
+  char *p, *aligned;
+  p = mmap(NULL, sz + CL_HUGE_PAGE_SIZE, PROT_READ | PROT_WRITE,
+           MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+  if (p == MAP_FAILED)
+    return NULL;
+  aligned = (char *)ALIGN((unsigned long)p, CL_HUGE_PAGE_SIZE);
+  if (aligned != p)
+    munmap(p, aligned - p);
+  munmap(aligned + sz, p + CL_HUGE_PAGE_SIZE - aligned);
+  return aligned;
+}
+
+LOCAL void *
+cl_host_alloc(size_t sz, const cl_host_alloc_policy *policy, size_t *alloc_sz)
+{
+  const size_t page_size = getpagesize();
+  size_t stride = page_size;
+  void *p = NULL;
+
+  *alloc_sz = 0;
+  if (policy == NULL ||
+      (policy->pages == CL_HOST_ALLOC_PAGES_DEFAULT_INTEL && policy->numa_node < 0))
+    return cl_aligned_malloc(ALIGN(sz, page_size), page_size);
+
+  if (policy->pages == CL_HOST_ALLOC_PAGES_DEFAULT_INTEL) {
+    *alloc_sz = ALIGN(sz, page_size);
+    p = mmap(NULL, *alloc_sz, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (p == MAP_FAILED)
+      p = NULL;
+  } else {
+    *alloc_sz = ALIGN(sz, CL_HUGE_PAGE_SIZE);
+#ifdef MAP_HUGETLB
+    if (policy->pages == CL_HOST_ALLOC_PAGES_EXPLICIT_HUGE_INTEL) {
+      p = mmap(NULL, *alloc_sz, PROT_READ | PROT_WRITE,
+               MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+      if (p == MAP_FAILED)
+        p = NULL;
+      else
+        stride = CL_HUGE_PAGE_SIZE;
+    }
+#endif
+    /* Transparent huge pages, also the fallback when the huge page pool is empty */
+    if (p == NULL && (p = cl_host_map_aligned(*alloc_sz)) != NULL) {
+#ifdef MADV_HUGEPAGE
+      madvise(p, *alloc_sz, MADV_HUGEPAGE);
+#endif
+    }
+  }
+  if (p == NULL) {
+    *alloc_sz = 0;
+    return NULL;
+  }
+
+#ifdef SYS_mbind
+  if (policy->numa_node >= 0 && policy->numa_node < (int)(8 * sizeof(unsigned long))) {
+    /* Preferred rather than bound, an allocation bigger than the free memory
+     * of the node spills to the other nodes instead of failing */
+    unsigned long node_mask = 1ul << policy->numa_node;
+    syscall(SYS_mbind, p, *alloc_sz, CL_MPOL_PREFERRED, &node_mask,
+            8 * sizeof(node_mask), 0);
+  }
+#endif
+  cl_host_prefault_pages(p, *alloc_sz, stride);
+  atomic_inc(cl_alloc_counter());
+  return p;
+}
+
+LOCAL void
+cl_host_free(void *ptr, size_t alloc_sz)
+{
+  if (ptr == NULL)
+    return;
+  if (alloc_sz == 0) {
+    cl_free(ptr);
+    return;
+  }
+  atomic_dec(cl_alloc_counter());
+  munmap(ptr, alloc_sz);
+}
+
+/* Per thread free lists of the objects created and destroyed on every
+ * enqueue. A cached block is not counted as allocated. The lists are
+ * released when the thread exits. */
+#define CL_ALLOC_CACHE_MAX 32
+
+typedef struct _cl_alloc_cache_block {
+  struct _cl_alloc_cache_block *next;
+} cl_alloc_cache_block;
+
+typedef struct _cl_alloc_thread_cache {
+  cl_alloc_cache_block *head[CL_ALLOC_CACHE_NUM];
+  uint32_t num[CL_ALLOC_CACHE_NUM];
+} cl_alloc_thread_cache;
+
+static size_t cl_alloc_cache_size[CL_ALLOC_CACHE_NUM];
+static __thread cl_alloc_thread_cache *cl_alloc_cache = NULL;
+static pthread_key_t cl_alloc_cache_key;
+static pthread_once_t cl_alloc_cache_once = PTHREAD_ONCE_INIT;
+
+static void
+cl_alloc_cache_destroy(void *data)
+{
+  cl_alloc_thread_cache *cache = data;
+  cl_alloc_cache_block *block;
+  int type;
+
+  for (type = 0; type < CL_ALLOC_CACHE_NUM; type++) {
+    while ((block = cache->head[type]) != NULL) {
+      cache->head[type] = block->next;
+      free(block);
+    }
+  }
+  free(cache);
+  cl_alloc_cache = NULL;
+}
+
+static void
+cl_alloc_cache_init(void)
+{
+  pthread_key_create(&cl_alloc_cache_key, cl_alloc_cache_destroy);
+}
+
+static cl_alloc_thread_cache *
+cl_alloc_get_cache(void)
+{
+  if (LIKELY(cl_alloc_cache != NULL))
+    return cl_alloc_cache;
+  pthread_once(&cl_alloc_cache_once, cl_alloc_cache_init);
+  cl_alloc_cache = calloc(1, sizeof(cl_alloc_thread_cache));
+  if (cl_alloc_cache)
+    pthread_setspecific(cl_alloc_cache_key, cl_alloc_cache);
+  return cl_alloc_cache;
+}
+
+LOCAL void*
+cl_cache_calloc(cl_alloc_cache_type type, size_t sz)
+{
+  cl_alloc_thread_cache *cache = cl_alloc_get_cache();
+  cl_alloc_cache_block *block;
+
+  assert(type < CL_ALLOC_CACHE_NUM && sz >= sizeof(cl_alloc_cache_block));
+  assert(cl_alloc_cache_size[type] == 0 || cl_alloc_cache_size[type] == sz);
+  cl_alloc_cache_size[type] = sz;
+  if (cache == NULL || cache->head[type] == NULL)
+    return cl_calloc(1, sz);
+
+  block = cache->head[type];
+  cache->head[type] = block->next;
+  cache->num[type]--;
+  atomic_inc(cl_alloc_counter());
+  memset(block, 0, sz);
+  return block;
+}
+
+LOCAL void
+cl_cache_free(cl_alloc_cache_type type, void *ptr)
+{
+  cl_alloc_thread_cache *cache;
+  cl_alloc_cache_block *block = ptr;
+
+  if (ptr == NULL)
+    return;
+  assert(type < CL_ALLOC_CACHE_NUM);
+  cache = cl_alloc_get_cache();
+  if (cache == NULL || cache->num[type] >= CL_ALLOC_CACHE_MAX) {
+    cl_free(ptr);
+    return;
+  }
+
+  atomic_dec(cl_alloc_counter());
+  block->next = cache->head[type];
+  cache->head[type] = block;
+  cache->num[type]++;
+}
+
 LOCAL size_t
 cl_report_unfreed(void)
 {
-  return cl_alloc_n;
+  int32_t n = 0;
+  int i;
+  for (i = 0; i < CL_ALLOC_SHARD_NUM; i++)
+    n += atomic_read(&cl_alloc_n[i].n);
+  return n;
 }
 
 LOCAL void
 cl_report_set_all_freed(void)
 {
-  cl_alloc_n = 0;
+  int i;
+  for (i = 0; i < CL_ALLOC_SHARD_NUM; i++)
+    cl_alloc_n[i].n = 0;
 }
-
@@ -38,6 +38,34 @@ extern void *cl_realloc(void *ptr, size_t sz);
 /* Free a pointer allocated with cl_*alloc */
 extern void  cl_free(void *ptr);
 
+/* Pages and NUMA node of the host memory backing CL_MEM_ALLOC_HOST_PTR
+ * buffers, see CL_CONTEXT_HOST_ALLOC_PAGES_INTEL in cl_intel.h */
+typedef struct _cl_host_alloc_policy {
+  int pages;            /* CL_HOST_ALLOC_PAGES_*_INTEL */
+  int numa_node;        /* Preferred node, negative for the default policy */
+} cl_host_alloc_policy;
+
+/* Page aligned host memory placed following the policy. The memory is
+ * faulted in by several threads unless the policy is the default one. The
+ * returned size must be given back to cl_host_free */
+extern void *cl_host_alloc(size_t sz, const cl_host_alloc_policy *policy, size_t *alloc_sz);
+
+/* Free a block allocated with cl_host_alloc */
+extern void cl_host_free(void *ptr, size_t alloc_sz);
+
+/* Objects allocated and released on every enqueue, each type has a fixed size */
+typedef enum _cl_alloc_cache_type {
+  CL_ALLOC_CACHE_EVENT = 0,
+  CL_ALLOC_CACHE_KERNEL,
+  CL_ALLOC_CACHE_NUM
+} cl_alloc_cache_type;
+
+/* calloc from the per thread free list of the given type */
+extern void *cl_cache_calloc(cl_alloc_cache_type type, size_t sz);
+
+/* Give back a block allocated with cl_cache_calloc to the per thread free list */
+extern void cl_cache_free(cl_alloc_cache_type type, void *ptr);
+
 /* We count the number of allocation. This function report the number of
  * allocation still unfreed
  */
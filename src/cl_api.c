@@ -1259,6 +1259,8 @@ internal_clGetExtensionFunctionAddress(const char *func_name)
   EXTFUNC(clGetMemObjectFdIntel)
   EXTFUNC(clCreateBufferFromFdINTEL)
   EXTFUNC(clCreateImageFromFdINTEL)
+  EXTFUNC(clSetKernelArgsIntel)
+  EXTFUNC(clCreateFusedKernelIntel)
   EXTFUNC(clCreateAcceleratorINTEL)
   EXTFUNC(clRetainAcceleratorINTEL)
   EXTFUNC(clReleaseAcceleratorINTEL)
@@ -1492,6 +1494,43 @@ error:
   return mem;
 }
 
+cl_int
+clSetKernelArgsIntel(cl_kernel kernel,
+                     size_t args_size,
+                     const void *args)
+{
+  cl_int err = CL_SUCCESS;
+  CHECK_KERNEL(kernel);
+
+#ifdef HAS_CMRT
+  if (kernel->cmrt_kernel != NULL) {
+    err = CL_INVALID_KERNEL;
+    goto error;
+  }
+#endif
+  err = cl_kernel_set_args(kernel, args_size, args);
+error:
+  return err;
+}
+
+cl_kernel
+clCreateFusedKernelIntel(cl_context context,
+                         cl_uint num_kernels,
+                         const cl_kernel *kernels,
+                         cl_int *errcode_ret)
+{
+  cl_kernel kernel = NULL;
+  cl_int err = CL_SUCCESS;
+  CHECK_CONTEXT(context);
+  INVALID_VALUE_IF (kernels == NULL || num_kernels < 2);
+
+  kernel = cl_kernel_fuse(context, num_kernels, kernels, &err);
+error:
+  if (errcode_ret)
+    *errcode_ret = err;
+  return kernel;
+}
+
 cl_accelerator_intel
 clCreateAcceleratorINTEL(cl_context context,
                          cl_accelerator_type_intel accel_type,
@@ -150,6 +150,8 @@ clEnqueueNDRangeKernel(cl_command_queue command_queue,
       if (kernel->vme) {
         fixed_local_sz[0] = 16;
         fixed_local_sz[1] = 1;
+      } else if (cl_kernel_get_tuned_local_size(kernel, work_dim, fixed_local_sz)) {
+        /* Built-in kernel with a default for this device */
       } else {
         uint j, maxDimSize = 64 /* from 64? */, maxGroupSize = 256; //MAX_WORK_GROUP_SIZE may too large
         size_t realGroupSize = 1;
@@ -308,6 +308,8 @@ clEnqueueMapBuffer(cl_command_queue command_queue,
     data->unsync_map = 0;
     if (map_flags & (CL_MAP_WRITE | CL_MAP_WRITE_INVALIDATE_REGION))
       data->write_map = 1;
+    if (map_flags & CL_MAP_WRITE_INVALIDATE_REGION)
+      data->invalidate_map = 1;
 
     if (e_status == CL_COMPLETE) {
       // Sync mode, no need to queue event.
@@ -326,7 +328,7 @@ clEnqueueMapBuffer(cl_command_queue command_queue,
 
     ptr = data->ptr;
     assert(ptr);
-    err = cl_mem_record_map_mem(buffer, ptr, &mem_ptr, offset, size, NULL, NULL);
+    err = cl_mem_record_map_mem(buffer, ptr, &mem_ptr, offset, size, NULL, NULL, data->write_map);
     assert(err == CL_SUCCESS);
   } while (0);
 
@@ -669,6 +671,7 @@ clEnqueueWriteBuffer(cl_command_queue command_queue,
 
     data = &e->exec_data;
     data->type = EnqueueWriteBuffer;
+    data->queue = command_queue;
     data->mem_obj = buffer;
     data->const_ptr = ptr;
     data->offset = offset;
@@ -1594,15 +1597,18 @@ clEnqueueMapImageByKernel(cl_command_queue command_queue,
     return NULL;
   }
 
-  cl_event e;
-  err = clEnqueueCopyImageToBuffer(command_queue, mem, image->tmp_ker_buf, copy_origin,
-    copy_region, 0, num_events_in_wait_list, event_wait_list, &e);
-  if (err != CL_SUCCESS && errcode_ret) {
-    clReleaseMemObject(image->tmp_ker_buf);
-    clReleaseEvent(e);
-    image->tmp_ker_buf = NULL;
-    *errcode_ret = err;
-    return NULL;
+  /* The content of an invalidated region is undefined, no need to copy it */
+  cl_event e = NULL;
+  if (!(map_flags & CL_MAP_WRITE_INVALIDATE_REGION)) {
+    err = clEnqueueCopyImageToBuffer(command_queue, mem, image->tmp_ker_buf, copy_origin,
+      copy_region, 0, num_events_in_wait_list, event_wait_list, &e);
+    if (err != CL_SUCCESS && errcode_ret) {
+      clReleaseMemObject(image->tmp_ker_buf);
+      clReleaseEvent(e);
+      image->tmp_ker_buf = NULL;
+      *errcode_ret = err;
+      return NULL;
+    }
   }
 
   if (mem->flags & CL_MEM_USE_HOST_PTR) {
@@ -1621,11 +1627,16 @@ clEnqueueMapImageByKernel(cl_command_queue command_queue,
       *image_row_pitch = region[0] * image->bpp;
   }
 
-  ptr = clEnqueueMapBuffer(command_queue, image->tmp_ker_buf, blocking_map, map_flags, 0,
-      buf_size, 1, &e, event, &err);
+  if (e)
+    ptr = clEnqueueMapBuffer(command_queue, image->tmp_ker_buf, blocking_map, map_flags, 0,
+        buf_size, 1, &e, event, &err);
+  else
+    ptr = clEnqueueMapBuffer(command_queue, image->tmp_ker_buf, blocking_map, map_flags, 0,
+        buf_size, num_events_in_wait_list, event_wait_list, event, &err);
   if (err != CL_SUCCESS && errcode_ret) {
     clReleaseMemObject(image->tmp_ker_buf);
-    clReleaseEvent(e);
+    if (e)
+      clReleaseEvent(e);
     image->tmp_ker_buf = NULL;
     *errcode_ret = err;
     return NULL;
@@ -1637,7 +1648,8 @@ clEnqueueMapImageByKernel(cl_command_queue command_queue,
   assert(err == CL_SUCCESS); // Easy way, do not use unmap to handle error.
   if (errcode_ret)
     *errcode_ret = err;
-  clReleaseEvent(e);
+  if (e)
+    clReleaseEvent(e);
   return mem_ptr;
 }
 
@@ -1763,6 +1775,8 @@ clEnqueueMapImage(cl_command_queue command_queue,
     data->unsync_map = 1;
     if (map_flags & (CL_MAP_WRITE | CL_MAP_WRITE_INVALIDATE_REGION))
       data->write_map = 1;
+    if (map_flags & CL_MAP_WRITE_INVALIDATE_REGION)
+      data->invalidate_map = 1;
 
     if (e_status == CL_COMPLETE) {
       // Sync mode, no need to queue event.
@@ -1801,7 +1815,7 @@ clEnqueueMapImage(cl_command_queue command_queue,
       offset = image->bpp * origin[0] + image->row_pitch * origin[1] + image->slice_pitch * origin[2];
     }
 
-    err = cl_mem_record_map_mem(mem, ptr, &mem_ptr, offset, 0, origin, region);
+    err = cl_mem_record_map_mem(mem, ptr, &mem_ptr, offset, 0, origin, region, data->write_map);
     assert(err == CL_SUCCESS); // Easy way, do not use unmap to handle error.
   } while (0);
 
@@ -166,11 +166,28 @@ cl_command_queue_bind_image(cl_command_queue queue, cl_kernel k, cl_gpgpu gpgpu,
   return CL_SUCCESS;
 }
 
+/* Access of the argument found by the compiler, it picks the cache policy */
+static uint32_t
+cl_command_queue_arg_access(cl_kernel k, uint32_t index)
+{
+  uint32_t access = interp_kernel_get_arg_access(k->opaque, index);
+  uint32_t buf_access = 0;
+  if (access & GBE_ARG_ACCESS_READ)
+    buf_access |= GPGPU_BUF_READ;
+  if (access & GBE_ARG_ACCESS_WRITE)
+    buf_access |= GPGPU_BUF_WRITE;
+  if (access & GBE_ARG_ACCESS_REUSED)
+    buf_access |= GPGPU_BUF_REUSED;
+  if (access & GBE_ARG_ACCESS_CONSTANT)
+    buf_access |= GPGPU_BUF_CONSTANT;
+  return buf_access;
+}
+
 LOCAL cl_int
 cl_command_queue_bind_surface(cl_command_queue queue, cl_kernel k, cl_gpgpu gpgpu, uint32_t *max_bti)
 {
   /* Bind all user buffers (given by clSetKernelArg) */
-  uint32_t i, bti;
+  uint32_t i, bti, access;
   uint32_t ocl_version = interp_kernel_get_ocl_version(k->opaque);
   enum gbe_arg_type arg_type; /* kind of argument */
   for (i = 0; i < k->arg_n; ++i) {
@@ -187,15 +204,16 @@ cl_command_queue_bind_surface(cl_command_queue queue, cl_kernel k, cl_gpgpu gpgp
     bti = interp_kernel_get_arg_bti(k->opaque, i);
     if(*max_bti < bti)
       *max_bti = bti;
+    access = cl_command_queue_arg_access(k, i);
     if (k->args[i].mem->type == CL_MEM_SUBBUFFER_TYPE) {
       struct _cl_mem_buffer* buffer = (struct _cl_mem_buffer*)k->args[i].mem;
-      cl_gpgpu_bind_buf(gpgpu, k->args[i].mem->bo, offset, k->args[i].mem->offset + buffer->sub_offset, k->args[i].mem->size, bti);
+      cl_gpgpu_bind_buf(gpgpu, k->args[i].mem->bo, offset, k->args[i].mem->offset + buffer->sub_offset, k->args[i].mem->size, bti, access);
     } else {
       size_t mem_offset = 0; //
       if(k->args[i].is_svm) {
         mem_offset = (size_t)k->args[i].ptr - (size_t)k->args[i].mem->host_ptr;
       }
-      cl_gpgpu_bind_buf(gpgpu, k->args[i].mem->bo, offset, k->args[i].mem->offset + mem_offset, k->args[i].mem->size, bti);
+      cl_gpgpu_bind_buf(gpgpu, k->args[i].mem->bo, offset, k->args[i].mem->offset + mem_offset, k->args[i].mem->size, bti, access);
     }
   }
   return CL_SUCCESS;
@@ -218,7 +236,8 @@ cl_command_queue_bind_exec_info(cl_command_queue queue, cl_kernel k, cl_gpgpu gp
     if (mem) {
       mem_offset = (size_t)ptr - (size_t)mem->host_ptr;
       /* only need realloc in surface state, don't need realloc in curbe */
-      cl_gpgpu_bind_buf(gpgpu, mem->bo, offset + i * sizeof(ptr), mem->offset + mem_offset, mem->size, bti++);
+      cl_gpgpu_bind_buf(gpgpu, mem->bo, offset + i * sizeof(ptr), mem->offset + mem_offset, mem->size, bti++,
+                        GPGPU_BUF_DEFAULT);
       if(bti == BTI_WORKAROUND_IMAGE_OFFSET)
         bti = *max_bti + BTI_WORKAROUND_IMAGE_OFFSET;
       assert(bti < BTI_MAX_ID);
@@ -27,6 +27,7 @@
 #include "cl_utils.h"
 #include "cl_alloc.h"
 #include "cl_device_enqueue.h"
+#include "cl_trace.h"
 
 #include <assert.h>
 #include <stdio.h>
@@ -135,7 +136,8 @@ cl_upload_constant_buffer(cl_command_queue queue, cl_kernel ker, cl_gpgpu gpgpu)
       size_t global_const_size = interp_program_get_global_constant_size(ker->program->opaque);
       if (global_const_size > 0) {
         *(char **)(ker->curbe + constant_addrspace) = ker->program->global_data_ptr;
-        cl_gpgpu_bind_buf(gpgpu, ker->program->global_data, constant_addrspace, 0, ALIGN(global_const_size, getpagesize()), BTI_CONSTANT);
+        cl_gpgpu_bind_buf(gpgpu, ker->program->global_data, constant_addrspace, 0, ALIGN(global_const_size, getpagesize()), BTI_CONSTANT,
+                          GPGPU_BUF_READ | GPGPU_BUF_CONSTANT);
       }
     }
     return 0;
@@ -391,7 +393,7 @@ cl_command_queue_ND_range_gen7(cl_command_queue queue,
   kernel.grf_blocks = 128;
   kernel.bo = ker->bo;
   kernel.barrierID = 0;
-  kernel.slm_sz = 0;
+  kernel.slm_sz = interp_kernel_get_slm_size(ker->opaque);
   kernel.use_slm = interp_kernel_use_slm(ker->opaque);
 
   /* Compute the number of HW threads we need */
@@ -476,6 +478,11 @@ cl_command_queue_ND_range_gen7(cl_command_queue queue,
       goto error;
   }
 
+  if (UNLIKELY(cl_trace_enabled()))
+    cl_trace_ndrange(queue, ker, work_dim, global_wk_off, global_dim_off, global_wk_sz,
+                     global_wk_sz_use, local_wk_sz, local_wk_sz_use, simd_sz,
+                     thread_n, kernel.slm_sz, scratch_sz);
+
   /* Start a new batch buffer */
   batch_sz = cl_kernel_compute_batch_sz(ker);
   if (cl_gpgpu_batch_reset(gpgpu, batch_sz) != 0)
@@ -33,6 +33,7 @@
 
 #include "CL/cl.h"
 #include "CL/cl_gl.h"
+#include "CL/cl_intel.h"
 
 #include <stdio.h>
 #include <stdlib.h>
@@ -77,10 +78,10 @@ cl_context_add_mem(cl_context ctx, cl_mem mem) {
   assert(mem->ctx == NULL);
   cl_context_add_ref(ctx);
 
-  CL_OBJECT_LOCK(ctx);
+  pthread_rwlock_wrlock(&ctx->mem_lock);
   list_add_tail(&ctx->mem_objects, &mem->base.node);
   ctx->mem_object_num++;
-  CL_OBJECT_UNLOCK(ctx);
+  pthread_rwlock_unlock(&ctx->mem_lock);
 
   mem->ctx = ctx;
 }
@@ -88,10 +89,10 @@ cl_context_add_mem(cl_context ctx, cl_mem mem) {
 LOCAL void
 cl_context_remove_mem(cl_context ctx, cl_mem mem) {
   assert(mem->ctx == ctx);
-  CL_OBJECT_LOCK(ctx);
+  pthread_rwlock_wrlock(&ctx->mem_lock);
   list_node_del(&mem->base.node);
   ctx->mem_object_num--;
-  CL_OBJECT_UNLOCK(ctx);
+  pthread_rwlock_unlock(&ctx->mem_lock);
 
   cl_context_delete(ctx);
   mem->ctx = NULL;
@@ -102,10 +103,10 @@ cl_context_add_sampler(cl_context ctx, cl_sampler sampler) {
   assert(sampler->ctx == NULL);
   cl_context_add_ref(ctx);
 
-  CL_OBJECT_LOCK(ctx);
+  pthread_mutex_lock(&ctx->sampler_lock);
   list_add_tail(&ctx->samplers, &sampler->base.node);
   ctx->sampler_num++;
-  CL_OBJECT_UNLOCK(ctx);
+  pthread_mutex_unlock(&ctx->sampler_lock);
 
   sampler->ctx = ctx;
 }
@@ -113,10 +114,10 @@ cl_context_add_sampler(cl_context ctx, cl_sampler sampler) {
 LOCAL void
 cl_context_remove_sampler(cl_context ctx, cl_sampler sampler) {
   assert(sampler->ctx == ctx);
-  CL_OBJECT_LOCK(ctx);
+  pthread_mutex_lock(&ctx->sampler_lock);
   list_node_del(&sampler->base.node);
   ctx->sampler_num--;
-  CL_OBJECT_UNLOCK(ctx);
+  pthread_mutex_unlock(&ctx->sampler_lock);
 
   cl_context_delete(ctx);
   sampler->ctx = NULL;
@@ -127,10 +128,10 @@ cl_context_add_event(cl_context ctx, cl_event event) {
   assert(event->ctx == NULL);
   cl_context_add_ref(ctx);
 
-  CL_OBJECT_LOCK(ctx);
+  pthread_mutex_lock(&ctx->event_lock);
   list_add_tail(&ctx->events, &event->base.node);
   ctx->event_num++;
-  CL_OBJECT_UNLOCK(ctx);
+  pthread_mutex_unlock(&ctx->event_lock);
 
   event->ctx = ctx;
 }
@@ -138,10 +139,10 @@ cl_context_add_event(cl_context ctx, cl_event event) {
 LOCAL void
 cl_context_remove_event(cl_context ctx, cl_event event) {
   assert(event->ctx == ctx);
-  CL_OBJECT_LOCK(ctx);
+  pthread_mutex_lock(&ctx->event_lock);
   list_node_del(&event->base.node);
   ctx->event_num--;
-  CL_OBJECT_UNLOCK(ctx);
+  pthread_mutex_unlock(&ctx->event_lock);
 
   cl_context_delete(ctx);
   event->ctx = NULL;
@@ -152,10 +153,10 @@ cl_context_add_program(cl_context ctx, cl_program program) {
   assert(program->ctx == NULL);
   cl_context_add_ref(ctx);
 
-  CL_OBJECT_LOCK(ctx);
+  pthread_mutex_lock(&ctx->program_lock);
   list_add_tail(&ctx->programs, &program->base.node);
   ctx->program_num++;
-  CL_OBJECT_UNLOCK(ctx);
+  pthread_mutex_unlock(&ctx->program_lock);
 
   program->ctx = ctx;
 }
@@ -163,15 +164,83 @@ cl_context_add_program(cl_context ctx, cl_program program) {
 LOCAL void
 cl_context_remove_program(cl_context ctx, cl_program program) {
   assert(program->ctx == ctx);
-  CL_OBJECT_LOCK(ctx);
+  pthread_mutex_lock(&ctx->program_lock);
   list_node_del(&program->base.node);
   ctx->program_num--;
-  CL_OBJECT_UNLOCK(ctx);
+  pthread_mutex_unlock(&ctx->program_lock);
 
   cl_context_delete(ctx);
   program->ctx = NULL;
 }
 
+/* FNV-1a */
+static uint32_t
+cl_kernel_code_hash(const char *code, size_t size)
+{
+  uint32_t hash = 2166136261u;
+  size_t i;
+  for (i = 0; i < size; ++i)
+    hash = (hash ^ (uint8_t)code[i]) * 16777619u;
+  return hash;
+}
+
+LOCAL cl_kernel_code
+cl_context_get_kernel_code(cl_context ctx, const char *code, size_t size)
+{
+  const uint32_t hash = cl_kernel_code_hash(code, size);
+  cl_kernel_code kernel_code = NULL;
+  list_node *pos;
+
+  pthread_mutex_lock(&ctx->kernel_code_lock);
+  list_for_each(pos, &ctx->kernel_codes) {
+    cl_kernel_code it = list_entry(pos, _cl_kernel_code, node);
+    if (it->hash == hash && it->size == size && memcmp(it->code, code, size) == 0) {
+      kernel_code = it;
+      kernel_code->users++;
+      goto exit;
+    }
+  }
+
+  TRY_ALLOC_NO_ERR (kernel_code, CALLOC(_cl_kernel_code));
+  TRY_ALLOC_NO_ERR (kernel_code->code, cl_malloc(size));
+  kernel_code->bo = cl_buffer_alloc(cl_context_get_bufmgr(ctx), "CL kernel", size, 64u);
+  if (kernel_code->bo == NULL)
+    goto error;
+  cl_buffer_subdata(kernel_code->bo, 0, size, code);
+  memcpy(kernel_code->code, code, size);
+  kernel_code->size = size;
+  kernel_code->hash = hash;
+  kernel_code->users = 1;
+  list_add_tail(&ctx->kernel_codes, &kernel_code->node);
+
+exit:
+  pthread_mutex_unlock(&ctx->kernel_code_lock);
+  return kernel_code;
+error:
+  if (kernel_code) {
+    cl_free(kernel_code->code);
+    cl_free(kernel_code);
+  }
+  kernel_code = NULL;
+  goto exit;
+}
+
+LOCAL void
+cl_context_put_kernel_code(cl_context ctx, cl_kernel_code kernel_code)
+{
+  pthread_mutex_lock(&ctx->kernel_code_lock);
+  if (--kernel_code->users > 0) {
+    pthread_mutex_unlock(&ctx->kernel_code_lock);
+    return;
+  }
+  list_node_del(&kernel_code->node);
+  pthread_mutex_unlock(&ctx->kernel_code_lock);
+
+  cl_buffer_unreference(kernel_code->bo);
+  cl_free(kernel_code->code);
+  cl_free(kernel_code);
+}
+
 
 #define CHECK(var) \
   if (var) \
@@ -188,12 +257,23 @@ cl_context_properties_process(const cl_context_properties *prop,
       set_cl_egl_display_khr = 0,
       set_cl_glx_display_khr = 0,
       set_cl_wgl_hdc_khr = 0,
-      set_cl_cgl_sharegroup_khr = 0;
+      set_cl_cgl_sharegroup_khr = 0,
+      set_cl_host_alloc_pages = 0,
+      set_cl_host_alloc_numa_node = 0;
   cl_int err = CL_SUCCESS;
+  const char *env;
 
   cl_props->gl_type = CL_GL_NOSHARE;
   cl_props->platform_id = 0;
 
+  // can't use BVAR (backend/src/sys/cvar.hpp) here as it's C++
+  cl_props->host_alloc.pages = CL_HOST_ALLOC_PAGES_DEFAULT_INTEL;
+  cl_props->host_alloc.numa_node = -1;
+  if ((env = getenv("OCL_HOST_ALLOC_PAGES")) != NULL)
+    sscanf(env, "%i", &cl_props->host_alloc.pages);
+  if ((env = getenv("OCL_HOST_ALLOC_NUMA_NODE")) != NULL)
+    sscanf(env, "%i", &cl_props->host_alloc.numa_node);
+
   if (prop == NULL)
     goto exit;
 
@@ -232,6 +312,19 @@ cl_context_properties_process(const cl_context_properties *prop,
       cl_props->gl_type = CL_GL_CGL_SHAREGROUP;
       cl_props->cgl_sharegroup = *(prop + 1);
       break;
+    case CL_CONTEXT_HOST_ALLOC_PAGES_INTEL:
+      CHECK (set_cl_host_alloc_pages);
+      if (*(prop + 1) < CL_HOST_ALLOC_PAGES_DEFAULT_INTEL ||
+          *(prop + 1) > CL_HOST_ALLOC_PAGES_EXPLICIT_HUGE_INTEL) {
+        err = CL_INVALID_PROPERTY;
+        goto error;
+      }
+      cl_props->host_alloc.pages = *(prop + 1);
+      break;
+    case CL_CONTEXT_HOST_ALLOC_NUMA_NODE_INTEL:
+      CHECK (set_cl_host_alloc_numa_node);
+      cl_props->host_alloc.numa_node = *(prop + 1);
+      break;
     default:
       err = CL_INVALID_PROPERTY;
       goto error;
@@ -338,6 +431,13 @@ cl_context_new(struct _cl_context_prop *props, cl_uint dev_num, cl_device_id* al
   list_init(&ctx->samplers);
   list_init(&ctx->events);
   list_init(&ctx->programs);
+  list_init(&ctx->kernel_codes);
+  pthread_rwlock_init(&ctx->mem_lock, NULL);
+  pthread_mutex_init(&ctx->sampler_lock, NULL);
+  pthread_mutex_init(&ctx->event_lock, NULL);
+  pthread_mutex_init(&ctx->program_lock, NULL);
+  pthread_mutex_init(&ctx->fusion_lock, NULL);
+  pthread_mutex_init(&ctx->kernel_code_lock, NULL);
   ctx->queue_modify_disable = CL_FALSE;
   TRY_ALLOC_NO_ERR (ctx->drv, cl_driver_new(props));
   ctx->props = *props;
@@ -369,6 +469,8 @@ cl_context_delete(cl_context ctx)
   if (ctx->image_queue)
     ++internal_ctx_refs;
 
+  internal_ctx_refs += ctx->fused_kernel_num;
+
   /* We are not done yet */
   if (CL_OBJECT_DEC_REF(ctx) > internal_ctx_refs)
     return;
@@ -384,6 +486,8 @@ cl_context_delete(cl_context ctx)
     clReleaseCommandQueue(q);
   }
 
+  cl_kernel_fusion_clear_cache(ctx);
+
   /* delete the internal programs. */
   for (i = CL_INTERNAL_KERNEL_MIN; i < CL_INTERNAL_KERNEL_MAX; i++) {
     if (ctx->internal_kernels[i]) {
@@ -400,9 +504,18 @@ cl_context_delete(cl_context ctx)
 
   CL_OBJECT_DEC_REF(ctx);
 
+  /* All the programs are gone, so are their kernels */
+  assert(list_empty(&ctx->kernel_codes));
+
   cl_free(ctx->prop_user);
   cl_free(ctx->devices);
   cl_driver_delete(ctx->drv);
+  pthread_rwlock_destroy(&ctx->mem_lock);
+  pthread_mutex_destroy(&ctx->sampler_lock);
+  pthread_mutex_destroy(&ctx->event_lock);
+  pthread_mutex_destroy(&ctx->program_lock);
+  pthread_mutex_destroy(&ctx->fusion_lock);
+  pthread_mutex_destroy(&ctx->kernel_code_lock);
   CL_OBJECT_DESTROY_BASE(ctx);
   cl_free(ctx);
 }
@@ -473,8 +586,9 @@ cl_mem
 cl_context_get_svm_from_ptr(cl_context ctx, const void * p)
 {
   struct list_node *pos;
-  cl_mem buf;
+  cl_mem buf, found = NULL;
 
+  pthread_rwlock_rdlock(&ctx->mem_lock);
   list_for_each (pos, (&ctx->mem_objects)) {
     buf = (cl_mem)list_entry(pos, _cl_base_object, node);
     if(buf->host_ptr == NULL) continue;
@@ -482,23 +596,32 @@ cl_context_get_svm_from_ptr(cl_context ctx, const void * p)
     if(buf->type != CL_MEM_SVM_TYPE) continue;
     if((size_t)buf->host_ptr <= (size_t)p &&
        (size_t)p < ((size_t)buf->host_ptr + buf->size))
-      return buf;
+    {
+      found = buf;
+      break;
+    }
   }
-  return NULL;
+  pthread_rwlock_unlock(&ctx->mem_lock);
+  return found;
 }
 
 cl_mem
 cl_context_get_mem_from_ptr(cl_context ctx, const void * p)
 {
   struct list_node *pos;
-  cl_mem buf;
+  cl_mem buf, found = NULL;
 
+  pthread_rwlock_rdlock(&ctx->mem_lock);
   list_for_each (pos, (&ctx->mem_objects)) {
     buf = (cl_mem)list_entry(pos, _cl_base_object, node);
     if(buf->host_ptr == NULL) continue;
     if((size_t)buf->host_ptr <= (size_t)p &&
        (size_t)p < ((size_t)buf->host_ptr + buf->size))
-      return buf;
+    {
+      found = buf;
+      break;
+    }
   }
-  return NULL;
+  pthread_rwlock_unlock(&ctx->mem_lock);
+  return found;
 }
@@ -25,6 +25,7 @@
 #include "cl_internals.h"
 #include "cl_driver.h"
 #include "cl_base_object.h"
+#include "cl_alloc.h"
 
 #include <stdint.h>
 #include <pthread.h>
@@ -98,8 +99,21 @@ struct _cl_context_prop {
     cl_context_properties wgl_hdc;
     cl_context_properties cgl_sharegroup;
   };
+  cl_host_alloc_policy host_alloc;  /* Placement of the CL_MEM_ALLOC_HOST_PTR memory */
 };
 
+/* Gen code of a kernel in a bo, shared by the kernels of the context with
+   the same code */
+typedef struct _cl_kernel_code {
+  list_node node;                   /* Node in the context kernel_codes list */
+  cl_buffer bo;                     /* The code itself */
+  char *code;                       /* Copy of the code to compare with */
+  size_t size;                      /* Size of the code */
+  uint32_t hash;                    /* Hash of the code */
+  cl_uint users;                    /* Kernels set up with this code */
+} _cl_kernel_code;
+typedef _cl_kernel_code *cl_kernel_code;
+
 #define IS_EGL_CONTEXT(ctx)  (ctx->props.gl_type == CL_GL_EGL_DISPLAY)
 #define EGL_DISP(ctx)   (EGLDisplay)(ctx->props.egl_display)
 #define EGL_CTX(ctx)    (EGLContext)(ctx->props.gl_context)
@@ -114,12 +128,16 @@ struct _cl_context {
   cl_uint queue_modify_disable;     /* Temp disable queue list change. */
   list_head mem_objects;            /* All memory object currently allocated */
   cl_uint mem_object_num;           /* All memory number currently allocated */
+  pthread_rwlock_t mem_lock;        /* Protect mem_objects, lookups only read */
   list_head samplers;               /* All sampler object currently allocated */
   cl_uint sampler_num;              /* All sampler number currently allocated */
+  pthread_mutex_t sampler_lock;     /* Protect samplers */
   list_head events;                 /* All event object currently allocated */
   cl_uint event_num;                /* All event number currently allocated */
+  pthread_mutex_t event_lock;       /* Protect events */
   list_head programs;               /* All programs currently allocated */
   cl_uint program_num;              /* All program number currently allocated */
+  pthread_mutex_t program_lock;     /* Protect programs */
 
   cl_accelerator_intel accels;      /* All accelerator_intel object currently allocated */
   cl_program internal_prgs[CL_INTERNAL_KERNEL_MAX];
@@ -134,6 +152,11 @@ struct _cl_context {
                                      /* User's callback when error occur in context */
   void *user_data;                   /* A pointer to user supplied data */
   cl_command_queue image_queue;      /* A internal command queue for image data copying */
+  struct _cl_fused_kernel *fused_kernels; /* Programs of the fused kernel sequences */
+  cl_uint fused_kernel_num;          /* Number of fused programs, each one holds a ref */
+  pthread_mutex_t fusion_lock;       /* Protect fused_kernels, held during the build */
+  list_head kernel_codes;           /* Code bos of the kernels, one per distinct code */
+  pthread_mutex_t kernel_code_lock; /* Protect kernel_codes */
 };
 
 #define CL_OBJECT_CONTEXT_MAGIC 0x20BBCADE993134AALL
@@ -151,6 +174,9 @@ extern void cl_context_add_event(cl_context ctx, cl_event sampler);
 extern void cl_context_remove_event(cl_context ctx, cl_event sampler);
 extern void cl_context_add_program(cl_context ctx, cl_program program);
 extern void cl_context_remove_program(cl_context ctx, cl_program program);
+/* Get the code bo of a kernel, shared with the kernels having the same code */
+extern cl_kernel_code cl_context_get_kernel_code(cl_context ctx, const char *code, size_t size);
+extern void cl_context_put_kernel_code(cl_context ctx, cl_kernel_code kernel_code);
 
 /* Implement OpenCL function */
 extern cl_context cl_create_context(const cl_context_properties*,
@@ -76,7 +76,7 @@ cl_device_enqueue_bind_buffer(cl_gpgpu gpgpu, cl_kernel ker, uint32_t *max_bti,
 
     mem = cl_context_get_svm_from_ptr(ker->program->ctx, ker->device_enqueue_ptr);
     assert(mem);
-    cl_gpgpu_bind_buf(gpgpu, mem->bo, offset, 0, buf_size, *max_bti);
+    cl_gpgpu_bind_buf(gpgpu, mem->bo, offset, 0, buf_size, *max_bti, GPGPU_BUF_DEFAULT);
 
     cl_gpgpu_set_kernel(gpgpu, ker);
   }
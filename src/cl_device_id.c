@@ -1448,7 +1448,7 @@ static int
 cl_check_builtin_kernel_dimension(cl_kernel kernel, cl_device_id device)
 {
   const char * n = cl_kernel_get_name(kernel);
-  const char * builtin_kernels_2d = "__cl_copy_image_2d_to_2d;__cl_copy_image_2d_to_buffer;__cl_copy_buffer_to_image_2d;__cl_fill_image_2d;__cl_fill_image_2d_array;";
+  const char * builtin_kernels_2d = "__cl_copy_image_2d_to_2d;__cl_copy_image_2d_to_buffer;__cl_copy_buffer_to_image_2d;__cl_fill_image_2d;__cl_fill_image_2d_array;transpose_float_intel;pyramid_down_intel;";
   const char * builtin_kernels_3d = "__cl_copy_image_3d_to_2d;__cl_copy_image_2d_to_3d;__cl_copy_image_3d_to_3d;__cl_copy_image_3d_to_buffer;__cl_copy_buffer_to_image_3d;__cl_fill_image_3d";
     if (n == NULL || !strstr(device->built_in_kernels, n)){
       return 0;
@@ -1529,7 +1529,17 @@ cl_get_kernel_workgroup_info(cl_kernel kernel,
       size_t local_mem_sz =  interp_kernel_get_slm_size(kernel->opaque) + kernel->local_mem_sz;
       _DECL_FIELD(local_mem_sz)
     }
-    DECL_FIELD(COMPILE_WORK_GROUP_SIZE, kernel->compile_wg_sz)
+    case CL_KERNEL_COMPILE_WORK_GROUP_SIZE:
+    {
+      /* The built-in kernels without reqd_work_group_size report the size
+       * they run with when no local size is given, so that the application
+       * can size the per group buffers of scan and radix sort */
+      size_t compile_wg_sz[3];
+      memcpy(compile_wg_sz, kernel->compile_wg_sz, sizeof(compile_wg_sz));
+      if (compile_wg_sz[0] == 0 && compile_wg_sz[1] == 0 && compile_wg_sz[2] == 0)
+        cl_kernel_get_tuned_local_size(kernel, 3, compile_wg_sz);
+      _DECL_FIELD(compile_wg_sz)
+    }
     DECL_FIELD(PRIVATE_MEM_SIZE, kernel->stack_size)
     case CL_KERNEL_GLOBAL_WORK_SIZE:
     {
@@ -112,6 +112,21 @@ typedef enum cl_mtllc_cache_control {
   mtllc_wb       = 0x3<<5
 } cl_mtllc_cache_control;
 
+/* LLC/eLLC age for QUADLRU on gen8 */
+typedef enum cl_llc_age_control {
+  llc_age_poor   = 0x0,
+  llc_age_good   = 0x3
+} cl_llc_age_control;
+
+/* How a kernel accesses a buffer surface, picks its cache control */
+typedef enum cl_gpgpu_buf_access {
+  GPGPU_BUF_READ     = 1 << 0,
+  GPGPU_BUF_WRITE    = 1 << 1,
+  GPGPU_BUF_REUSED   = 1 << 2,  /* accessed in a loop */
+  GPGPU_BUF_CONSTANT = 1 << 3,
+  GPGPU_BUF_DEFAULT  = GPGPU_BUF_READ | GPGPU_BUF_WRITE
+} cl_gpgpu_buf_access;
+
 typedef enum gpu_command_status {
   command_queued    = 3,
   command_submitted = 2,
@@ -144,7 +159,7 @@ typedef void (cl_gpgpu_sync_cb)(void*);
 extern cl_gpgpu_sync_cb *cl_gpgpu_sync;
 
 /* Bind a regular unformatted buffer */
-typedef void (cl_gpgpu_bind_buf_cb)(cl_gpgpu, cl_buffer, uint32_t offset, uint32_t internal_offset, size_t size, uint8_t bti);
+typedef void (cl_gpgpu_bind_buf_cb)(cl_gpgpu, cl_buffer, uint32_t offset, uint32_t internal_offset, size_t size, uint8_t bti, uint32_t access);
 extern cl_gpgpu_bind_buf_cb *cl_gpgpu_bind_buf;
 
 typedef void (cl_gpgpu_set_kernel_cb)(cl_gpgpu, void *);
@@ -25,9 +25,13 @@
 #include "cl_utils.h"
 #include "cl_alloc.h"
 #include "cl_device_enqueue.h"
+#include "cl_mem.h"
+#include "cl_context.h"
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
 #include <assert.h>
+#include <unistd.h>
 #include <pthread.h>
 
 static cl_int
@@ -119,6 +123,198 @@ error:
   return err;
 }
 
+/* Streamed writes: the host data is copied by worker threads into a ring of
+ * staging buffers, and the GPU copies every staging buffer into place as soon
+ * as it is filled. The copies of the host, of the GPU and the application all
+ * run at the same time and the staging memory stays bounded. */
+#define CL_STREAM_WRITE_CHUNK (4u << 20)
+#define CL_STREAM_WRITE_SLOTS 4
+#define CL_STREAM_WRITE_MAX_THREADS 4
+
+static pthread_once_t stream_write_once = PTHREAD_ONCE_INIT;
+static size_t stream_write_min = 16u << 20;
+
+static void
+cl_stream_write_init(void)
+{
+  // can't use BVAR (backend/src/sys/cvar.hpp) here as it's C++
+  const char *env = getenv("OCL_STREAM_WRITE_MIN");
+  unsigned long min;
+  if (env != NULL && sscanf(env, "%lu", &min) == 1)
+    stream_write_min = min;
+}
+
+static int
+cl_enqueue_write_is_streamed(cl_mem mem, size_t size)
+{
+  pthread_once(&stream_write_once, cl_stream_write_init);
+  return !mem->is_userptr && stream_write_min != 0 && size >= stream_write_min;
+}
+
+typedef struct _cl_stream_write {
+  pthread_mutex_t lock;
+  pthread_cond_t cond;
+  const char *src;
+  size_t size;
+  uint32_t chunk_n;
+  uint32_t next_chunk;                       /* Next chunk a worker copies */
+  uint32_t fill_limit;                       /* Chunks below it have a free slot */
+  int32_t filled[CL_STREAM_WRITE_SLOTS];     /* Chunk each slot holds, -1 if none */
+  cl_mem staging[CL_STREAM_WRITE_SLOTS];
+  cl_int err;
+} cl_stream_write;
+
+static void *
+cl_stream_write_worker(void *arg)
+{
+  cl_stream_write *s = arg;
+  uint32_t chunk;
+
+  pthread_mutex_lock(&s->lock);
+  while (s->err == CL_SUCCESS && s->next_chunk < s->chunk_n) {
+    chunk = s->next_chunk++;
+    while (s->err == CL_SUCCESS && chunk >= s->fill_limit)
+      pthread_cond_wait(&s->cond, &s->lock);
+    if (s->err != CL_SUCCESS)
+      break;
+    pthread_mutex_unlock(&s->lock);
+
+    const size_t offset = (size_t)chunk * CL_STREAM_WRITE_CHUNK;
+    const size_t sz = MIN(s->size - offset, CL_STREAM_WRITE_CHUNK);
+    const int failed = cl_buffer_subdata(s->staging[chunk % CL_STREAM_WRITE_SLOTS]->bo,
+                                         0, sz, s->src + offset) != 0;
+
+    pthread_mutex_lock(&s->lock);
+    if (failed)
+      s->err = CL_MAP_FAILURE;
+    else
+      s->filled[chunk % CL_STREAM_WRITE_SLOTS] = chunk;
+    pthread_cond_broadcast(&s->cond);
+  }
+  pthread_mutex_unlock(&s->lock);
+  return NULL;
+}
+
+/* Wait for the GPU copy of a chunk, its slot can then be filled again */
+static void
+cl_stream_write_retire(cl_stream_write *s, cl_event *copy, uint32_t chunk)
+{
+  cl_event e = copy[chunk % CL_STREAM_WRITE_SLOTS];
+  void *batch_buf = cl_gpgpu_ref_batch_buf(e->exec_data.gpgpu);
+  cl_gpgpu_sync(batch_buf);
+  cl_gpgpu_unref_batch_buf(batch_buf);
+  cl_event_delete(e);
+  copy[chunk % CL_STREAM_WRITE_SLOTS] = NULL;
+
+  pthread_mutex_lock(&s->lock);
+  s->fill_limit = chunk + 1 + CL_STREAM_WRITE_SLOTS;
+  pthread_cond_broadcast(&s->cond);
+  pthread_mutex_unlock(&s->lock);
+}
+
+static cl_int
+cl_enqueue_write_buffer_streamed(enqueue_data *data)
+{
+  cl_command_queue queue = data->queue;
+  cl_context ctx = queue->ctx;
+  cl_mem mem = data->mem_obj;
+  cl_stream_write s;
+  cl_event copy[CL_STREAM_WRITE_SLOTS] = {NULL};
+  pthread_t threads[CL_STREAM_WRITE_MAX_THREADS];
+  int started[CL_STREAM_WRITE_MAX_THREADS] = {0};
+  long thread_n = sysconf(_SC_NPROCESSORS_ONLN);
+  uint32_t chunk, retired = 0;
+  cl_int err = CL_SUCCESS;
+  int i, worker_n = 0;
+
+  memset(&s, 0, sizeof(s));
+  pthread_mutex_init(&s.lock, NULL);
+  pthread_cond_init(&s.cond, NULL);
+  s.src = data->const_ptr;
+  s.size = data->size;
+  s.chunk_n = (data->size + CL_STREAM_WRITE_CHUNK - 1) / CL_STREAM_WRITE_CHUNK;
+  s.fill_limit = CL_STREAM_WRITE_SLOTS;
+  for (i = 0; i < CL_STREAM_WRITE_SLOTS; i++) {
+    s.filled[i] = -1;
+    s.staging[i] = cl_mem_new_buffer(ctx, 0, CL_STREAM_WRITE_CHUNK, NULL, &err);
+    if (s.staging[i] == NULL)
+      goto exit;
+  }
+
+  if (thread_n > CL_STREAM_WRITE_MAX_THREADS)
+    thread_n = CL_STREAM_WRITE_MAX_THREADS;
+  for (i = 0, worker_n = 0; i < thread_n; i++) {
+    started[i] = pthread_create(&threads[i], NULL, cl_stream_write_worker, &s) == 0;
+    worker_n += started[i];
+  }
+
+  for (chunk = 0; chunk < s.chunk_n; chunk++) {
+    const size_t offset = (size_t)chunk * CL_STREAM_WRITE_CHUNK;
+    const size_t sz = MIN(data->size - offset, CL_STREAM_WRITE_CHUNK);
+    cl_event e;
+
+    if (worker_n == 0) {
+      /* No worker could start, this thread fills the slots itself */
+      if (cl_buffer_subdata(s.staging[chunk % CL_STREAM_WRITE_SLOTS]->bo, 0, sz, s.src + offset) != 0) {
+        err = CL_MAP_FAILURE;
+        break;
+      }
+    } else {
+      pthread_mutex_lock(&s.lock);
+      while (s.err == CL_SUCCESS && s.filled[chunk % CL_STREAM_WRITE_SLOTS] != (int32_t)chunk)
+        pthread_cond_wait(&s.cond, &s.lock);
+      err = s.err;
+      pthread_mutex_unlock(&s.lock);
+      if (err != CL_SUCCESS)
+        break;
+    }
+
+    /* The copy is an internal event, never seen by the queue */
+    e = cl_event_create(ctx, queue, 0, NULL, CL_COMMAND_COPY_BUFFER, &err);
+    if (e == NULL)
+      break;
+    copy[chunk % CL_STREAM_WRITE_SLOTS] = e;
+    err = cl_mem_copy(queue, e, s.staging[chunk % CL_STREAM_WRITE_SLOTS], mem,
+                      0, data->offset + offset, sz);
+    if (err == CL_SUCCESS && cl_command_queue_flush_gpgpu(e->exec_data.gpgpu) != 0)
+      err = CL_OUT_OF_RESOURCES;
+    if (err != CL_SUCCESS)
+      break;
+
+    /* Keep one slot being filled while the others are copied */
+    if (chunk + 1 >= CL_STREAM_WRITE_SLOTS - 1) {
+      cl_stream_write_retire(&s, copy, retired);
+      retired++;
+    }
+  }
+
+  pthread_mutex_lock(&s.lock);
+  if (err != CL_SUCCESS)
+    s.err = err;
+  pthread_cond_broadcast(&s.cond);
+  pthread_mutex_unlock(&s.lock);
+  for (i = 0; i < CL_STREAM_WRITE_MAX_THREADS; i++)
+    if (started[i])
+      pthread_join(threads[i], NULL);
+  for (; retired < s.chunk_n; retired++) {
+    if (copy[retired % CL_STREAM_WRITE_SLOTS] == NULL)
+      continue;
+    if (copy[retired % CL_STREAM_WRITE_SLOTS]->exec_data.gpgpu == NULL) {
+      cl_event_delete(copy[retired % CL_STREAM_WRITE_SLOTS]);
+      copy[retired % CL_STREAM_WRITE_SLOTS] = NULL;
+      continue;
+    }
+    cl_stream_write_retire(&s, copy, retired);
+  }
+
+exit:
+  for (i = 0; i < CL_STREAM_WRITE_SLOTS; i++)
+    cl_mem_delete(s.staging[i]);
+  pthread_cond_destroy(&s.cond);
+  pthread_mutex_destroy(&s.lock);
+  return err;
+}
+
 static cl_int
 cl_enqueue_write_buffer(enqueue_data *data, cl_int status)
 {
@@ -139,6 +335,8 @@ cl_enqueue_write_buffer(enqueue_data *data, cl_int status)
       memcpy((char *)dst_ptr + data->offset + buffer->sub_offset, data->const_ptr, data->size);
       cl_mem_unmap_auto(mem);
     }
+  } else if (data->queue && cl_enqueue_write_is_streamed(mem, data->size)) {
+    err = cl_enqueue_write_buffer_streamed(data);
   } else {
     if (cl_buffer_subdata(mem->bo, data->offset + buffer->sub_offset,
                           data->size, data->const_ptr) != 0)
@@ -317,7 +515,11 @@ cl_enqueue_map_buffer(enqueue_data *data, cl_int status)
     if ((mem->flags & CL_MEM_USE_HOST_PTR) && !mem->is_userptr) {
       assert(mem->host_ptr);
       ptr = (char *)ptr + data->offset + buffer->sub_offset;
-      memcpy(mem->host_ptr + data->offset + buffer->sub_offset, ptr, data->size);
+      /* The content of an invalidated region is undefined, skip the read back */
+      if (!data->invalidate_map)
+        memcpy(mem->host_ptr + data->offset + buffer->sub_offset, ptr, data->size);
+      if (data->write_map)
+        cl_mem_dirty_track_start(mem->host_ptr + data->offset + buffer->sub_offset, data->size);
     }
   }
 
@@ -359,7 +561,7 @@ cl_enqueue_map_image(enqueue_data *data, cl_int status)
 
     if(mem->flags & CL_MEM_USE_HOST_PTR) {
       assert(mem->host_ptr);
-      if (!mem->is_userptr)
+      if (!mem->is_userptr && !data->invalidate_map)
         //src and dst need add offset in function cl_mem_copy_image_region
         cl_mem_copy_image_region(data->origin, data->region,
                                  mem->host_ptr, image->host_row_pitch, image->host_slice_pitch,
@@ -378,6 +580,7 @@ cl_enqueue_unmap_mem_object(enqueue_data *data, cl_int status)
   int i, j;
   size_t mapped_size = 0;
   size_t origin[3], region[3];
+  uint8_t write_map = 0;
   void *v_ptr = NULL;
   void *mapped_ptr = data->ptr;
   cl_mem memobj = data->mem_obj;
@@ -393,6 +596,7 @@ cl_enqueue_unmap_mem_object(enqueue_data *data, cl_int status)
       memobj->mapped_ptr[i].ptr = NULL;
       mapped_size = memobj->mapped_ptr[i].size;
       v_ptr = memobj->mapped_ptr[i].v_ptr;
+      write_map = memobj->mapped_ptr[i].write_map;
       for (j = 0; j < 3; j++) {
         region[j] = memobj->mapped_ptr[i].region[j];
         origin[j] = memobj->mapped_ptr[i].origin[j];
@@ -401,6 +605,7 @@ cl_enqueue_unmap_mem_object(enqueue_data *data, cl_int status)
       }
       memobj->mapped_ptr[i].size = 0;
       memobj->mapped_ptr[i].v_ptr = NULL;
+      memobj->mapped_ptr[i].write_map = 0;
       memobj->map_ref--;
       break;
     }
@@ -414,8 +619,9 @@ cl_enqueue_unmap_mem_object(enqueue_data *data, cl_int status)
         memobj->type == CL_MEM_SVM_TYPE) {
       assert(mapped_ptr >= memobj->host_ptr &&
              mapped_ptr + mapped_size <= memobj->host_ptr + memobj->size);
-      /* Sync the data. */
-      if (!memobj->is_userptr)
+      /* Sync the data, a read only map has nothing to write back. */
+      if (!memobj->is_userptr && write_map &&
+          !cl_mem_dirty_track_stop(mapped_ptr, mapped_size, v_ptr))
         memcpy(v_ptr, mapped_ptr, mapped_size);
     } else {
       CHECK_IMAGE(memobj, image);
@@ -424,7 +630,7 @@ cl_enqueue_unmap_mem_object(enqueue_data *data, cl_int status)
         row_pitch = image->slice_pitch;
       else
         row_pitch = image->row_pitch;
-      if (!memobj->is_userptr)
+      if (!memobj->is_userptr && write_map)
         //v_ptr have added offset, host_ptr have not added offset.
         cl_mem_copy_image_region(origin, region, v_ptr, row_pitch, image->slice_pitch,
                                  memobj->host_ptr, image->host_row_pitch, image->host_slice_pitch,
@@ -70,6 +70,7 @@ typedef struct _enqueue_data {
   const cl_mem *mem_list;    /* mem_list of clEnqueueNativeKernel */
   uint8_t unsync_map;        /* Indicate the clEnqueueMapBuffer/Image is unsync map */
   uint8_t write_map;         /* Indicate if the clEnqueueMapBuffer is write enable */
+  uint8_t invalidate_map;    /* CL_MAP_WRITE_INVALIDATE_REGION, no need to read back */
   void ** pointers;          /* The svm_pointers of clEnqueueSVMFree  */
   size_t  pattern_size;      /* the pattern_size of clEnqueueSVMMemFill */
   void (*user_func)(void *); /* pointer to a host-callable user function */
@@ -144,12 +144,107 @@ cl_event_get_status(cl_event event)
   return ret;
 }
 
+/* Record e as a successor of dep. A dep already completed is resolved now,
+   the others decrement unresolved_num of e when they complete. */
+static cl_int
+cl_event_add_successor(cl_event dep, cl_event e)
+{
+  cl_event *successors;
+  cl_uint size;
+
+  CL_OBJECT_LOCK(dep);
+  if (dep->status <= CL_COMPLETE) {
+    CL_OBJECT_UNLOCK(dep);
+    atomic_dec(&e->unresolved_num);
+    return CL_SUCCESS;
+  }
+
+  if (dep->successor_num == dep->successor_size) {
+    size = dep->successor_size ? dep->successor_size * 2 : 4;
+    successors = cl_realloc(dep->successors, size * sizeof(cl_event));
+    if (successors == NULL) {
+      CL_OBJECT_UNLOCK(dep);
+      return CL_OUT_OF_HOST_MEMORY;
+    }
+    dep->successors = successors;
+    dep->successor_size = size;
+  }
+  dep->successors[dep->successor_num++] = e;
+  CL_OBJECT_UNLOCK(dep);
+  return CL_SUCCESS;
+}
+
+/* e is deleted before dep completes, forget about it */
+static void
+cl_event_remove_successor(cl_event dep, cl_event e)
+{
+  cl_uint i;
+
+  CL_OBJECT_LOCK(dep);
+  for (i = 0; i < dep->successor_num; i++) {
+    if (dep->successors[i] == e) {
+      dep->successors[i] = dep->successors[--dep->successor_num];
+      break;
+    }
+  }
+  CL_OBJECT_UNLOCK(dep);
+}
+
+/* The event has completed or failed, resolve it in all its successors and
+   wake up only the queues of the successors which become ready. Must be
+   called with the queues of the context locked in the context. */
+static void
+cl_event_resolve_successors(cl_event event)
+{
+  cl_command_queue *queues = NULL;
+  cl_command_queue queue;
+  cl_uint queue_num = 0;
+  cl_uint i, j;
+
+  CL_OBJECT_LOCK(event);
+  if (event->successor_num)
+    queues = cl_calloc(event->successor_num, sizeof(cl_command_queue));
+
+  for (i = 0; i < event->successor_num; i++) {
+    /* The successor may be deleted as soon as its last depend event is
+       resolved, do not touch it after the decrement. */
+    queue = event->successors[i]->queue;
+    if (atomic_dec(&event->successors[i]->unresolved_num) != 1 || queue == NULL)
+      continue;
+
+    if (queues == NULL) { // No memory, notify the queue now
+      cl_command_queue_notify(queue);
+      continue;
+    }
+
+    for (j = 0; j < queue_num; j++) {
+      if (queues[j] == queue)
+        break;
+    }
+    if (j == queue_num)
+      queues[queue_num++] = queue;
+  }
+
+  if (event->successors)
+    cl_free(event->successors);
+  event->successors = NULL;
+  event->successor_num = 0;
+  event->successor_size = 0;
+  CL_OBJECT_UNLOCK(event);
+
+  for (i = 0; i < queue_num; i++)
+    cl_command_queue_notify(queues[i]);
+
+  if (queues)
+    cl_free(queues);
+}
+
 static cl_event
 cl_event_new(cl_context ctx, cl_command_queue queue, cl_command_type type,
              cl_uint num_events, cl_event *event_list)
 {
   int i;
-  cl_event e = cl_calloc(1, sizeof(_cl_event));
+  cl_event e = cl_cache_calloc(CL_ALLOC_CACHE_EVENT, sizeof(_cl_event));
   if (e == NULL)
     return NULL;
 
@@ -176,6 +271,7 @@ cl_event_new(cl_context ctx, cl_command_queue queue, cl_command_type type,
 
   e->depend_events = event_list;
   e->depend_event_num = num_events;
+  e->unresolved_num = num_events;
   for (i = 0; i < 4; i++) {
     e->timestamp[i] = CL_EVENT_INVALID_TIMESTAMP;
   }
@@ -198,10 +294,16 @@ cl_event_delete(cl_event event)
   cl_enqueue_delete(&event->exec_data);
 
   assert(list_node_out_of_list(&event->enqueue_node));
+  assert(event->successor_num == 0);
+  if (event->successors)
+    cl_free(event->successors);
 
   if (event->depend_events) {
     assert(event->depend_event_num);
     for (i = 0; i < event->depend_event_num; i++) {
+      /* Never executed, some depend events still refer to it */
+      if (atomic_read(&event->unresolved_num) > 0)
+        cl_event_remove_successor(event->depend_events[i], event);
       cl_event_delete(event->depend_events[i]);
     }
     cl_free(event->depend_events);
@@ -219,7 +321,7 @@ cl_event_delete(cl_event event)
   cl_context_remove_event(event->ctx, event);
 
   CL_OBJECT_DESTROY_BASE(event);
-  cl_free(event);
+  cl_cache_free(CL_ALLOC_CACHE_EVENT, event);
 }
 
 LOCAL cl_event
@@ -287,6 +389,19 @@ cl_event_create(cl_context ctx, cl_command_queue queue, cl_uint num_events,
         break;
       }
       depend_events = NULL;
+
+      /* Build the dependency graph, the depend events resolve e when they complete */
+      for (i = 0; i < total_events; i++) {
+        err = cl_event_add_successor(e->depend_events[i], e);
+        if (err != CL_SUCCESS)
+          break;
+      }
+      if (err != CL_SUCCESS) {
+        /* The depend events are owned by e now */
+        cl_event_delete(e);
+        e = NULL;
+        break;
+      }
     }
   } while (0);
 
@@ -299,7 +414,7 @@ cl_event_create(cl_context ctx, cl_command_queue queue, cl_uint num_events,
     }
 
     // if set depend_events, must succeed.
-    assert(e->depend_events == NULL);
+    assert(e == NULL || e->depend_events == NULL);
     cl_event_delete(e);
   }
 
@@ -420,37 +535,27 @@ cl_event_set_status(cl_event event, cl_int status)
   /*  Wakeup all the waiter for status change. */
   CL_OBJECT_NOTIFY_COND(event);
 
-  if (event->status <= CL_COMPLETE) {
+  if (event->status <= CL_COMPLETE && (event->successor_num || CL_EVENT_IS_BARRIER(event))) {
     notify_queue = CL_TRUE;
   }
 
   CL_OBJECT_UNLOCK(event);
 
-  /* Need to notify all the command queue within the same context. */
+  /* Need to notify the command queues of the events depending on this one. */
   if (notify_queue) {
-    cl_command_queue queue = NULL;
-
     /*First, we need to remove it from queue's barrier list. */
     if (CL_EVENT_IS_BARRIER(event)) {
       assert(event->queue);
       cl_command_queue_remove_barrier_event(event->queue, event);
     }
 
-    /* Then, notify all the queues within the same context. */
     CL_OBJECT_LOCK(event->ctx);
     /* Disable remove and add queue to the context temporary. We need to
        make sure all the queues in the context currently are valid. */
     event->ctx->queue_modify_disable++;
     CL_OBJECT_UNLOCK(event->ctx);
-    list_for_each(pos, &event->ctx->queues)
-    {
-      queue = (cl_command_queue)(list_entry(pos, _cl_base_object, node));
-      assert(queue != NULL);
-      cl_command_queue_notify(queue);
-    }
+    cl_event_resolve_successors(event);
     CL_OBJECT_LOCK(event->ctx);
-    /* Disable remove and add queue to the context temporary. We need to
-       make sure all the queues in the context currently are valid. */
     event->ctx->queue_modify_disable--;
     CL_OBJECT_NOTIFY_COND(event->ctx);
     CL_OBJECT_UNLOCK(event->ctx);
@@ -607,6 +712,11 @@ cl_event_is_ready(cl_event event)
   int status;
   int ret_status = CL_COMPLETE;
 
+  /* Some depend events are still running, no need to look at them */
+  if (atomic_read(&event->unresolved_num) > 0)
+    return CL_QUEUED;
+
+  /* All resolved, only look for the errors to propagate */
   for (i = 0; i < event->depend_event_num; i++) {
     status = cl_event_get_status(event->depend_events[i]);
 
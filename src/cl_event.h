@@ -46,6 +46,10 @@ typedef struct _cl_event {
   cl_int status;              /* The execution status */
   cl_event *depend_events;    /* The events must complete before this. */
   cl_uint depend_event_num;   /* The depend events number. */
+  atomic_t unresolved_num;    /* The depend events not completed yet. */
+  cl_event *successors;       /* The events waiting for this one to complete. */
+  cl_uint successor_num;      /* The successor events number. */
+  cl_uint successor_size;     /* The successor array size. */
   list_head callbacks;        /* The events The event callback functions */
   list_node enqueue_node;     /* The node in the enqueue list. */
   cl_ulong timestamp[5];      /* The time stamps for profiling. */
@@ -34,6 +34,7 @@ gbe_program_new_from_llvm_binary_cb *compiler_program_new_from_llvm_binary = NUL
 gbe_program_serialize_to_binary_cb *compiler_program_serialize_to_binary = NULL;
 gbe_program_new_from_llvm_cb *compiler_program_new_from_llvm = NULL;
 gbe_program_clean_llvm_resource_cb *compiler_program_clean_llvm_resource = NULL;
+gbe_program_new_fused_cb *compiler_program_new_fused = NULL;
 
 //function pointer from libgbeinterp.so
 gbe_program_new_from_binary_cb *interp_program_new_from_binary = NULL;
@@ -53,6 +54,7 @@ gbe_kernel_get_code_size_cb *interp_kernel_get_code_size = NULL;
 gbe_kernel_get_arg_num_cb *interp_kernel_get_arg_num = NULL;
 gbe_kernel_get_arg_size_cb *interp_kernel_get_arg_size = NULL;
 gbe_kernel_get_arg_bti_cb *interp_kernel_get_arg_bti = NULL;
+gbe_kernel_get_arg_access_cb *interp_kernel_get_arg_access = NULL;
 gbe_kernel_get_arg_type_cb *interp_kernel_get_arg_type = NULL;
 gbe_kernel_get_arg_align_cb *interp_kernel_get_arg_align = NULL;
 gbe_kernel_get_simd_width_cb *interp_kernel_get_simd_width = NULL;
@@ -172,6 +174,10 @@ struct GbeLoaderInitializer
     if (interp_kernel_get_arg_bti == NULL)
       return false;
 
+    interp_kernel_get_arg_access = *(gbe_kernel_get_arg_access_cb**)dlsym(dlhInterp, "gbe_kernel_get_arg_access");
+    if (interp_kernel_get_arg_access == NULL)
+      return false;
+
     interp_kernel_get_arg_type = *(gbe_kernel_get_arg_type_cb**)dlsym(dlhInterp, "gbe_kernel_get_arg_type");
     if (interp_kernel_get_arg_type == NULL)
       return false;
@@ -339,6 +345,10 @@ struct GbeLoaderInitializer
       if (compiler_program_clean_llvm_resource == NULL)
         return;
 
+      compiler_program_new_fused = *(gbe_program_new_fused_cb **)dlsym(dlhCompiler, "gbe_program_new_fused");
+      if (compiler_program_new_fused == NULL)
+        return;
+
       compilerLoaded = true;
     }
   }
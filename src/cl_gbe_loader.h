@@ -35,6 +35,7 @@ extern gbe_program_new_from_llvm_binary_cb *compiler_program_new_from_llvm_binar
 extern gbe_program_serialize_to_binary_cb *compiler_program_serialize_to_binary;
 extern gbe_program_new_from_llvm_cb *compiler_program_new_from_llvm;
 extern gbe_program_clean_llvm_resource_cb *compiler_program_clean_llvm_resource;
+extern gbe_program_new_fused_cb *compiler_program_new_fused;
 
 extern gbe_program_new_from_binary_cb *interp_program_new_from_binary;
 extern gbe_program_get_global_constant_size_cb *interp_program_get_global_constant_size;
@@ -53,6 +54,7 @@ extern gbe_kernel_get_code_size_cb *interp_kernel_get_code_size;
 extern gbe_kernel_get_arg_num_cb *interp_kernel_get_arg_num;
 extern gbe_kernel_get_arg_size_cb *interp_kernel_get_arg_size;
 extern gbe_kernel_get_arg_bti_cb *interp_kernel_get_arg_bti;
+extern gbe_kernel_get_arg_access_cb *interp_kernel_get_arg_access;
 extern gbe_kernel_get_arg_type_cb *interp_kernel_get_arg_type;
 extern gbe_kernel_get_arg_align_cb *interp_kernel_get_arg_align;
 extern gbe_kernel_get_simd_width_cb *interp_kernel_get_simd_width;
@@ -153,6 +153,17 @@ DECL_INFO_STRING(built_in_kernels, "__cl_copy_region_align4;"
                                    "__cl_fill_image_2d;"
                                    "__cl_fill_image_2d_array;"
                                    "__cl_fill_image_3d;"
+                                   "scan_inclusive_add_uint_intel;"
+                                   "scan_exclusive_add_uint_intel;"
+                                   "scan_add_group_offsets_uint_intel;"
+                                   "reduce_segments_add_float_intel;"
+                                   "reduce_segments_add_uint_intel;"
+                                   "radix_sort_histogram_uint_intel;"
+                                   "radix_sort_scatter_uint_intel;"
+                                   "radix_sort_histogram_ulong_intel;"
+                                   "radix_sort_scatter_ulong_intel;"
+                                   "transpose_float_intel;"
+                                   "pyramid_down_intel;"
 #ifdef GEN7_DEVICE
                                    "block_motion_estimate_intel;"
 #endif
@@ -46,7 +46,7 @@ cl_kernel_delete(cl_kernel k)
   if (k->cmrt_kernel != NULL) {
     cmrt_destroy_kernel(k);
     CL_OBJECT_DESTROY_BASE(k);
-    cl_free(k);
+    cl_cache_free(CL_ALLOC_CACHE_KERNEL, k);
     return;
   }
 #endif
@@ -57,8 +57,12 @@ cl_kernel_delete(cl_kernel k)
 
   /* Release one reference on all bos we own */
   if (k->bo)       cl_buffer_unreference(k->bo);
+  if (k->code)     cl_context_put_kernel_code(k->program->ctx, k->code);
+  /* Dropped once the program is released, the context may go with it */
+  cl_context ctx = k->ref_its_context ? k->program->ctx : NULL;
   /* This will be true for kernels created by clCreateKernel */
   if (k->ref_its_program) cl_program_delete(k->program);
+  if (ctx) cl_context_delete(ctx);
   /* Release the curbe if allocated */
   if (k->curbe) cl_free(k->curbe);
   /* Release the argument array if required */
@@ -68,6 +72,8 @@ cl_kernel_delete(cl_kernel k)
         cl_mem_delete(k->args[i].mem);
     cl_free(k->args);
   }
+  if (k->arg_info)
+    cl_free(k->arg_info);
   if (k->image_sz)
     cl_free(k->images);
 
@@ -81,14 +87,14 @@ cl_kernel_delete(cl_kernel k)
 
   CL_OBJECT_DESTROY_BASE(k);
 
-  cl_free(k);
+  cl_cache_free(CL_ALLOC_CACHE_KERNEL, k);
 }
 
 LOCAL cl_kernel
 cl_kernel_new(cl_program p)
 {
   cl_kernel k = NULL;
-  TRY_ALLOC_NO_ERR (k, CALLOC(struct _cl_kernel));
+  TRY_ALLOC_NO_ERR (k, (struct _cl_kernel *)cl_cache_calloc(CL_ALLOC_CACHE_KERNEL, sizeof(struct _cl_kernel)));
   CL_OBJECT_INIT_BASE(k, CL_OBJECT_KERNEL_MAGIC);
   k->program = p;
   k->cmrt_kernel = NULL;
@@ -121,10 +127,31 @@ cl_kernel_add_ref(cl_kernel k)
   CL_OBJECT_INC_REF(k);
 }
 
-LOCAL cl_int
-cl_kernel_set_arg(cl_kernel k, cl_uint index, size_t sz, const void *value)
+/* Size taken by one argument in the packed struct of cl_kernel_set_args */
+static size_t
+cl_kernel_get_packed_arg_size(cl_kernel k, uint32_t index)
+{
+  switch (k->arg_info[index].type) {
+    case GBE_ARG_LOCAL_PTR:
+      return sizeof(size_t);
+    case GBE_ARG_SAMPLER:
+      return sizeof(cl_sampler);
+    case GBE_ARG_GLOBAL_PTR:
+    case GBE_ARG_CONSTANT_PTR:
+    case GBE_ARG_IMAGE:
+    case GBE_ARG_PIPE:
+      return sizeof(cl_mem);
+    default:
+      if (k->vme && index == 0)
+        return sizeof(cl_accelerator_intel);
+      return k->arg_info[index].size;
+  }
+}
+
+/* Validate an argument without changing the kernel */
+static cl_int
+cl_kernel_check_arg(cl_kernel k, cl_uint index, size_t sz, const void *value)
 {
-  int32_t offset;            /* where to patch */
   enum gbe_arg_type arg_type; /* kind of argument */
   size_t arg_sz;              /* size of the argument */
   cl_mem mem = NULL;          /* for __global, __constant and image arguments */
@@ -132,8 +159,8 @@ cl_kernel_set_arg(cl_kernel k, cl_uint index, size_t sz, const void *value)
 
   if (UNLIKELY(index >= k->arg_n))
     return CL_INVALID_ARG_INDEX;
-  arg_type = interp_kernel_get_arg_type(k->opaque, index);
-  arg_sz = interp_kernel_get_arg_size(k->opaque, index);
+  arg_type = k->arg_info[index].type;
+  arg_sz = k->arg_info[index].size;
 
   if (k->vme && index == 0) {
     //the best method is to return the arg type of GBE_ARG_ACCELERATOR_INTEL
@@ -142,8 +169,9 @@ cl_kernel_set_arg(cl_kernel k, cl_uint index, size_t sz, const void *value)
     //this easy way makes the size mismatched, so use another size check method.
     if (sz != sizeof(cl_accelerator_intel) || arg_sz != sizeof(cl_motion_estimation_desc_intel))
       return CL_INVALID_ARG_SIZE;
-    cl_accelerator_intel* accel = (cl_accelerator_intel*)value;
-    if ((*accel)->type != CL_ACCELERATOR_TYPE_MOTION_ESTIMATION_INTEL)
+    cl_accelerator_intel accel;
+    memcpy(&accel, value, sizeof(accel));
+    if (accel->type != CL_ACCELERATOR_TYPE_MOTION_ESTIMATION_INTEL)
       return CL_INVALID_ACCELERATOR_TYPE_INTEL;
   } else {
     if (UNLIKELY(arg_type != GBE_ARG_LOCAL_PTR && arg_sz != sz)) {
@@ -165,7 +193,9 @@ cl_kernel_set_arg(cl_kernel k, cl_uint index, size_t sz, const void *value)
     if (UNLIKELY(value == NULL))
       return CL_INVALID_ARG_VALUE;
 
-    cl_sampler s = *(cl_sampler*)value;
+    /* The packed arguments of clSetKernelArgsIntel may be unaligned */
+    cl_sampler s;
+    memcpy(&s, value, sizeof(s));
     if(!CL_OBJECT_IS_SAMPLER(s))
       return CL_INVALID_SAMPLER;
   } else {
@@ -174,7 +204,7 @@ cl_kernel_set_arg(cl_kernel k, cl_uint index, size_t sz, const void *value)
             arg_type == GBE_ARG_PIPE)))
       return CL_INVALID_ARG_VALUE;
     if(value != NULL)
-      mem = *(cl_mem*)value;
+      memcpy(&mem, value, sizeof(mem));
     if(arg_type == GBE_ARG_PIPE) {
       _cl_mem_pipe* pipe= cl_mem_pipe(mem);
       size_t type_size = (size_t)interp_kernel_get_arg_info(k->opaque, index,5);
@@ -182,7 +212,9 @@ cl_kernel_set_arg(cl_kernel k, cl_uint index, size_t sz, const void *value)
           return CL_INVALID_ARG_VALUE;
     }
     if(value != NULL && mem) {
-      if(CL_SUCCESS != cl_mem_is_valid(mem, ctx))
+      /* A live memory object has its magic, no need to look for it in the
+       * context list */
+      if(UNLIKELY(!CL_OBJECT_IS_MEM(mem) || mem->ctx != ctx))
         return CL_INVALID_MEM_OBJECT;
 
       if (UNLIKELY((arg_type == GBE_ARG_IMAGE && !IS_IMAGE(mem))
@@ -190,13 +222,23 @@ cl_kernel_set_arg(cl_kernel k, cl_uint index, size_t sz, const void *value)
           return CL_INVALID_ARG_VALUE;
     }
   }
+  return CL_SUCCESS;
+}
+
+/* Apply an argument checked by cl_kernel_check_arg */
+static cl_int
+cl_kernel_apply_arg(cl_kernel k, cl_uint index, size_t sz, const void *value)
+{
+  const int32_t offset = k->arg_info[index].offset;          /* where to patch */
+  const enum gbe_arg_type arg_type = k->arg_info[index].type; /* kind of argument */
+  const size_t arg_sz = k->arg_info[index].size;              /* size of the argument */
+  cl_mem mem = NULL;          /* for __global, __constant and image arguments */
 
   /* Copy the structure or the value directly into the curbe */
   if (arg_type == GBE_ARG_VALUE) {
     if (k->vme && index == 0) {
       cl_accelerator_intel accel;
       memcpy(&accel, value, sz);
-      offset = interp_kernel_get_curbe_offset(k->opaque, GBE_CURBE_KERNEL_ARGUMENT, index);
       if (offset >= 0) {
         assert(offset + sz <= k->curbe_sz);
         memcpy(k->curbe + offset, &(accel->desc.me), arg_sz);
@@ -207,7 +249,6 @@ cl_kernel_set_arg(cl_kernel k, cl_uint index, size_t sz, const void *value)
       k->accel = accel;
       return CL_SUCCESS;
     } else {
-      offset = interp_kernel_get_curbe_offset(k->opaque, GBE_CURBE_KERNEL_ARGUMENT, index);
       if (offset >= 0) {
         assert(offset + sz <= k->curbe_sz);
         memcpy(k->curbe + offset, value, sz);
@@ -236,7 +277,6 @@ cl_kernel_set_arg(cl_kernel k, cl_uint index, size_t sz, const void *value)
     k->args[index].mem = NULL;
     k->args[index].sampler = sampler;
     cl_set_sampler_arg_slot(k, index, sampler);
-    offset = interp_kernel_get_curbe_offset(k->opaque, GBE_CURBE_KERNEL_ARGUMENT, index);
     if (offset >= 0) {
       assert(offset + 4 <= k->curbe_sz);
       memcpy(k->curbe + offset, &sampler->clkSamplerValue, 4);
@@ -245,11 +285,10 @@ cl_kernel_set_arg(cl_kernel k, cl_uint index, size_t sz, const void *value)
   }
 
   if(value != NULL)
-    mem = *(cl_mem*) value;
+    memcpy(&mem, value, sizeof(mem));
 
   if(value == NULL || mem == NULL) {
     /* for buffer object GLOBAL_PTR CONSTANT_PTR, it maybe NULL */
-    int32_t offset = interp_kernel_get_curbe_offset(k->opaque, GBE_CURBE_KERNEL_ARGUMENT, index);
     if (offset >= 0)
       *((uint32_t *)(k->curbe + offset)) = 0;
     assert(arg_type == GBE_ARG_GLOBAL_PTR || arg_type == GBE_ARG_CONSTANT_PTR);
@@ -262,21 +301,72 @@ cl_kernel_set_arg(cl_kernel k, cl_uint index, size_t sz, const void *value)
     return CL_SUCCESS;
   }
 
-  mem = *(cl_mem*) value;
-
-  cl_mem_add_ref(mem);
-  if (k->args[index].mem)
-    cl_mem_delete(k->args[index].mem);
-  k->args[index].mem = mem;
+  /* Setting the same buffer again keeps its reference */
+  if (k->args[index].mem != mem) {
+    cl_mem_add_ref(mem);
+    if (k->args[index].mem)
+      cl_mem_delete(k->args[index].mem);
+    k->args[index].mem = mem;
+  }
   k->args[index].is_set = 1;
   k->args[index].is_svm = mem->is_svm;
   if(mem->is_svm)
     k->args[index].ptr = mem->host_ptr;
   k->args[index].local_sz = 0;
-  k->args[index].bti = interp_kernel_get_arg_bti(k->opaque, index);
+  k->args[index].bti = k->arg_info[index].bti;
   return CL_SUCCESS;
 }
 
+LOCAL cl_int
+cl_kernel_set_arg(cl_kernel k, cl_uint index, size_t sz, const void *value)
+{
+  cl_int err = cl_kernel_check_arg(k, index, sz, value);
+  if (UNLIKELY(err != CL_SUCCESS))
+    return err;
+  return cl_kernel_apply_arg(k, index, sz, value);
+}
+
+LOCAL cl_int
+cl_kernel_set_args(cl_kernel k, size_t args_size, const void *args)
+{
+  const char *arg = (const char *)args;
+  size_t total = 0, sz;
+  uint32_t i;
+  cl_int err;
+
+  /* Check the layout before changing anything */
+  for (i = 0; i < k->arg_n; ++i)
+    total += cl_kernel_get_packed_arg_size(k, i);
+  if (UNLIKELY(args_size != total || (args == NULL && total != 0)))
+    return CL_INVALID_ARG_SIZE;
+
+  /* Then every argument, so that a failed call leaves the kernel as it was */
+  for (i = 0; i < k->arg_n; ++i) {
+    sz = cl_kernel_get_packed_arg_size(k, i);
+    if (k->arg_info[i].type == GBE_ARG_LOCAL_PTR) {
+      size_t local_sz;
+      memcpy(&local_sz, arg, sizeof(size_t));
+      err = cl_kernel_check_arg(k, i, local_sz, NULL);
+    } else
+      err = cl_kernel_check_arg(k, i, sz, arg);
+    if (UNLIKELY(err != CL_SUCCESS))
+      return err;
+    arg += sz;
+  }
+
+  arg = (const char *)args;
+  for (i = 0; i < k->arg_n; ++i) {
+    sz = cl_kernel_get_packed_arg_size(k, i);
+    if (k->arg_info[i].type == GBE_ARG_LOCAL_PTR) {
+      size_t local_sz;
+      memcpy(&local_sz, arg, sizeof(size_t));
+      cl_kernel_apply_arg(k, i, local_sz, NULL);
+    } else
+      cl_kernel_apply_arg(k, i, sz, arg);
+    arg += sz;
+  }
+  return CL_SUCCESS;
+}
 
 LOCAL cl_int
 cl_kernel_set_arg_svm_pointer(cl_kernel k, cl_uint index, const void *value)
@@ -288,8 +378,7 @@ cl_kernel_set_arg_svm_pointer(cl_kernel k, cl_uint index, const void *value)
 
   if (UNLIKELY(index >= k->arg_n))
     return CL_INVALID_ARG_INDEX;
-  arg_type = interp_kernel_get_arg_type(k->opaque, index);
-  //arg_sz = interp_kernel_get_arg_size(k->opaque, index);
+  arg_type = k->arg_info[index].type;
 
   if(arg_type != GBE_ARG_GLOBAL_PTR && arg_type != GBE_ARG_CONSTANT_PTR )
     return CL_INVALID_ARG_VALUE;
@@ -306,7 +395,7 @@ cl_kernel_set_arg_svm_pointer(cl_kernel k, cl_uint index, const void *value)
   k->args[index].is_set = 1;
   k->args[index].is_svm = 1;
   k->args[index].local_sz = 0;
-  k->args[index].bti = interp_kernel_get_arg_bti(k->opaque, index);
+  k->args[index].bti = k->arg_info[index].bti;
   return 0;
 }
 
@@ -429,15 +518,22 @@ cl_kernel_setup(cl_kernel k, gbe_kernel opaque)
 
   if(k->bo != NULL)
     cl_buffer_unreference(k->bo);
+  if (k->code != NULL)
+    cl_context_put_kernel_code(ctx, k->code);
 
-  /* Allocate the gen code here */
+  /* The kernels with the same gen code share its bo, programs often embed
+     the same helper kernels */
   const uint32_t code_sz = interp_kernel_get_code_size(opaque);
   const char *code = interp_kernel_get_code(opaque);
-  k->bo = cl_buffer_alloc(bufmgr, "CL kernel", code_sz, 64u);
+  k->code = cl_context_get_kernel_code(ctx, code, code_sz);
+  if (k->code != NULL) {
+    k->bo = k->code->bo;
+    cl_buffer_reference(k->bo);
+  } else {
+    k->bo = cl_buffer_alloc(bufmgr, "CL kernel", code_sz, 64u);
+    cl_buffer_subdata(k->bo, 0, code_sz, code);
+  }
   k->arg_n = interp_kernel_get_arg_num(opaque);
-
-  /* Upload the code */
-  cl_buffer_subdata(k->bo, 0, code_sz, code);
   k->opaque = opaque;
 
   const char* kname = cl_kernel_get_name(k);
@@ -450,6 +546,21 @@ cl_kernel_setup(cl_kernel k, gbe_kernel opaque)
   /* Create the curbe */
   k->curbe_sz = interp_kernel_get_curbe_size(k->opaque);
 
+  /* Cache the argument metadata */
+  if (k->arg_info)
+    cl_free(k->arg_info);
+  k->arg_info = NULL;
+  if (k->arg_n) {
+    uint32_t i;
+    TRY_ALLOC_NO_ERR(k->arg_info, cl_calloc(k->arg_n, sizeof(cl_arg_info)));
+    for (i = 0; i < k->arg_n; ++i) {
+      k->arg_info[i].type = interp_kernel_get_arg_type(opaque, i);
+      k->arg_info[i].size = interp_kernel_get_arg_size(opaque, i);
+      k->arg_info[i].offset = interp_kernel_get_curbe_offset(opaque, GBE_CURBE_KERNEL_ARGUMENT, i);
+      k->arg_info[i].bti = interp_kernel_get_arg_bti(opaque, i);
+    }
+  }
+
   /* Get sampler data & size */
   k->sampler_sz = interp_kernel_get_sampler_size(k->opaque);
   assert(k->sampler_sz <= GEN_MAX_SAMPLERS);
@@ -470,6 +581,9 @@ cl_kernel_setup(cl_kernel k, gbe_kernel opaque)
 error:
   cl_buffer_unreference(k->bo);
   k->bo = NULL;
+  if (k->code != NULL)
+    cl_context_put_kernel_code(ctx, k->code);
+  k->code = NULL;
 }
 
 LOCAL cl_kernel
@@ -479,7 +593,7 @@ cl_kernel_dup(cl_kernel from)
 
   if (UNLIKELY(from == NULL))
     return NULL;
-  TRY_ALLOC_NO_ERR (to, CALLOC(struct _cl_kernel));
+  TRY_ALLOC_NO_ERR (to, (struct _cl_kernel *)cl_cache_calloc(CL_ALLOC_CACHE_KERNEL, sizeof(struct _cl_kernel)));
   CL_OBJECT_INIT_BASE(to, CL_OBJECT_KERNEL_MAGIC);
   to->bo = from->bo;
   to->opaque = from->opaque;
@@ -504,6 +618,10 @@ cl_kernel_dup(cl_kernel from)
     memcpy(to->exec_info, from->exec_info, to->exec_info_n * sizeof(void *));
   }
   TRY_ALLOC_NO_ERR(to->args, cl_calloc(to->arg_n, sizeof(cl_argument)));
+  if (to->arg_n) {
+    TRY_ALLOC_NO_ERR(to->arg_info, cl_calloc(to->arg_n, sizeof(cl_arg_info)));
+    memcpy(to->arg_info, from->arg_info, to->arg_n * sizeof(cl_arg_info));
+  }
   if (to->curbe_sz) TRY_ALLOC_NO_ERR(to->curbe, cl_calloc(1, to->curbe_sz));
 
   /* Retain the bos */
@@ -515,6 +633,10 @@ cl_kernel_dup(cl_kernel from)
   assert(from->program);
   cl_program_add_ref(from->program);
   to->ref_its_program = CL_TRUE;
+  if (from->ref_its_context) {
+    cl_context_add_ref(from->program->ctx);
+    to->ref_its_context = CL_TRUE;
+  }
 
 exit:
   return to;
@@ -556,3 +678,69 @@ error:
 }
 
 
+
+/* Default local sizes of the built-in kernels of clCreateProgramWithBuiltInKernels.
+ * The first entry matching the kernel name and the GEN version is used, gen_ver
+ * 0 matches any device. The work group functions of Gen7 and Haswell exchange
+ * the values through SLM and prefer smaller groups. */
+typedef struct cl_built_in_tuning {
+  const char *name;
+  uint32_t gen_ver;
+  size_t local_sz[3];
+} cl_built_in_tuning;
+
+#define DECL_TUNING_1D(NAME, GEN7_SZ, SZ) \
+  {NAME, 7, {GEN7_SZ, 1, 1}},             \
+  {NAME, 75, {GEN7_SZ, 1, 1}},            \
+  {NAME, 0, {SZ, 1, 1}}
+
+static const cl_built_in_tuning built_in_tuning[] = {
+  DECL_TUNING_1D("scan_inclusive_add_uint_intel", 128, 256),
+  DECL_TUNING_1D("scan_exclusive_add_uint_intel", 128, 256),
+  DECL_TUNING_1D("scan_add_group_offsets_uint_intel", 128, 256),
+  DECL_TUNING_1D("reduce_segments_add_float_intel", 64, 128),
+  DECL_TUNING_1D("reduce_segments_add_uint_intel", 64, 128),
+  DECL_TUNING_1D("radix_sort_histogram_uint_intel", 128, 256),
+  DECL_TUNING_1D("radix_sort_scatter_uint_intel", 128, 256),
+  DECL_TUNING_1D("radix_sort_histogram_ulong_intel", 128, 256),
+  DECL_TUNING_1D("radix_sort_scatter_ulong_intel", 128, 256),
+  {"transpose_float_intel", 0, {16, 16, 1}},
+  {"pyramid_down_intel", 0, {16, 8, 1}},
+};
+
+#undef DECL_TUNING_1D
+
+LOCAL int
+cl_kernel_get_tuned_local_size(cl_kernel k, uint32_t work_dim, size_t *local_sz)
+{
+  const char *name = cl_kernel_get_name(k);
+  size_t max_wg_sz, sz;
+  uint32_t gen_ver, i, j;
+
+  if (!k->program->is_built_in || name == NULL)
+    return 0;
+
+  gen_ver = cl_driver_get_ver(k->program->ctx->drv);
+  for (i = 0; i < sizeof(built_in_tuning) / sizeof(built_in_tuning[0]); i++) {
+    const cl_built_in_tuning *tuning = &built_in_tuning[i];
+    if ((tuning->gen_ver != 0 && tuning->gen_ver != gen_ver) ||
+        strcmp(tuning->name, name) != 0)
+      continue;
+
+    for (j = 0; j < 3; j++)
+      local_sz[j] = j < work_dim ? tuning->local_sz[j] : 1;
+
+    /* Spilling or SLM may lower the limit of this kernel, halving every
+     * dimension keeps the tiles square */
+    max_wg_sz = cl_get_kernel_max_wg_sz(k);
+    sz = local_sz[0] * local_sz[1] * local_sz[2];
+    while (sz > max_wg_sz && sz > 1) {
+      for (j = 0; j < 3; j++)
+        if (local_sz[j] > 1)
+          local_sz[j] /= 2;
+      sz = local_sz[0] * local_sz[1] * local_sz[2];
+    }
+    return 1;
+  }
+  return 0;
+}
@@ -47,10 +47,21 @@ typedef struct cl_argument {
   uint32_t is_svm:1;    /* Indicate this argument is SVMPointer */
 } cl_argument;
 
+/* Argument metadata of the compiled kernel, fetched once from the compiler
+ * so that setting an argument does not call into libgbe
+ */
+typedef struct cl_arg_info {
+  enum gbe_arg_type type; /* Kind of argument */
+  uint32_t size;          /* Size of the value */
+  int32_t offset;         /* Location in the curbe, negative if unused */
+  uint32_t bti;           /* Binding table index of buffers */
+} cl_arg_info;
+
 /* One OCL function */
 struct _cl_kernel {
   _cl_base_object base;
   cl_buffer bo;               /* The code itself */
+  struct _cl_kernel_code *code; /* Shared code bo, only for the kernels set up */
   cl_program program;         /* Owns this structure (and pointers) */
   gbe_kernel opaque;          /* (Opaque) compiler structure for the OCL kernel */
   cl_accelerator_intel accel;     /* accelerator */
@@ -67,8 +78,10 @@ struct _cl_kernel {
                                 (i.e. global_work_size argument to clEnqueueNDRangeKernel.)*/
   size_t stack_size;          /* stack size per work item. */
   cl_argument *args;          /* To track argument setting */
-  uint32_t arg_n:30;          /* Number of arguments */
+  cl_arg_info *arg_info;      /* Type, size and location of the arguments */
+  uint32_t arg_n:29;          /* Number of arguments */
   uint32_t ref_its_program:1; /* True only for the user kernel (created by clCreateKernel) */
+  uint32_t ref_its_context:1; /* True for the fused kernels, their program is owned by the context */
   uint32_t vme:1;             /* True only if it is a built-in kernel for VME */
 
   void* cmrt_kernel;          /* CmKernel* */
@@ -116,6 +129,10 @@ extern int cl_kernel_set_arg(cl_kernel,
                              uint32_t    arg_index,
                              size_t      arg_size,
                              const void *arg_value);
+/* Set all the arguments from the packed struct described in cl_intel.h */
+extern cl_int cl_kernel_set_args(cl_kernel,
+                                 size_t      args_size,
+                                 const void *args);
 extern int cl_kernel_set_arg_svm_pointer(cl_kernel,
                                             uint32_t arg_index,
                                             const void *arg_value);
@@ -136,5 +153,22 @@ cl_kernel_work_group_sz(cl_kernel ker,
                         cl_uint wk_dim,
                         size_t *wk_grp_sz);
 
+/* Default local size of the built-in kernels from the per device tuning
+ * table. Returns 0 if the kernel has no entry for this device */
+extern int cl_kernel_get_tuned_local_size(cl_kernel k,
+                                          uint32_t work_dim,
+                                          size_t *local_sz);
+
+/* Build, or find in the cache of the context, the kernel running the given
+ * kernels one after the other in each work item. Their arguments must be set,
+ * the fused kernel gets the same values */
+extern cl_kernel cl_kernel_fuse(cl_context ctx,
+                                cl_uint num_kernels,
+                                const cl_kernel *kernels,
+                                cl_int *errcode_ret);
+
+/* Release the fused programs cached by the context */
+extern void cl_kernel_fusion_clear_cache(cl_context ctx);
+
 #endif /* __CL_KERNEL_H__ */
 
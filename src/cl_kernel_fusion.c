@@ -0,0 +1,369 @@
+/*
+ * Copyright © 2017 Intel Corporation
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library. If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "cl_kernel.h"
+#include "cl_program.h"
+#include "cl_context.h"
+#include "cl_device_id.h"
+#include "cl_mem.h"
+#include "cl_alloc.h"
+#include "cl_utils.h"
+#include "cl_trace.h"
+#include "CL/cl.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <assert.h>
+
+/* One fused program of the context. The signature identifies the sequence:
+ * hash and size of the GEN code, and argument number of each kernel, the hash
+ * of the build options and the argument map */
+struct _cl_fused_kernel {
+  struct _cl_fused_kernel *next;
+  uint64_t *signature;
+  uint32_t signature_n;
+  cl_program program;
+  char *name;
+};
+
+/* Start and size of the memory a buffer argument covers */
+static int
+cl_fusion_mem_range(cl_mem mem, size_t *start, size_t *end)
+{
+  if (mem->type != CL_MEM_BUFFER_TYPE && mem->type != CL_MEM_SUBBUFFER_TYPE)
+    return 0;
+  *start = mem->offset;
+  if (mem->type == CL_MEM_SUBBUFFER_TYPE)
+    *start += ((struct _cl_mem_buffer *)mem)->sub_offset;
+  *end = *start + mem->size;
+  return 1;
+}
+
+/* Only plain buffers and values can be forwarded from a kernel to the next */
+static cl_int
+cl_fusion_check_kernel(cl_kernel k, cl_kernel first)
+{
+  uint32_t i;
+
+  if (!CL_OBJECT_IS_KERNEL(k) || k->program->ctx != first->program->ctx)
+    return CL_INVALID_KERNEL;
+  if (k->vme || k->cmrt_kernel != NULL || k->useDeviceEnqueue || k->exec_info_n)
+    return CL_INVALID_KERNEL;
+  if (interp_kernel_use_slm(k->opaque) || k->program->global_data_ptr)
+    return CL_INVALID_KERNEL;
+  /* The fused kernel is built with the options of the first program */
+  if (strcmp(k->program->build_opts ? k->program->build_opts : "",
+             first->program->build_opts ? first->program->build_opts : "") != 0)
+    return CL_INVALID_KERNEL;
+  for (i = 0; i < 3; i++)
+    if (k->compile_wg_sz[i] != first->compile_wg_sz[i])
+      return CL_INVALID_KERNEL;
+
+  for (i = 0; i < k->arg_n; i++) {
+    switch (k->arg_info[i].type) {
+      case GBE_ARG_VALUE:
+        break;
+      case GBE_ARG_GLOBAL_PTR:
+      case GBE_ARG_CONSTANT_PTR:
+        if (k->args[i].is_svm)
+          return CL_INVALID_KERNEL;
+        break;
+      default:
+        return CL_INVALID_KERNEL;
+    }
+    if (!k->args[i].is_set)
+      return CL_INVALID_KERNEL_ARGS;
+  }
+  return CL_SUCCESS;
+}
+
+/* Give every argument of the sequence its argument in the fused kernel. A
+ * buffer bound to an argument of the same type of an earlier kernel reuses
+ * it. The fused buffers must not overlap since they are all noalias */
+static cl_int
+cl_fusion_map_args(cl_uint num_kernels, const cl_kernel *kernels,
+                   uint32_t *arg_map, uint32_t *fused_arg_n,
+                   uint32_t *fused_src)
+{
+  uint32_t i, a, j, n = 0, fused_n = 0;
+
+  for (i = 0; i < num_kernels; i++) {
+    const cl_kernel k = kernels[i];
+    for (a = 0; a < k->arg_n; a++, n++) {
+      const enum gbe_arg_type type = k->arg_info[a].type;
+      cl_mem mem = k->args[a].mem;
+      size_t start, end, other_start, other_end;
+
+      arg_map[n] = fused_n;
+      if (type == GBE_ARG_VALUE || mem == NULL) {
+        fused_src[fused_n++] = n;
+        continue;
+      }
+      if (!cl_fusion_mem_range(mem, &start, &end))
+        return CL_INVALID_KERNEL_ARGS;
+
+      for (j = 0; j < fused_n; j++) {
+        const uint32_t src = fused_src[j];
+        uint32_t ki = 0, ka = src;
+        while (ka >= kernels[ki]->arg_n)
+          ka -= kernels[ki++]->arg_n;
+        cl_mem other = kernels[ki]->args[ka].mem;
+        if (kernels[ki]->arg_info[ka].type == GBE_ARG_VALUE || other == NULL)
+          continue;
+        if (other == mem) {
+          if (kernels[ki]->arg_info[ka].type != type)
+            return CL_INVALID_KERNEL_ARGS;
+          arg_map[n] = j;
+          break;
+        }
+        if (other->bo != mem->bo || !cl_fusion_mem_range(other, &other_start, &other_end))
+          continue;
+        if (start < other_end && other_start < end)
+          return CL_INVALID_KERNEL_ARGS;
+      }
+      if (arg_map[n] == fused_n)
+        fused_src[fused_n++] = n;
+    }
+  }
+  *fused_arg_n = fused_n;
+  return CL_SUCCESS;
+}
+
+static uint64_t *
+cl_fusion_signature(cl_uint num_kernels, const cl_kernel *kernels,
+                    const uint32_t *arg_map, uint32_t arg_n, uint32_t *signature_n)
+{
+  const char *opts = kernels[0]->program->build_opts;
+  uint64_t *signature = NULL;
+  uint32_t i, n = 0;
+
+  *signature_n = 3 * num_kernels + 1 + arg_n;
+  signature = cl_calloc(*signature_n, sizeof(uint64_t));
+  if (signature == NULL)
+    return NULL;
+  for (i = 0; i < num_kernels; i++) {
+    const char *code = interp_kernel_get_code(kernels[i]->opaque);
+    const size_t code_sz = interp_kernel_get_code_size(kernels[i]->opaque);
+    signature[n++] = cl_trace_hash(code, code_sz);
+    signature[n++] = code_sz;
+    signature[n++] = kernels[i]->arg_n;
+  }
+  signature[n++] = opts ? cl_trace_hash(opts, strlen(opts)) : 0;
+  for (i = 0; i < arg_n; i++)
+    signature[n++] = arg_map[i];
+  return signature;
+}
+
+/* Build the program of the fused kernel, the error of the fusion itself goes
+ * to the build log of the program */
+static cl_program
+cl_fusion_build(cl_context ctx, cl_uint num_kernels, const cl_kernel *kernels,
+                const uint32_t *arg_map, uint32_t fused_arg_n,
+                const uint8_t *no_alias, const char *name, cl_int *errcode_ret)
+{
+  const gbe_program *programs = NULL;
+  const char **names = NULL;
+  cl_program p = NULL;
+  cl_int err = CL_SUCCESS;
+  uint32_t i;
+
+  TRY_ALLOC (programs, cl_calloc(num_kernels, sizeof(gbe_program)));
+  TRY_ALLOC (names, cl_calloc(num_kernels, sizeof(char *)));
+  for (i = 0; i < num_kernels; i++) {
+    ((gbe_program *)programs)[i] = kernels[i]->program->opaque;
+    names[i] = cl_kernel_get_name(kernels[i]);
+  }
+
+  TRY_ALLOC (p, cl_program_new(ctx));
+  p->opaque = compiler_program_new_fused(ctx->devices[0]->device_id, num_kernels,
+                                         programs, names, arg_map, fused_arg_n,
+                                         no_alias, name, p->build_log_max_sz,
+                                         p->build_log, &p->build_log_sz);
+  if (p->opaque == NULL) {
+    DEBUGP(DL_WARNING, "kernel fusion failed: %s", p->build_log);
+    err = CL_INVALID_KERNEL;
+    goto error;
+  }
+  p->source_type = FROM_LLVM;
+  err = cl_program_build(p, kernels[0]->program->build_opts);
+  if (err != CL_SUCCESS)
+    goto error;
+
+exit:
+  cl_free((void *)programs);
+  cl_free(names);
+  if (errcode_ret)
+    *errcode_ret = err;
+  return p;
+error:
+  cl_program_delete(p);
+  p = NULL;
+  goto exit;
+}
+
+LOCAL cl_kernel
+cl_kernel_fuse(cl_context ctx, cl_uint num_kernels, const cl_kernel *kernels, cl_int *errcode_ret)
+{
+  struct _cl_fused_kernel *entry = NULL, *new_entry = NULL;
+  cl_program p = NULL;
+  cl_kernel fused = NULL;
+  uint32_t *arg_map = NULL, *fused_src = NULL;
+  uint64_t *signature = NULL;
+  uint32_t signature_n = 0;
+  uint8_t *no_alias = NULL;
+  char *name = NULL;
+  uint32_t arg_n = 0, fused_arg_n = 0, name_sz = sizeof("__fused");
+  uint32_t i;
+  cl_int err = CL_SUCCESS;
+
+  if (num_kernels < 2 || kernels == NULL) {
+    err = CL_INVALID_VALUE;
+    goto error;
+  }
+  if (compiler_program_new_fused == NULL) {
+    err = CL_COMPILER_NOT_AVAILABLE;
+    goto error;
+  }
+  for (i = 0; i < num_kernels; i++) {
+    if (!CL_OBJECT_IS_KERNEL(kernels[i])) {
+      err = CL_INVALID_KERNEL;
+      goto error;
+    }
+    if ((err = cl_fusion_check_kernel(kernels[i], kernels[0])) != CL_SUCCESS)
+      goto error;
+    arg_n += kernels[i]->arg_n;
+    name_sz += strlen(cl_kernel_get_name(kernels[i])) + 1;
+  }
+  if (kernels[0]->program->ctx != ctx) {
+    err = CL_INVALID_CONTEXT;
+    goto error;
+  }
+
+  TRY_ALLOC (arg_map, cl_calloc(arg_n + 1, sizeof(uint32_t)));
+  TRY_ALLOC (fused_src, cl_calloc(arg_n + 1, sizeof(uint32_t)));
+  if ((err = cl_fusion_map_args(num_kernels, kernels, arg_map, &fused_arg_n, fused_src)) != CL_SUCCESS)
+    goto error;
+  TRY_ALLOC (signature, cl_fusion_signature(num_kernels, kernels, arg_map, arg_n, &signature_n));
+
+  pthread_mutex_lock(&ctx->fusion_lock);
+  for (entry = ctx->fused_kernels; entry; entry = entry->next)
+    if (entry->signature_n == signature_n &&
+        memcmp(entry->signature, signature, signature_n * sizeof(uint64_t)) == 0)
+      break;
+
+  if (entry == NULL) {
+    /* Every buffer of the fused kernel is a distinct non overlapping one */
+    no_alias = cl_calloc(fused_arg_n + 1, sizeof(uint8_t));
+    name = cl_calloc(name_sz, sizeof(char));
+    new_entry = cl_calloc(1, sizeof(struct _cl_fused_kernel));
+    if (no_alias == NULL || name == NULL || new_entry == NULL) {
+      pthread_mutex_unlock(&ctx->fusion_lock);
+      err = CL_OUT_OF_HOST_MEMORY;
+      goto error;
+    }
+    for (i = 0; i < fused_arg_n; i++) {
+      uint32_t ki = 0, ka = fused_src[i];
+      while (ka >= kernels[ki]->arg_n)
+        ka -= kernels[ki++]->arg_n;
+      no_alias[i] = kernels[ki]->arg_info[ka].type != GBE_ARG_VALUE;
+    }
+    strcpy(name, "__fused");
+    for (i = 0; i < num_kernels; i++) {
+      strcat(name, "_");
+      strcat(name, cl_kernel_get_name(kernels[i]));
+    }
+
+    p = cl_fusion_build(ctx, num_kernels, kernels, arg_map, fused_arg_n, no_alias, name, &err);
+    if (p == NULL) {
+      pthread_mutex_unlock(&ctx->fusion_lock);
+      goto error;
+    }
+    new_entry->signature = signature;
+    new_entry->signature_n = signature_n;
+    new_entry->program = p;
+    new_entry->name = name;
+    new_entry->next = ctx->fused_kernels;
+    ctx->fused_kernels = entry = new_entry;
+    ctx->fused_kernel_num++;
+    new_entry = NULL;
+    signature = NULL;
+    name = NULL;
+  }
+  pthread_mutex_unlock(&ctx->fusion_lock);
+
+  fused = cl_program_create_kernel(entry->program, entry->name, &err);
+  if (fused == NULL)
+    goto error;
+  /* The cached program only holds the context as long as the context lives,
+   * the kernel given to the user keeps it alive */
+  cl_context_add_ref(ctx);
+  fused->ref_its_context = CL_TRUE;
+
+  /* Bind the fused arguments from the first kernel argument mapped to them */
+  for (i = 0; i < fused_arg_n; i++) {
+    uint32_t ki = 0, ka = fused_src[i];
+    while (ka >= kernels[ki]->arg_n)
+      ka -= kernels[ki++]->arg_n;
+    const cl_kernel k = kernels[ki];
+    if (k->arg_info[ka].type == GBE_ARG_VALUE) {
+      char zero[k->arg_info[ka].size];
+      const void *value = zero;
+      memset(zero, 0, sizeof(zero));
+      if (k->arg_info[ka].offset >= 0 && k->curbe)
+        value = k->curbe + k->arg_info[ka].offset;
+      err = cl_kernel_set_arg(fused, i, k->arg_info[ka].size, value);
+    } else
+      err = cl_kernel_set_arg(fused, i, sizeof(cl_mem), &k->args[ka].mem);
+    if (err != CL_SUCCESS)
+      goto error;
+  }
+
+exit:
+  cl_free(arg_map);
+  cl_free(fused_src);
+  cl_free(signature);
+  cl_free(no_alias);
+  cl_free(name);
+  if (errcode_ret)
+    *errcode_ret = err;
+  return fused;
+error:
+  cl_free(new_entry);
+  cl_kernel_delete(fused);
+  fused = NULL;
+  goto exit;
+}
+
+LOCAL void
+cl_kernel_fusion_clear_cache(cl_context ctx)
+{
+  struct _cl_fused_kernel *entry = ctx->fused_kernels;
+
+  ctx->fused_kernels = NULL;
+  ctx->fused_kernel_num = 0;
+  while (entry) {
+    struct _cl_fused_kernel *next = entry->next;
+    cl_program_delete(entry->program);
+    cl_free(entry->signature);
+    cl_free(entry->name);
+    cl_free(entry);
+    entry = next;
+  }
+}
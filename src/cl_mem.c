@@ -37,6 +37,10 @@
 #include <string.h>
 #include <unistd.h>
 #include <math.h>
+#include <signal.h>
+#include <pthread.h>
+#include <sched.h>
+#include <sys/mman.h>
 
 #define FIELD_SIZE(CASE,TYPE)               \
   case JOIN(CL_,CASE):                      \
@@ -200,7 +204,11 @@ cl_mem_allocate(enum cl_mem_type type,
         }
         else if (flags & CL_MEM_ALLOC_HOST_PTR) {
           const size_t alignedSZ = ALIGN(sz, page_size);
-          void* internal_host_ptr = cl_aligned_malloc(alignedSZ, page_size);
+          void* internal_host_ptr = cl_host_alloc(alignedSZ, &ctx->props.host_alloc, &mem->host_alloc_sz);
+          if (internal_host_ptr == NULL) {
+            err = CL_MEM_OBJECT_ALLOCATION_FAILURE;
+            goto error;
+          }
           mem->host_ptr = internal_host_ptr;
           mem->is_userptr = 1;
           mem->bo = cl_buffer_alloc_userptr(bufmgr, "CL userptr memory object", internal_host_ptr, alignedSZ, 0);
@@ -279,21 +287,21 @@ cl_mem_is_valid(cl_mem mem, cl_context ctx)
   struct list_node *pos;
   cl_base_object pbase_object;
 
-  CL_OBJECT_LOCK(ctx);
+  pthread_rwlock_rdlock(&ctx->mem_lock);
   list_for_each (pos, (&ctx->mem_objects)) {
     pbase_object = list_entry(pos, _cl_base_object, node);
     if (pbase_object == (cl_base_object)mem) {
       if (UNLIKELY(!CL_OBJECT_IS_MEM(mem))) {
-        CL_OBJECT_UNLOCK(ctx);
+        pthread_rwlock_unlock(&ctx->mem_lock);
         return CL_INVALID_MEM_OBJECT;
       }
 
-      CL_OBJECT_UNLOCK(ctx);
+      pthread_rwlock_unlock(&ctx->mem_lock);
       return CL_SUCCESS;
     }
   }
 
-  CL_OBJECT_UNLOCK(ctx);
+  pthread_rwlock_unlock(&ctx->mem_lock);
   return CL_INVALID_MEM_OBJECT;
 }
 
@@ -1539,7 +1547,7 @@ cl_mem_delete(cl_mem mem)
       (mem->flags & CL_MEM_ALLOC_HOST_PTR) &&
       (mem->type != CL_MEM_SUBBUFFER_TYPE)) ||
       (mem->is_svm && mem->type == CL_MEM_SVM_TYPE))
-    cl_free(mem->host_ptr);
+    cl_host_free(mem->host_ptr, mem->host_alloc_sz);
 
   CL_OBJECT_DESTROY_BASE(mem);
   cl_free(mem);
@@ -2780,7 +2788,7 @@ error:
 
 LOCAL cl_int
 cl_mem_record_map_mem(cl_mem mem, void *ptr, void **mem_ptr, size_t offset,
-                      size_t size, const size_t *origin, const size_t *region)
+                      size_t size, const size_t *origin, const size_t *region, uint8_t write_map)
 {
   // TODO: Need to add MT safe logic.
 
@@ -2810,6 +2818,7 @@ cl_mem_record_map_mem(cl_mem mem, void *ptr, void **mem_ptr, size_t offset,
   mem->mapped_ptr[slot].ptr = *mem_ptr;
   mem->mapped_ptr[slot].v_ptr = ptr;
   mem->mapped_ptr[slot].size = size;
+  mem->mapped_ptr[slot].write_map = write_map;
   if(origin) {
     assert(region);
     mem->mapped_ptr[slot].origin[0] = origin[0];
@@ -2845,3 +2854,177 @@ cl_mem_set_destructor_callback(cl_mem memobj,
   CL_OBJECT_UNLOCK(memobj);
   return CL_SUCCESS;
 }
+
+/* Page granular dirty tracking of mapped USE_HOST_PTR regions. The pages are
+ * write protected at map time, the first write to a page faults, the SIGSEGV
+ * handler marks the page dirty and gives the write access back. Unmap then
+ * only copies the dirty pages to the bo. Enabled with OCL_MAP_DIRTY_TRACKING=1.
+ * The host pages of a tracked region get read/write access back at unmap. */
+#define MAX_DIRTY_REGIONS 32
+
+typedef struct _cl_dirty_region {
+  char *volatile start;   /* page aligned start, NULL if the slot is free */
+  char *end;              /* page aligned end */
+  uint8_t *dirty;         /* one byte per page */
+} cl_dirty_region;
+
+static cl_dirty_region dirty_regions[MAX_DIRTY_REGIONS];
+static pthread_mutex_t dirty_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_once_t dirty_once = PTHREAD_ONCE_INIT;
+static struct sigaction dirty_old_action;
+static int dirty_enabled = 0;
+static size_t dirty_page_size = 0;
+/* Handlers running, a region is freed only once none of them may still use it */
+static volatile int dirty_handlers = 0;
+
+static void
+cl_mem_dirty_handler(int sig, siginfo_t *info, void *ucontext)
+{
+  char *addr = (char *)info->si_addr;
+  int handled = 0;
+  int i;
+
+  /* Published before the slots are read, see cl_mem_dirty_track_stop */
+  __sync_fetch_and_add(&dirty_handlers, 1);
+  for (i = 0; i < MAX_DIRTY_REGIONS; i++) {
+    char *start = dirty_regions[i].start;
+    char *end = dirty_regions[i].end;
+    uint8_t *dirty = dirty_regions[i].dirty;
+    if (start == NULL || addr < start || addr >= end)
+      continue;
+    char *page = start + (addr - start) / dirty_page_size * dirty_page_size;
+    dirty[(page - start) / dirty_page_size] = 1;
+    mprotect(page, dirty_page_size, PROT_READ | PROT_WRITE);
+    handled = 1;
+  }
+  __sync_fetch_and_sub(&dirty_handlers, 1);
+  if (handled)
+    return;
+
+  /* Not one of ours */
+  if (dirty_old_action.sa_flags & SA_SIGINFO)
+    dirty_old_action.sa_sigaction(sig, info, ucontext);
+  else if (dirty_old_action.sa_handler != SIG_DFL && dirty_old_action.sa_handler != SIG_IGN)
+    dirty_old_action.sa_handler(sig);
+  else {
+    /* Fault again with the default action, an ignored SIGSEGV would
+     * restart the faulting instruction forever */
+    struct sigaction action;
+    memset(&action, 0, sizeof(action));
+    action.sa_handler = SIG_DFL;
+    sigemptyset(&action.sa_mask);
+    sigaction(SIGSEGV, &action, NULL);
+  }
+}
+
+static void
+cl_mem_dirty_init(void)
+{
+  struct sigaction action;
+  const char *env = getenv("OCL_MAP_DIRTY_TRACKING");
+  if (env != NULL)
+    sscanf(env, "%i", &dirty_enabled);
+  if (!dirty_enabled)
+    return;
+
+  dirty_page_size = getpagesize();
+  memset(&action, 0, sizeof(action));
+  action.sa_sigaction = cl_mem_dirty_handler;
+  action.sa_flags = SA_SIGINFO | SA_RESTART;
+  sigemptyset(&action.sa_mask);
+  if (sigaction(SIGSEGV, &action, &dirty_old_action) != 0)
+    dirty_enabled = 0;
+}
+
+LOCAL void
+cl_mem_dirty_track_start(void *ptr, size_t size)
+{
+  char *start, *end;
+  cl_dirty_region *region = NULL;
+  int i;
+
+  pthread_once(&dirty_once, cl_mem_dirty_init);
+  if (!dirty_enabled || size == 0)
+    return;
+
+  start = (char *)((size_t)ptr & ~(dirty_page_size - 1));
+  end = (char *)(((size_t)ptr + size + dirty_page_size - 1) & ~(dirty_page_size - 1));
+
+  pthread_mutex_lock(&dirty_lock);
+  for (i = 0; i < MAX_DIRTY_REGIONS; i++) {
+    /* Two regions sharing a page would unprotect it for each other */
+    if (dirty_regions[i].start != NULL &&
+        start < dirty_regions[i].end && dirty_regions[i].start < end)
+      goto unlock;
+    if (dirty_regions[i].start == NULL && region == NULL)
+      region = &dirty_regions[i];
+  }
+  if (region == NULL)
+    goto unlock;
+
+  region->dirty = cl_calloc((end - start) / dirty_page_size, 1);
+  if (region->dirty == NULL)
+    goto unlock;
+  region->end = end;
+  __sync_synchronize();
+  region->start = start;
+  if (mprotect(start, end - start, PROT_READ) != 0) {
+    region->start = NULL;
+    __sync_synchronize();
+    while (dirty_handlers != 0)
+      sched_yield();
+    cl_free(region->dirty);
+    region->dirty = NULL;
+  }
+unlock:
+  pthread_mutex_unlock(&dirty_lock);
+}
+
+LOCAL cl_bool
+cl_mem_dirty_track_stop(void *ptr, size_t size, void *dst)
+{
+  char *start, *end, *page;
+  cl_dirty_region *region = NULL;
+  uint8_t *dirty;
+  int i;
+
+  if (!dirty_enabled || size == 0)
+    return CL_FALSE;
+
+  start = (char *)((size_t)ptr & ~(dirty_page_size - 1));
+  end = (char *)(((size_t)ptr + size + dirty_page_size - 1) & ~(dirty_page_size - 1));
+
+  pthread_mutex_lock(&dirty_lock);
+  for (i = 0; i < MAX_DIRTY_REGIONS; i++)
+    if (dirty_regions[i].start == start && dirty_regions[i].end == end) {
+      region = &dirty_regions[i];
+      break;
+    }
+  if (region == NULL) {
+    pthread_mutex_unlock(&dirty_lock);
+    return CL_FALSE;
+  }
+  mprotect(start, end - start, PROT_READ | PROT_WRITE);
+  dirty = region->dirty;
+  region->start = NULL;
+  __sync_synchronize();
+  /* A handler that saw the region before it was unpublished may still mark
+   * a page, wait for it before the map is read and freed. The lock keeps the
+   * slot from being reused meanwhile */
+  while (dirty_handlers != 0)
+    sched_yield();
+  region->dirty = NULL;
+  pthread_mutex_unlock(&dirty_lock);
+
+  /* Copy the dirty pages, clipped to the mapped range */
+  for (page = start; page < end; page += dirty_page_size) {
+    char *from, *to;
+    if (!dirty[(page - start) / dirty_page_size])
+      continue;
+    from = page < (char *)ptr ? (char *)ptr : page;
+    to = page + dirty_page_size > (char *)ptr + size ? (char *)ptr + size : page + dirty_page_size;
+    memcpy((char *)dst + (from - (char *)ptr), from, to - from);
+  }
+  cl_free(dirty);
+  return CL_TRUE;
+}
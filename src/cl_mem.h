@@ -63,6 +63,7 @@ typedef struct _cl_mapped_ptr {
   size_t region[3];  /* mapped region */
   cl_mem tmp_ker_buf;       /* this object is tmp buffer for OCL kernel copying */
   uint8_t ker_write_map;    /* this flag is used to indicate CL_MAP_WRITE for OCL kernel copying */
+  uint8_t write_map;        /* host may write the mapped region, need to write it back on unmap */
 }cl_mapped_ptr;
 
 typedef struct _cl_mem_dstr_cb {
@@ -101,6 +102,7 @@ typedef  struct _cl_mem {
   uint8_t is_userptr;       /* CL_MEM_USE_HOST_PTR is enabled */
   cl_bool is_svm;           /* This object  is svm */
   size_t offset;            /* offset of host_ptr to the page beginning, only for CL_MEM_USE_HOST_PTR*/
+  size_t host_alloc_sz;     /* Mapped size of the CL_MEM_ALLOC_HOST_PTR memory, see cl_host_alloc */
 
   uint8_t cmrt_mem_type;    /* CmBuffer, CmSurface2D, ... */
   void* cmrt_mem;
@@ -368,7 +370,14 @@ extern cl_mem cl_mem_new_image_from_fd(cl_context ctx,
                                        cl_int *errcode);
 
 extern cl_int cl_mem_record_map_mem(cl_mem mem, void *ptr, void **mem_ptr, size_t offset,
-                      size_t size, const size_t *origin, const size_t *region);
+                      size_t size, const size_t *origin, const size_t *region, uint8_t write_map);
+
+/* Start to track the pages of [ptr, ptr + size) written by the host (OCL_MAP_DIRTY_TRACKING) */
+extern void cl_mem_dirty_track_start(void *ptr, size_t size);
+
+/* Stop the tracking of [ptr, ptr + size) and copy the written pages to dst.
+ * Return CL_FALSE if the region was not tracked, the caller copies everything then. */
+extern cl_bool cl_mem_dirty_track_stop(void *ptr, size_t size, void *dst);
 
 extern cl_int cl_mem_record_map_mem_for_kernel(cl_mem mem, void *ptr, void **mem_ptr, size_t offset,
                       size_t size, const size_t *origin, const size_t *region, cl_mem tmp_ker_buf, uint8_t write_map);
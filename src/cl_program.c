@@ -178,7 +178,7 @@ static const unsigned char binary_type_header[BHI_MAX][BINARY_HEADER_LENGTH]=  \
                                               {{'B','C', 0xC0, 0xDE},
                                                {1, 'B', 'C', 0xC0, 0xDE},
                                                {2, 'B', 'C', 0xC0, 0xDE},
-                                               {1, 'G','E', 'N', 'C'},
+                                               {2, 'G','E', 'N', 'C'},
                                                {'C','I', 'S', 'A'},
                                                };
 
@@ -396,6 +396,7 @@ cl_program_create_with_built_in_kernles(cl_context     ctx,
     return NULL;
 
   built_in_prgs->is_built = 1;
+  built_in_prgs->is_built_in = 1;
 
 exit:
   if (errcode_ret)
@@ -67,6 +67,7 @@ struct _cl_program {
   uint32_t ker_n;         /* Number of declared kernels */
   uint32_t source_type:3; /* Built from binary, source, CMRT or LLVM*/
   uint32_t is_built:1;    /* Did we call clBuildProgram on it? */
+  uint32_t is_built_in:1; /* Created by clCreateProgramWithBuiltInKernels */
   int32_t build_status;   /* build status. */
   char *build_opts;       /* The build options for this program */
   size_t build_log_max_sz; /*build log maximum size in byte.*/
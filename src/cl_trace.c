@@ -0,0 +1,276 @@
+/*
+ * Copyright © 2017 Intel Corporation
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library. If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "cl_trace.h"
+#include "cl_command_queue.h"
+#include "cl_context.h"
+#include "cl_program.h"
+#include "cl_kernel.h"
+#include "cl_device_id.h"
+#include "cl_mem.h"
+#include "cl_driver.h"
+#include "cl_utils.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+
+/* Programs already written to the trace, the kernel hash points to the
+ * program hash so that we serialize each program only once */
+typedef struct trace_kernel_entry {
+  uint64_t kernel_hash;
+  uint64_t program_hash;
+} trace_kernel_entry;
+
+static pthread_once_t trace_once = PTHREAD_ONCE_INIT;
+static pthread_mutex_t trace_mutex = PTHREAD_MUTEX_INITIALIZER;
+static FILE *trace_file = NULL;
+static int trace_buffers = 0;
+static int trace_header_written = 0;
+static trace_kernel_entry *trace_kernels = NULL;
+static uint32_t trace_kernel_num = 0;
+
+static void
+cl_trace_close(void)
+{
+  pthread_mutex_lock(&trace_mutex);
+  if (trace_file)
+    fclose(trace_file);
+  trace_file = NULL;
+  free(trace_kernels);
+  trace_kernels = NULL;
+  trace_kernel_num = 0;
+  pthread_mutex_unlock(&trace_mutex);
+}
+
+static void
+cl_trace_init(void)
+{
+  const char *path = getenv("OCL_TRACE_FILE");
+  const char *buffers = getenv("OCL_TRACE_BUFFERS");
+  if (path == NULL || path[0] == '\0')
+    return;
+  trace_file = fopen(path, "wb");
+  if (trace_file == NULL) {
+    fprintf(stderr, "Beignet: can not create the trace file %s\n", path);
+    return;
+  }
+  trace_buffers = buffers && atoi(buffers) != 0;
+  atexit(cl_trace_close);
+}
+
+LOCAL int
+cl_trace_enabled(void)
+{
+  pthread_once(&trace_once, cl_trace_init);
+  return trace_file != NULL;
+}
+
+static void
+cl_trace_write_record(uint32_t type, uint64_t size)
+{
+  cl_trace_record record;
+  record.type = type;
+  record.reserved = 0;
+  record.size = size;
+  fwrite(&record, sizeof(record), 1, trace_file);
+}
+
+/* Returns the hash of the program of the kernel, writing the program record
+ * if it is not in the trace yet */
+static uint64_t
+cl_trace_write_program(cl_kernel ker, uint64_t kernel_hash)
+{
+  cl_program program = ker->program;
+  cl_trace_program_info prog;
+  char *binary = NULL;
+  size_t binary_sz = 0;
+  int serialized = 0;
+  uint32_t i;
+
+  for (i = 0; i < trace_kernel_num; i++)
+    if (trace_kernels[i].kernel_hash == kernel_hash)
+      return trace_kernels[i].program_hash;
+
+  if (compiler_program_serialize_to_binary) {
+    binary_sz = compiler_program_serialize_to_binary(program->opaque, &binary, 0);
+    serialized = 1;
+  } else if (program->binary_type == CL_PROGRAM_BINARY_TYPE_EXECUTABLE) {
+    binary = program->binary;
+    binary_sz = program->binary_sz;
+  }
+
+  prog.hash = binary_sz ? cl_trace_hash(binary, binary_sz) : 0;
+  prog.binary_sz = binary_sz;
+  for (i = 0; i < trace_kernel_num; i++)
+    if (trace_kernels[i].program_hash == prog.hash)
+      break;
+  /* First kernel of this program we see, the program may be in the trace
+   * already through one of its other kernels */
+  if (i == trace_kernel_num && binary_sz) {
+    cl_trace_write_record(CL_TRACE_RECORD_PROGRAM, sizeof(prog) + binary_sz);
+    fwrite(&prog, sizeof(prog), 1, trace_file);
+    fwrite(binary, binary_sz, 1, trace_file);
+  }
+  if (serialized)
+    free(binary);
+
+  trace_kernel_entry *kernels = realloc(trace_kernels, (trace_kernel_num + 1) * sizeof(*kernels));
+  if (kernels) {
+    trace_kernels = kernels;
+    trace_kernels[trace_kernel_num].kernel_hash = kernel_hash;
+    trace_kernels[trace_kernel_num].program_hash = prog.hash;
+    trace_kernel_num++;
+  }
+  return prog.hash;
+}
+
+/* Fill the description of one argument, the data is the value of the
+ * argument or the snapshot of the buffer */
+static const void *
+cl_trace_arg_desc(cl_kernel ker, uint32_t index, cl_trace_arg *arg, int *mapped)
+{
+  cl_mem mem = ker->args[index].mem;
+  int32_t offset;
+
+  memset(arg, 0, sizeof(*arg));
+  *mapped = 0;
+  arg->type = interp_kernel_get_arg_type(ker->opaque, index);
+  arg->size = interp_kernel_get_arg_size(ker->opaque, index);
+  switch (arg->type) {
+    case GBE_ARG_VALUE:
+      offset = interp_kernel_get_curbe_offset(ker->opaque, GBE_CURBE_KERNEL_ARGUMENT, index);
+      if (offset < 0 || ker->curbe == NULL || offset + arg->size > ker->curbe_sz)
+        return NULL;
+      arg->data_sz = arg->size;
+      return ker->curbe + offset;
+    case GBE_ARG_LOCAL_PTR:
+      arg->size = ker->args[index].local_sz;
+      return NULL;
+    case GBE_ARG_GLOBAL_PTR:
+    case GBE_ARG_CONSTANT_PTR:
+    case GBE_ARG_PIPE:
+      if (mem == NULL)
+        return NULL;
+      arg->bti = interp_kernel_get_arg_bti(ker->opaque, index);
+      arg->is_svm = ker->args[index].is_svm;
+      arg->mem_size = mem->size;
+      arg->mem_offset = mem->offset;
+      if (mem->type == CL_MEM_SUBBUFFER_TYPE)
+        arg->mem_offset += ((struct _cl_mem_buffer *)mem)->sub_offset;
+      if (!trace_buffers || mem->bo == NULL || cl_buffer_map(mem->bo, 0) != 0)
+        return NULL;
+      *mapped = 1;
+      arg->data_sz = arg->mem_size;
+      return (char *)cl_buffer_get_virtual(mem->bo) + arg->mem_offset;
+    default:
+      /* Images and samplers are only described by their type */
+      return NULL;
+  }
+}
+
+LOCAL void
+cl_trace_ndrange(cl_command_queue queue, cl_kernel ker,
+                 uint32_t work_dim, const size_t *global_wk_off,
+                 const size_t *global_dim_off, const size_t *global_wk_sz,
+                 const size_t *global_wk_sz_use, const size_t *local_wk_sz,
+                 const size_t *local_wk_sz_use, uint32_t simd_sz,
+                 uint32_t thread_n, uint32_t slm_sz, uint32_t scratch_sz)
+{
+  const char *name = interp_kernel_get_name(ker->opaque);
+  const char *code = interp_kernel_get_code(ker->opaque);
+  const size_t code_sz = interp_kernel_get_code_size(ker->opaque);
+  cl_trace_ndrange_info nd;
+  cl_trace_arg *args = NULL;
+  const void **data = NULL;
+  int *mapped = NULL;
+  uint64_t size;
+  uint32_t i;
+
+  if (!cl_trace_enabled())
+    return;
+
+  memset(&nd, 0, sizeof(nd));
+  nd.kernel_hash = cl_trace_hash(code, code_sz);
+  for (i = 0; i < 3; i++) {
+    nd.global_wk_off[i] = global_wk_off[i];
+    nd.global_wk_sz[i] = global_wk_sz[i];
+    nd.local_wk_sz[i] = local_wk_sz[i];
+    nd.global_dim_off[i] = global_dim_off[i];
+    nd.global_wk_sz_use[i] = global_wk_sz_use[i];
+    nd.local_wk_sz_use[i] = local_wk_sz_use[i];
+  }
+  nd.work_dim = work_dim;
+  nd.simd_sz = simd_sz;
+  nd.thread_n = thread_n;
+  nd.slm_sz = slm_sz;
+  nd.scratch_sz = scratch_sz;
+  nd.curbe_sz = ker->curbe ? ker->curbe_sz : 0;
+  nd.name_sz = strlen(name) + 1;
+  nd.arg_n = ker->arg_n;
+
+  pthread_mutex_lock(&trace_mutex);
+  if (trace_file == NULL)
+    goto exit;
+  if (!trace_header_written) {
+    cl_trace_header header;
+    header.magic = CL_TRACE_MAGIC;
+    header.version = CL_TRACE_VERSION;
+    header.device_id = queue->ctx->devices[0]->device_id;
+    header.gen_ver = cl_driver_get_ver(queue->ctx->drv);
+    fwrite(&header, sizeof(header), 1, trace_file);
+    trace_header_written = 1;
+  }
+  nd.program_hash = cl_trace_write_program(ker, nd.kernel_hash);
+
+  /* The size of the record depends on the buffer snapshots, keep the
+   * buffers mapped until they are written */
+  args = calloc(ker->arg_n + 1, sizeof(cl_trace_arg));
+  data = calloc(ker->arg_n + 1, sizeof(void *));
+  mapped = calloc(ker->arg_n + 1, sizeof(int));
+  if (args == NULL || data == NULL || mapped == NULL)
+    goto exit;
+  size = sizeof(nd) + nd.name_sz + nd.curbe_sz;
+  for (i = 0; i < ker->arg_n; i++) {
+    data[i] = cl_trace_arg_desc(ker, i, &args[i], &mapped[i]);
+    if (data[i] == NULL)
+      args[i].data_sz = 0;
+    size += sizeof(cl_trace_arg) + args[i].data_sz;
+  }
+
+  cl_trace_write_record(CL_TRACE_RECORD_NDRANGE, size);
+  fwrite(&nd, sizeof(nd), 1, trace_file);
+  fwrite(name, nd.name_sz, 1, trace_file);
+  if (nd.curbe_sz)
+    fwrite(ker->curbe, nd.curbe_sz, 1, trace_file);
+  for (i = 0; i < ker->arg_n; i++) {
+    fwrite(&args[i], sizeof(cl_trace_arg), 1, trace_file);
+    if (args[i].data_sz)
+      fwrite(data[i], args[i].data_sz, 1, trace_file);
+    if (mapped[i])
+      cl_buffer_unmap(ker->args[i].mem->bo);
+  }
+  fflush(trace_file);
+
+exit:
+  pthread_mutex_unlock(&trace_mutex);
+  free(args);
+  free(data);
+  free(mapped);
+}
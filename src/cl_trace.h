@@ -0,0 +1,118 @@
+/*
+ * Copyright © 2017 Intel Corporation
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library. If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef __CL_TRACE_H__
+#define __CL_TRACE_H__
+
+#include "CL/cl.h"
+#include <stdint.h>
+#include <stddef.h>
+
+/* Command stream capture, enabled with OCL_TRACE_FILE=<path>. Set
+ * OCL_TRACE_BUFFERS=1 to also snapshot the content of the buffer arguments.
+ *
+ * The trace is a cl_trace_header followed by records. Every record starts
+ * with a cl_trace_record giving the type and the size of its payload:
+ *  - CL_TRACE_RECORD_PROGRAM: cl_trace_program_info then the GEN program binary,
+ *    written once per program the first time one of its kernels runs
+ *  - CL_TRACE_RECORD_NDRANGE: cl_trace_ndrange_info, the kernel name (name_sz
+ *    bytes with the ending zero), the shared curbe (curbe_sz bytes) and
+ *    arg_n times a cl_trace_arg followed by its data_sz bytes of data
+ * All the fields are in host byte order. The ocl_trace_replay tool reads it.
+ */
+#define CL_TRACE_MAGIC   0x43525442 /* "BTRC" */
+#define CL_TRACE_VERSION 1
+
+enum {
+  CL_TRACE_RECORD_PROGRAM = 1,
+  CL_TRACE_RECORD_NDRANGE = 2,
+};
+
+typedef struct cl_trace_header {
+  uint32_t magic;
+  uint32_t version;
+  uint32_t device_id;           /* PCI ID of the device the trace comes from */
+  uint32_t gen_ver;
+} cl_trace_header;
+
+typedef struct cl_trace_record {
+  uint32_t type;
+  uint32_t reserved;
+  uint64_t size;                /* Payload size, this header excluded */
+} cl_trace_record;
+
+typedef struct cl_trace_program_info {
+  uint64_t hash;                /* Hash of the binary */
+  uint64_t binary_sz;
+} cl_trace_program_info;
+
+typedef struct cl_trace_ndrange_info {
+  uint64_t program_hash;        /* The program record holding the kernel */
+  uint64_t kernel_hash;         /* Hash of the GEN code of the kernel */
+  uint64_t global_wk_off[3];    /* As given to clEnqueueNDRangeKernel */
+  uint64_t global_wk_sz[3];
+  uint64_t local_wk_sz[3];
+  uint64_t global_dim_off[3];   /* Walker parameters of this part of the */
+  uint64_t global_wk_sz_use[3]; /* NDRange, non uniform work groups are */
+  uint64_t local_wk_sz_use[3];  /* split in up to 8 parts */
+  uint32_t work_dim;
+  uint32_t simd_sz;
+  uint32_t thread_n;            /* HW threads per work group */
+  uint32_t slm_sz;
+  uint32_t scratch_sz;
+  uint32_t curbe_sz;
+  uint32_t name_sz;
+  uint32_t arg_n;
+} cl_trace_ndrange_info;
+
+typedef struct cl_trace_arg {
+  uint32_t type;                /* enum gbe_arg_type */
+  uint32_t size;                /* Value size, or __local size */
+  uint32_t bti;                 /* Binding table index of the buffers */
+  uint32_t is_svm;
+  uint64_t mem_size;            /* Size of the bound surface, 0 for NULL */
+  uint64_t mem_offset;          /* Start of the surface in the bo */
+  uint64_t data_sz;             /* Value bytes, or buffer snapshot */
+} cl_trace_arg;
+
+/* Hash used for the program and kernel binaries */
+static inline uint64_t
+cl_trace_hash(const void *data, size_t sz)
+{
+  const unsigned char *p = (const unsigned char *)data;
+  uint64_t h = 0xcbf29ce484222325ull;
+  size_t i;
+  for (i = 0; i < sz; i++) {
+    h ^= p[i];
+    h *= 0x100000001b3ull;
+  }
+  return h;
+}
+
+/* True when OCL_TRACE_FILE is set and the trace file could be created */
+extern int cl_trace_enabled(void);
+
+/* Record one NDRange part once its curbe is filled and its surfaces bound */
+extern void cl_trace_ndrange(cl_command_queue queue, cl_kernel ker,
+                             uint32_t work_dim, const size_t *global_wk_off,
+                             const size_t *global_dim_off, const size_t *global_wk_sz,
+                             const size_t *global_wk_sz_use, const size_t *local_wk_sz,
+                             const size_t *local_wk_sz_use, uint32_t simd_sz,
+                             uint32_t thread_n, uint32_t slm_sz, uint32_t scratch_sz);
+
+#endif /* __CL_TRACE_H__ */
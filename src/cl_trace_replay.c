@@ -0,0 +1,370 @@
+/*
+ * Copyright © 2017 Intel Corporation
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library. If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+/* Offline replay of the traces written with OCL_TRACE_FILE.
+ *
+ *   ocl_trace_replay -l trace          list the programs and NDRanges
+ *   ocl_trace_replay -x dir trace      extract the program binaries
+ *   ocl_trace_replay [-n N] trace      run every NDRange N times again
+ *
+ * The extracted binaries can be loaded with clCreateProgramWithBinary or
+ * disassembled with OCL_OUTPUT_ASM. Replay creates the programs from their
+ * binaries, restores the arguments (buffers are filled with their snapshot
+ * when the trace has one, zeroed otherwise) and prints the kernel time of
+ * every NDRange. NDRanges with image, sampler, pipe or SVM arguments are
+ * listed but not replayed.
+ */
+
+#include "cl_trace.h"
+#include "program.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+typedef struct replay_program {
+  uint64_t hash;
+  char *binary;
+  size_t binary_sz;
+  cl_program program;
+} replay_program;
+
+static replay_program *programs = NULL;
+static uint32_t program_num = 0;
+static cl_context context = NULL;
+static cl_command_queue queue = NULL;
+static cl_device_id device = NULL;
+
+static const char *
+arg_type_name(uint32_t type)
+{
+  switch (type) {
+    case GBE_ARG_VALUE: return "value";
+    case GBE_ARG_GLOBAL_PTR: return "global";
+    case GBE_ARG_CONSTANT_PTR: return "constant";
+    case GBE_ARG_LOCAL_PTR: return "local";
+    case GBE_ARG_IMAGE: return "image";
+    case GBE_ARG_SAMPLER: return "sampler";
+    case GBE_ARG_PIPE: return "pipe";
+    default: return "invalid";
+  }
+}
+
+static replay_program *
+find_program(uint64_t hash)
+{
+  uint32_t i;
+  for (i = 0; i < program_num; i++)
+    if (programs[i].hash == hash)
+      return &programs[i];
+  return NULL;
+}
+
+static int
+init_cl(void)
+{
+  cl_platform_id platform;
+  cl_int err;
+  if (clGetPlatformIDs(1, &platform, NULL) != CL_SUCCESS ||
+      clGetDeviceIDs(platform, CL_DEVICE_TYPE_GPU, 1, &device, NULL) != CL_SUCCESS) {
+    fprintf(stderr, "No OpenCL GPU device\n");
+    return -1;
+  }
+  context = clCreateContext(NULL, 1, &device, NULL, NULL, &err);
+  if (err != CL_SUCCESS)
+    return -1;
+  queue = clCreateCommandQueue(context, device, CL_QUEUE_PROFILING_ENABLE, &err);
+  return err == CL_SUCCESS ? 0 : -1;
+}
+
+static void
+list_ndrange(const cl_trace_ndrange_info *nd, const char *name, const cl_trace_arg *args)
+{
+  uint32_t i;
+  printf("ndrange %s kernel %016llx program %016llx dim %u simd %u\n", name,
+         (unsigned long long)nd->kernel_hash, (unsigned long long)nd->program_hash,
+         nd->work_dim, nd->simd_sz);
+  printf("  global %llu,%llu,%llu local %llu,%llu,%llu offset %llu,%llu,%llu\n",
+         (unsigned long long)nd->global_wk_sz[0], (unsigned long long)nd->global_wk_sz[1],
+         (unsigned long long)nd->global_wk_sz[2], (unsigned long long)nd->local_wk_sz[0],
+         (unsigned long long)nd->local_wk_sz[1], (unsigned long long)nd->local_wk_sz[2],
+         (unsigned long long)nd->global_wk_off[0], (unsigned long long)nd->global_wk_off[1],
+         (unsigned long long)nd->global_wk_off[2]);
+  printf("  walker part %llu,%llu,%llu size %llu,%llu,%llu group %llu,%llu,%llu threads %u\n",
+         (unsigned long long)nd->global_dim_off[0], (unsigned long long)nd->global_dim_off[1],
+         (unsigned long long)nd->global_dim_off[2], (unsigned long long)nd->global_wk_sz_use[0],
+         (unsigned long long)nd->global_wk_sz_use[1], (unsigned long long)nd->global_wk_sz_use[2],
+         (unsigned long long)nd->local_wk_sz_use[0], (unsigned long long)nd->local_wk_sz_use[1],
+         (unsigned long long)nd->local_wk_sz_use[2], nd->thread_n);
+  printf("  curbe %u slm %u scratch %u\n", nd->curbe_sz, nd->slm_sz, nd->scratch_sz);
+  for (i = 0; i < nd->arg_n; i++) {
+    printf("  arg %u %s size %u", i, arg_type_name(args[i].type), args[i].size);
+    if (args[i].type == GBE_ARG_GLOBAL_PTR || args[i].type == GBE_ARG_CONSTANT_PTR)
+      printf(" bti %u surface %llu+%llu%s%s", args[i].bti,
+             (unsigned long long)args[i].mem_offset, (unsigned long long)args[i].mem_size,
+             args[i].is_svm ? " svm" : "", args[i].data_sz ? " snapshot" : "");
+    printf("\n");
+  }
+}
+
+static int
+replay_ndrange(const cl_trace_ndrange_info *nd, const char *name,
+               const cl_trace_arg *args, char **data, uint32_t iterations)
+{
+  replay_program *prog = find_program(nd->program_hash);
+  cl_mem *mems = NULL;
+  cl_kernel kernel = NULL;
+  cl_int err = CL_SUCCESS;
+  size_t global[3], local[3], offset[3];
+  uint32_t i;
+
+  /* The other parts of a non uniform NDRange are replayed with the first one */
+  if (nd->global_dim_off[0] || nd->global_dim_off[1] || nd->global_dim_off[2])
+    return 0;
+  if (prog == NULL) {
+    printf("%s: program not in the trace, skipped\n", name);
+    return 0;
+  }
+  for (i = 0; i < nd->arg_n; i++) {
+    if (args[i].type == GBE_ARG_IMAGE || args[i].type == GBE_ARG_SAMPLER ||
+        args[i].type == GBE_ARG_PIPE || args[i].is_svm ||
+        (args[i].type == GBE_ARG_VALUE && args[i].data_sz != args[i].size)) {
+      printf("%s: argument %u can not be replayed, skipped\n", name, i);
+      return 0;
+    }
+  }
+
+  if (prog->program == NULL) {
+    const unsigned char *binary = (const unsigned char *)prog->binary;
+    prog->program = clCreateProgramWithBinary(context, 1, &device, &prog->binary_sz,
+                                              &binary, NULL, &err);
+    if (err != CL_SUCCESS || clBuildProgram(prog->program, 1, &device, NULL, NULL, NULL) != CL_SUCCESS) {
+      fprintf(stderr, "%s: can not build the program %016llx\n", name, (unsigned long long)prog->hash);
+      return -1;
+    }
+  }
+  kernel = clCreateKernel(prog->program, name, &err);
+  if (err != CL_SUCCESS) {
+    fprintf(stderr, "%s: kernel not found\n", name);
+    return -1;
+  }
+
+  mems = calloc(nd->arg_n + 1, sizeof(cl_mem));
+  for (i = 0; i < nd->arg_n && err == CL_SUCCESS; i++) {
+    switch (args[i].type) {
+      case GBE_ARG_VALUE:
+        err = clSetKernelArg(kernel, i, args[i].size, data[i]);
+        break;
+      case GBE_ARG_LOCAL_PTR:
+        err = clSetKernelArg(kernel, i, args[i].size, NULL);
+        break;
+      default:
+        if (args[i].mem_size) {
+          mems[i] = clCreateBuffer(context, CL_MEM_READ_WRITE, args[i].mem_size, NULL, &err);
+          if (err != CL_SUCCESS)
+            break;
+          if (args[i].data_sz)
+            err = clEnqueueWriteBuffer(queue, mems[i], CL_TRUE, 0, args[i].data_sz,
+                                       data[i], 0, NULL, NULL);
+          else {
+            const char zero = 0;
+            err = clEnqueueFillBuffer(queue, mems[i], &zero, 1, 0, args[i].mem_size,
+                                      0, NULL, NULL);
+          }
+          if (err != CL_SUCCESS)
+            break;
+        }
+        err = clSetKernelArg(kernel, i, sizeof(cl_mem), &mems[i]);
+        break;
+    }
+  }
+
+  for (i = 0; i < 3; i++) {
+    global[i] = nd->global_wk_sz[i];
+    local[i] = nd->local_wk_sz[i];
+    offset[i] = nd->global_wk_off[i];
+  }
+  for (i = 0; i < iterations && err == CL_SUCCESS; i++) {
+    cl_event event;
+    cl_ulong start = 0, end = 0;
+    err = clEnqueueNDRangeKernel(queue, kernel, nd->work_dim, offset, global, local,
+                                 0, NULL, &event);
+    if (err != CL_SUCCESS)
+      break;
+    clWaitForEvents(1, &event);
+    clGetEventProfilingInfo(event, CL_PROFILING_COMMAND_START, sizeof(start), &start, NULL);
+    clGetEventProfilingInfo(event, CL_PROFILING_COMMAND_END, sizeof(end), &end, NULL);
+    clReleaseEvent(event);
+    printf("%s: global %llu,%llu,%llu local %llu,%llu,%llu time %.3f ms\n", name,
+           (unsigned long long)global[0], (unsigned long long)global[1],
+           (unsigned long long)global[2], (unsigned long long)local[0],
+           (unsigned long long)local[1], (unsigned long long)local[2],
+           (end - start) / 1000000.0);
+  }
+  if (err != CL_SUCCESS)
+    fprintf(stderr, "%s: replay failed with error %d\n", name, err);
+
+  for (i = 0; i < nd->arg_n; i++)
+    if (mems[i])
+      clReleaseMemObject(mems[i]);
+  free(mems);
+  clReleaseKernel(kernel);
+  return err == CL_SUCCESS ? 0 : -1;
+}
+
+static int
+extract_program(const char *dir, const replay_program *prog)
+{
+  char path[4096];
+  FILE *f;
+  snprintf(path, sizeof(path), "%s/%016llx.bin", dir, (unsigned long long)prog->hash);
+  f = fopen(path, "wb");
+  if (f == NULL || fwrite(prog->binary, prog->binary_sz, 1, f) != 1) {
+    fprintf(stderr, "Can not write %s\n", path);
+    if (f)
+      fclose(f);
+    return -1;
+  }
+  fclose(f);
+  printf("%s\n", path);
+  return 0;
+}
+
+/* Parse one NDRange record, the pointers of args and data point into rec */
+static int
+parse_ndrange(char *rec, uint64_t size, cl_trace_ndrange_info **nd, char **name,
+              cl_trace_arg **args, char ***data)
+{
+  uint64_t pos = sizeof(cl_trace_ndrange_info);
+  uint32_t i;
+  if (size < pos)
+    return -1;
+  *nd = (cl_trace_ndrange_info *)rec;
+  *name = rec + pos;
+  pos += (*nd)->name_sz + (*nd)->curbe_sz;
+  if (pos > size || (*nd)->name_sz == 0 || rec[sizeof(cl_trace_ndrange_info) + (*nd)->name_sz - 1] != '\0')
+    return -1;
+  *args = calloc((*nd)->arg_n + 1, sizeof(cl_trace_arg));
+  *data = calloc((*nd)->arg_n + 1, sizeof(char *));
+  for (i = 0; i < (*nd)->arg_n; i++) {
+    if (pos + sizeof(cl_trace_arg) > size)
+      return -1;
+    memcpy(&(*args)[i], rec + pos, sizeof(cl_trace_arg));
+    pos += sizeof(cl_trace_arg);
+    if (pos + (*args)[i].data_sz > size)
+      return -1;
+    (*data)[i] = rec + pos;
+    pos += (*args)[i].data_sz;
+  }
+  return 0;
+}
+
+int
+main(int argc, char *argv[])
+{
+  const char *extract_dir = NULL;
+  uint32_t iterations = 1;
+  int list = 0, ret = 0, opt;
+  cl_trace_header header;
+  cl_trace_record record;
+  FILE *trace;
+
+  while ((opt = getopt(argc, argv, "lx:n:")) != -1) {
+    switch (opt) {
+      case 'l': list = 1; break;
+      case 'x': extract_dir = optarg; break;
+      case 'n': iterations = atoi(optarg); break;
+      default: optind = argc; break;
+    }
+  }
+  if (optind != argc - 1) {
+    fprintf(stderr, "Usage: %s [-l] [-x dir] [-n iterations] trace\n", argv[0]);
+    return 1;
+  }
+
+  trace = fopen(argv[optind], "rb");
+  if (trace == NULL || fread(&header, sizeof(header), 1, trace) != 1 ||
+      header.magic != CL_TRACE_MAGIC || header.version != CL_TRACE_VERSION) {
+    fprintf(stderr, "%s is not a Beignet trace\n", argv[optind]);
+    return 1;
+  }
+  if (list)
+    printf("device 0x%x gen %u\n", header.device_id, header.gen_ver);
+  else if (extract_dir == NULL && init_cl() != 0)
+    return 1;
+
+  while (ret == 0 && fread(&record, sizeof(record), 1, trace) == 1) {
+    char *rec = malloc(record.size + 1);
+    if (rec == NULL || fread(rec, record.size, 1, trace) != 1) {
+      fprintf(stderr, "Truncated trace\n");
+      free(rec);
+      ret = 1;
+      break;
+    }
+    if (record.type == CL_TRACE_RECORD_PROGRAM && record.size >= sizeof(cl_trace_program_info)) {
+      const cl_trace_program_info *info = (const cl_trace_program_info *)rec;
+      replay_program *prog;
+      if (info->binary_sz + sizeof(cl_trace_program_info) > record.size ||
+          find_program(info->hash)) {
+        free(rec);
+        continue;
+      }
+      programs = realloc(programs, (program_num + 1) * sizeof(replay_program));
+      prog = &programs[program_num++];
+      prog->hash = info->hash;
+      prog->binary_sz = info->binary_sz;
+      prog->binary = malloc(info->binary_sz);
+      prog->program = NULL;
+      memcpy(prog->binary, rec + sizeof(cl_trace_program_info), info->binary_sz);
+      if (list)
+        printf("program %016llx size %llu\n", (unsigned long long)prog->hash,
+               (unsigned long long)prog->binary_sz);
+      else if (extract_dir && extract_program(extract_dir, prog) != 0)
+        ret = 1;
+    } else if (record.type == CL_TRACE_RECORD_NDRANGE && extract_dir == NULL) {
+      cl_trace_ndrange_info *nd;
+      cl_trace_arg *args = NULL;
+      char **data = NULL;
+      char *name;
+      if (parse_ndrange(rec, record.size, &nd, &name, &args, &data) != 0) {
+        fprintf(stderr, "Corrupted NDRange record\n");
+        ret = 1;
+      } else if (list)
+        list_ndrange(nd, name, args);
+      else if (replay_ndrange(nd, name, args, data, iterations) != 0)
+        ret = 1;
+      free(args);
+      free(data);
+    }
+    free(rec);
+  }
+
+  while (program_num--) {
+    if (programs[program_num].program)
+      clReleaseProgram(programs[program_num].program);
+    free(programs[program_num].binary);
+  }
+  free(programs);
+  if (queue)
+    clReleaseCommandQueue(queue);
+  if (context)
+    clReleaseContext(context);
+  fclose(trace);
+  return ret;
+}
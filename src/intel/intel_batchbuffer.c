@@ -79,6 +79,8 @@ intel_batchbuffer_reset(intel_batchbuffer_t *batch, size_t sz)
   batch->atomic = 0;
   batch->last_bo = batch->buffer;
   batch->enable_slm = 0;
+  batch->l3_offset = batch->l3_size = 0;
+  batch->l3_config = batch->l3_config_end = -1;
   return 0;
 }
 
@@ -121,12 +123,20 @@ intel_batchbuffer_flush(intel_batchbuffer_t *batch)
   *(uint32_t*)batch->ptr = MI_BATCH_BUFFER_END;
   batch->ptr += 4;
   used = batch->ptr - batch->map;
-  dri_bo_unmap(batch->buffer);
-  batch->ptr = batch->map = NULL;
 
+  /* The batches run in submission order, the L3 state of the context is
+   * only known here */
   if (!is_locked)
     intel_driver_lock_hardware(batch->intel);
 
+  if (batch->l3_config >= 0 && batch->l3_config == batch->intel->l3_config)
+    memset(batch->map + batch->l3_offset, 0, batch->l3_size); /* MI_NOOP */
+  if (batch->l3_config_end >= 0)
+    batch->intel->l3_config = batch->l3_config_end;
+
+  dri_bo_unmap(batch->buffer);
+  batch->ptr = batch->map = NULL;
+
   int flag = I915_EXEC_RENDER;
   if(batch->enable_slm) {
     /* use the hard code here temp, must change to
@@ -135,6 +145,7 @@ intel_batchbuffer_flush(intel_batchbuffer_t *batch)
   }
   if (drm_intel_gem_bo_context_exec(batch->buffer, batch->intel->ctx, used, flag) < 0) {
     fprintf(stderr, "drm_intel_gem_bo_context_exec() failed: %s\n", strerror(errno));
+    batch->intel->l3_config = -1;
     err = -1;
   }
 
@@ -87,6 +87,12 @@ typedef struct intel_batchbuffer
    *  flag when call exec. */
   uint8_t enable_slm;
   int atomic;
+  /** L3 setup at the start of the batch, turned into MI_NOOPs at submission
+   *  when the hardware context already has this configuration. */
+  uint32_t l3_offset;
+  uint32_t l3_size;
+  int l3_config;      /* Configuration set by the batch, -1 if none */
+  int l3_config_end;  /* Configuration left by the batch, -1 if none */
 } intel_batchbuffer_t;
 
 extern intel_batchbuffer_t* intel_batchbuffer_new(struct intel_driver*);
@@ -96,6 +96,7 @@ intel_driver_new(void)
 
   TRY_ALLOC_NO_ERR (driver, CALLOC(intel_driver_t));
   driver->fd = -1;
+  driver->l3_config = -1;
 
 exit:
   return driver;
@@ -210,13 +211,68 @@ else
 return 1;
 }
 
-static cl_int
-intel_driver_open(intel_driver_t *intel, cl_context_prop props)
-{
-int cardi;
 #ifdef HAS_X11
+/* Connect to the X server and get the device through DRI2 */
+static void
+intel_driver_open_x11(intel_driver_t *intel)
+{
 char *driver_name;
+intel->x11_display = XOpenDisplay(NULL);
+
+if(intel->x11_display) {
+  if((intel->dri_ctx = getDRI2State(intel->x11_display,
+                                   DefaultScreen(intel->x11_display),
+                                   &driver_name))) {
+    intel_driver_init_shared(intel, intel->dri_ctx);
+    Xfree(driver_name);
+  }
+}
+}
 #endif
+
+static void
+intel_driver_open_render(intel_driver_t *intel)
+{
+int cardi;
+char card_name[20];
+for(cardi = 0; cardi < 16; cardi++) {
+  sprintf(card_name, "/dev/dri/renderD%d", 128+cardi);
+  if (access(card_name, R_OK) != 0)
+    continue;
+  if(intel_driver_init_render(intel, card_name))
+    break;
+}
+}
+
+static void
+intel_driver_open_master(intel_driver_t *intel)
+{
+int cardi;
+char card_name[20];
+for(cardi = 0; cardi < 16; cardi++) {
+  sprintf(card_name, "/dev/dri/card%d", cardi);
+  if (access(card_name, R_OK) != 0)
+    continue;
+  if(intel_driver_init_master(intel, card_name))
+    break;
+}
+}
+
+/* set OCL_DEBUG_DRIVER_OPEN=1 to print the way the device was opened */
+static void
+intel_driver_report_open(const char *path)
+{
+char *val;
+val = getenv("OCL_DEBUG_DRIVER_OPEN");
+if (val && atoi(val) != 0)
+  fprintf(stderr, "Beignet: device opened through %s\n", path);
+}
+
+static cl_int
+intel_driver_open(intel_driver_t *intel, cl_context_prop props)
+{
+const char *path = NULL;
+int gl_share = 0;
 if (props != NULL
     && props->gl_type != CL_GL_NOSHARE
     && props->gl_type != CL_GL_GLX_DISPLAY
@@ -224,46 +280,44 @@ if (props != NULL
   fprintf(stderr, "Unsupported gl share type %d.\n", props->gl_type);
   return CL_INVALID_OPERATION;
 }
+gl_share = props != NULL && props->gl_type != CL_GL_NOSHARE;
 
+/* Only GL sharing needs the X server. Other contexts (and the device probe)
+ * go to the render node directly, connecting to an unreachable DISPLAY may
+ * take long or hang. */
 #ifdef HAS_X11
-intel->x11_display = XOpenDisplay(NULL);
-
-if(intel->x11_display) {
-  if((intel->dri_ctx = getDRI2State(intel->x11_display,
-                                   DefaultScreen(intel->x11_display),
-                                   &driver_name))) {
-    intel_driver_init_shared(intel, intel->dri_ctx);
-    Xfree(driver_name);
-  }
+if (gl_share) {
+  intel_driver_open_x11(intel);
+  if (intel_driver_is_active(intel))
+    path = "X11/DRI2";
 }
 #endif
 
 if(!intel_driver_is_active(intel)) {
-  char card_name[20];
-  for(cardi = 0; cardi < 16; cardi++) {
-    sprintf(card_name, "/dev/dri/renderD%d", 128+cardi);
-    if (access(card_name, R_OK) != 0)
-      continue;
-    if(intel_driver_init_render(intel, card_name))
-      break;
-  }
+  intel_driver_open_render(intel);
+  if (intel_driver_is_active(intel))
+    path = "render node";
+}
+
+#ifdef HAS_X11
+if(!intel_driver_is_active(intel) && !gl_share) {
+  intel_driver_open_x11(intel);
+  if (intel_driver_is_active(intel))
+    path = "X11/DRI2";
 }
+#endif
 
 if(!intel_driver_is_active(intel)) {
-  char card_name[20];
-  for(cardi = 0; cardi < 16; cardi++) {
-    sprintf(card_name, "/dev/dri/card%d", cardi);
-    if (access(card_name, R_OK) != 0)
-      continue;
-    if(intel_driver_init_master(intel, card_name))
-      break;
-  }
+  intel_driver_open_master(intel);
+  if (intel_driver_is_active(intel))
+    path = "primary node";
 }
 
 if(!intel_driver_is_active(intel)) {
   fprintf(stderr, "Device open failed, aborting...\n");
   return CL_DEVICE_NOT_FOUND;
 }
+intel_driver_report_open(path);
 
 #ifdef HAS_GL_EGL
 if (props && props->gl_type == CL_GL_EGL_DISPLAY) {
@@ -91,6 +91,7 @@ typedef struct intel_driver
   struct dri_state *dri_ctx;
   struct intel_gpgpu_node *gpgpu_list;
   int atomic_test_result;
+  int l3_config;     /* Last L3 configuration submitted in ctx, -1 if unknown */
 } intel_driver_t;
 
 #define SET_BLOCKED_SIGSET(DRIVER)   do {                     \
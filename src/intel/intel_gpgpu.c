@@ -88,9 +88,13 @@ typedef void (intel_gpgpu_set_base_address_t)(intel_gpgpu_t *gpgpu);
 intel_gpgpu_set_base_address_t *intel_gpgpu_set_base_address = NULL;
 
 typedef void (intel_gpgpu_setup_bti_t)(intel_gpgpu_t *gpgpu, drm_intel_bo *buf, uint32_t internal_offset,
-                                       size_t size, unsigned char index, uint32_t format);
+                                       size_t size, unsigned char index, uint32_t format,
+                                       uint32_t cache_ctrl);
 intel_gpgpu_setup_bti_t *intel_gpgpu_setup_bti = NULL;
 
+typedef uint32_t (intel_gpgpu_get_buf_cache_ctrl_t)(uint32_t access);
+intel_gpgpu_get_buf_cache_ctrl_t *intel_gpgpu_get_buf_cache_ctrl = NULL;
+
 
 typedef void (intel_gpgpu_load_vfe_state_t)(intel_gpgpu_t *gpgpu);
 intel_gpgpu_load_vfe_state_t *intel_gpgpu_load_vfe_state = NULL;
@@ -304,6 +308,25 @@ intel_gpgpu_get_cache_ctrl_gen9()
   return (mocs_index << 1);
 }
 
+/* Only the LLC/eLLC age of the lines follows the access traits: a buffer
+   may be bound through several surfaces of a kernel and the CPU may hold
+   some of its lines in LLC, so the L3 and LLC cacheability must not change */
+static uint32_t
+intel_gpgpu_get_buf_cache_ctrl_default(uint32_t access)
+{
+  return cl_gpgpu_get_cache_ctrl();
+}
+
+static uint32_t
+intel_gpgpu_get_buf_cache_ctrl_gen8(uint32_t access)
+{
+  /* Lookup tables and buffers accessed in loops stay longer in LLC, the
+     streams age first */
+  if (access & (GPGPU_BUF_REUSED | GPGPU_BUF_CONSTANT))
+    return intel_gpgpu_get_cache_ctrl_gen8() | llc_age_good;
+  return intel_gpgpu_get_cache_ctrl_gen8() | llc_age_poor;
+}
+
 static void
 intel_gpgpu_set_base_address_gen7(intel_gpgpu_t *gpgpu)
 {
@@ -798,10 +821,19 @@ intel_gpgpu_set_L3_gen8(intel_gpgpu_t *gpgpu, uint32_t use_slm)
 static void
 intel_gpgpu_batch_start(intel_gpgpu_t *gpgpu)
 {
-  intel_batchbuffer_start_atomic(gpgpu->batch, 256);
+  intel_batchbuffer_t *batch = gpgpu->batch;
+  /* Barriers alone do not need the SLM partition of L3, only the kernels
+     allocating local memory do */
+  const uint32_t use_slm = gpgpu->ker->slm_sz != 0;
+
+  intel_batchbuffer_start_atomic(batch, 256);
   intel_gpgpu_pipe_control(gpgpu);
   assert(intel_gpgpu_set_L3);
-  intel_gpgpu_set_L3(gpgpu, gpgpu->ker->use_slm);
+  /* Skipped at submission if the context already has this configuration */
+  batch->l3_offset = batch->ptr - batch->map;
+  intel_gpgpu_set_L3(gpgpu, use_slm);
+  batch->l3_size = batch->ptr - batch->map - batch->l3_offset;
+  batch->l3_config = batch->l3_config_end = use_slm;
   intel_gpgpu_select_pipeline(gpgpu);
   intel_gpgpu_set_base_address(gpgpu);
   intel_gpgpu_load_vfe_state(gpgpu);
@@ -843,6 +875,7 @@ intel_gpgpu_post_action_gen75(intel_gpgpu_t *gpgpu, int32_t flush_mode)
   /* Restore L3 control to disable SLM mode,
      otherwise, may affect 3D pipeline */
   intel_gpgpu_set_L3(gpgpu, 0);
+  gpgpu->batch->l3_config_end = 0;
 }
 
 static void
@@ -1031,13 +1064,15 @@ intel_gpgpu_alloc_constant_buffer(intel_gpgpu_t *gpgpu, uint32_t size, uint8_t b
   if (gpgpu->constant_b.bo == NULL)
     return NULL;
 
-  intel_gpgpu_setup_bti(gpgpu, gpgpu->constant_b.bo, 0, size, bti, I965_SURFACEFORMAT_R32G32B32A32_UINT);
+  intel_gpgpu_setup_bti(gpgpu, gpgpu->constant_b.bo, 0, size, bti, I965_SURFACEFORMAT_R32G32B32A32_UINT,
+                        intel_gpgpu_get_buf_cache_ctrl(GPGPU_BUF_READ | GPGPU_BUF_CONSTANT));
   return gpgpu->constant_b.bo;
 }
 
 static void
 intel_gpgpu_setup_bti_gen7(intel_gpgpu_t *gpgpu, drm_intel_bo *buf, uint32_t internal_offset,
-                                   size_t size, unsigned char index, uint32_t format)
+                                   size_t size, unsigned char index, uint32_t format,
+                                   uint32_t cache_ctrl)
 {
   assert(size <= (2ul<<30));
   size_t s = size - 1;
@@ -1052,7 +1087,7 @@ intel_gpgpu_setup_bti_gen7(intel_gpgpu_t *gpgpu, drm_intel_bo *buf, uint32_t int
     assert((ss0->ss2.width & 0x03) == 3);
   ss0->ss2.height = (s >> 7) & 0x3fff; /* bits 20:7 of sz */
   ss0->ss3.depth  = (s >> 21) & 0x3ff; /* bits 30:21 of sz */
-  ss0->ss5.cache_control = cl_gpgpu_get_cache_ctrl();
+  ss0->ss5.cache_control = cache_ctrl;
   heap->binding_table[index] = offsetof(surface_heap_t, surface) + index * sizeof(gen7_surface_state_t);
 
   ss0->ss1.base_addr = buf->offset + internal_offset;
@@ -1068,7 +1103,8 @@ intel_gpgpu_setup_bti_gen7(intel_gpgpu_t *gpgpu, drm_intel_bo *buf, uint32_t int
 
 static void
 intel_gpgpu_setup_bti_gen75(intel_gpgpu_t *gpgpu, drm_intel_bo *buf, uint32_t internal_offset,
-                                   size_t size, unsigned char index, uint32_t format)
+                                   size_t size, unsigned char index, uint32_t format,
+                                   uint32_t cache_ctrl)
 {
   assert(size <= (2ul<<30));
   size_t s = size - 1;
@@ -1089,7 +1125,7 @@ intel_gpgpu_setup_bti_gen75(intel_gpgpu_t *gpgpu, drm_intel_bo *buf, uint32_t in
     assert((ss0->ss2.width & 0x03) == 3);
   ss0->ss2.height = (s >> 7) & 0x3fff; /* bits 20:7 of sz */
   ss0->ss3.depth  = (s >> 21) & 0x3ff; /* bits 30:21 of sz */
-  ss0->ss5.cache_control = cl_gpgpu_get_cache_ctrl();
+  ss0->ss5.cache_control = cache_ctrl;
   heap->binding_table[index] = offsetof(surface_heap_t, surface) + index * sizeof(gen7_surface_state_t);
 
   ss0->ss1.base_addr = buf->offset + internal_offset;
@@ -1105,7 +1141,8 @@ intel_gpgpu_setup_bti_gen75(intel_gpgpu_t *gpgpu, drm_intel_bo *buf, uint32_t in
 
 static void
 intel_gpgpu_setup_bti_gen8(intel_gpgpu_t *gpgpu, drm_intel_bo *buf, uint32_t internal_offset,
-                                   size_t size, unsigned char index, uint32_t format)
+                                   size_t size, unsigned char index, uint32_t format,
+                                   uint32_t cache_ctrl)
 {
   assert(size <= (2ul<<30));
   size_t s = size - 1;
@@ -1126,7 +1163,7 @@ intel_gpgpu_setup_bti_gen8(intel_gpgpu_t *gpgpu, drm_intel_bo *buf, uint32_t int
     assert((ss0->ss2.width & 0x03) == 3);
   ss0->ss2.height = (s >> 7) & 0x3fff; /* bits 20:7 of sz */
   ss0->ss3.depth  = (s >> 21) & 0x3ff; /* bits 30:21 of sz */
-  ss0->ss1.mem_obj_ctrl_state = cl_gpgpu_get_cache_ctrl();
+  ss0->ss1.mem_obj_ctrl_state = cache_ctrl;
   heap->binding_table[index] = offsetof(surface_heap_t, surface) + index * sizeof(gen8_surface_state_t);
   ss0->ss8.surface_base_addr_lo = (buf->offset64 + internal_offset) & 0xffffffff;
   ss0->ss9.surface_base_addr_hi = ((buf->offset64 + internal_offset) >> 32) & 0xffffffff;
@@ -1142,7 +1179,8 @@ intel_gpgpu_setup_bti_gen8(intel_gpgpu_t *gpgpu, drm_intel_bo *buf, uint32_t int
 
 static void
 intel_gpgpu_setup_bti_gen9(intel_gpgpu_t *gpgpu, drm_intel_bo *buf, uint32_t internal_offset,
-                                   size_t size, unsigned char index, uint32_t format)
+                                   size_t size, unsigned char index, uint32_t format,
+                                   uint32_t cache_ctrl)
 {
   assert(size <= (4ul<<30));
   size_t s = size - 1;
@@ -1163,7 +1201,7 @@ intel_gpgpu_setup_bti_gen9(intel_gpgpu_t *gpgpu, drm_intel_bo *buf, uint32_t int
     assert((ss0->ss2.width & 0x03) == 3);
   ss0->ss2.height = (s >> 7) & 0x3fff; /* bits 20:7 of sz */
   ss0->ss3.depth  = (s >> 21) & 0x7ff; /* bits 31:21 of sz, from bespec only gen 9 support that*/
-  ss0->ss1.mem_obj_ctrl_state = cl_gpgpu_get_cache_ctrl();
+  ss0->ss1.mem_obj_ctrl_state = cache_ctrl;
   heap->binding_table[index] = offsetof(surface_heap_t, surface) + index * sizeof(gen8_surface_state_t);
   ss0->ss8.surface_base_addr_lo = (buf->offset64 + internal_offset) & 0xffffffff;
   ss0->ss9.surface_base_addr_hi = ((buf->offset64 + internal_offset) >> 32) & 0xffffffff;
@@ -1632,7 +1670,7 @@ intel_gpgpu_bind_image_gen9(intel_gpgpu_t *gpgpu,
 
 static void
 intel_gpgpu_bind_buf(intel_gpgpu_t *gpgpu, drm_intel_bo *buf, uint32_t offset,
-                     uint32_t internal_offset, size_t size, uint8_t bti)
+                     uint32_t internal_offset, size_t size, uint8_t bti, uint32_t access)
 {
   assert(gpgpu->binded_n < max_buf_n);
   if(offset != -1) {
@@ -1641,7 +1679,8 @@ intel_gpgpu_bind_buf(intel_gpgpu_t *gpgpu, drm_intel_bo *buf, uint32_t offset,
     gpgpu->binded_offset[gpgpu->binded_n] = offset;
     gpgpu->binded_n++;
   }
-  intel_gpgpu_setup_bti(gpgpu, buf, internal_offset, size, bti, I965_SURFACEFORMAT_RAW);
+  intel_gpgpu_setup_bti(gpgpu, buf, internal_offset, size, bti, I965_SURFACEFORMAT_RAW,
+                        intel_gpgpu_get_buf_cache_ctrl(access));
 }
 
 static int
@@ -1675,7 +1714,7 @@ intel_gpgpu_set_stack(intel_gpgpu_t *gpgpu, uint32_t offset, uint32_t size, uint
   drm_intel_bufmgr *bufmgr = gpgpu->drv->bufmgr;
   gpgpu->stack_b.bo = drm_intel_bo_alloc(bufmgr, "STACK", size, 64);
 
-  cl_gpgpu_bind_buf((cl_gpgpu)gpgpu, (cl_buffer)gpgpu->stack_b.bo, offset, 0, size, bti);
+  cl_gpgpu_bind_buf((cl_gpgpu)gpgpu, (cl_buffer)gpgpu->stack_b.bo, offset, 0, size, bti, GPGPU_BUF_DEFAULT);
 }
 
 static void
@@ -1705,16 +1744,19 @@ intel_gpgpu_build_idrt_gen7(intel_gpgpu_t *gpgpu, cl_gpgpu_kernel *kernel)
     size_t slm_sz = kernel->slm_sz;
     desc->desc5.group_threads_num = kernel->use_slm ? kernel->thread_n : 0;
     desc->desc5.barrier_enable = kernel->use_slm;
-    if (slm_sz <= 4*KB)
-      slm_sz = 4*KB;
-    else if (slm_sz <= 8*KB)
-      slm_sz = 8*KB;
-    else if (slm_sz <= 16*KB)
-      slm_sz = 16*KB;
-    else if (slm_sz <= 32*KB)
-      slm_sz = 32*KB;
-    else
-      slm_sz = 64*KB;
+    /* Barrier only kernels keep an empty SLM allocation */
+    if (slm_sz != 0) {
+      if (slm_sz <= 4*KB)
+        slm_sz = 4*KB;
+      else if (slm_sz <= 8*KB)
+        slm_sz = 8*KB;
+      else if (slm_sz <= 16*KB)
+        slm_sz = 16*KB;
+      else if (slm_sz <= 32*KB)
+        slm_sz = 32*KB;
+      else
+        slm_sz = 64*KB;
+    }
     slm_sz = slm_sz >> 12;
     desc->desc5.slm_sz = slm_sz;
   }
@@ -2192,7 +2234,8 @@ intel_gpgpu_states_setup(intel_gpgpu_t *gpgpu, cl_gpgpu_kernel *kernel)
 {
   gpgpu->ker = kernel;
   if (gpgpu->drv->null_bo)
-    intel_gpgpu_setup_bti(gpgpu, gpgpu->drv->null_bo, 0, 64*1024, 0xfe, I965_SURFACEFORMAT_RAW);
+    intel_gpgpu_setup_bti(gpgpu, gpgpu->drv->null_bo, 0, 64*1024, 0xfe, I965_SURFACEFORMAT_RAW,
+                          cl_gpgpu_get_cache_ctrl());
 
   intel_gpgpu_build_idrt(gpgpu, kernel);
   dri_bo_unmap(gpgpu->aux_buf.bo);
@@ -2463,7 +2506,7 @@ intel_gpgpu_set_profiling_buf(intel_gpgpu_t *gpgpu, uint32_t size, uint32_t offs
   }
   memset(bo->virtual, 0, size);
   drm_intel_bo_unmap(bo);
-  cl_gpgpu_bind_buf((cl_gpgpu)gpgpu, (cl_buffer)bo, offset, 0, size, bti);
+  cl_gpgpu_bind_buf((cl_gpgpu)gpgpu, (cl_buffer)bo, offset, 0, size, bti, GPGPU_BUF_DEFAULT);
   return 0;
 }
 
@@ -2495,7 +2538,8 @@ intel_gpgpu_set_printf_buf(intel_gpgpu_t *gpgpu, uint32_t size, uint8_t bti)
   *(uint32_t *)(gpgpu->printf_b.bo->virtual) = 4; // first four is for the length.
   drm_intel_bo_unmap(gpgpu->printf_b.bo);
   /* No need to bind, we do not need to emit reloc. */
-  intel_gpgpu_setup_bti(gpgpu, gpgpu->printf_b.bo, 0, size, bti, I965_SURFACEFORMAT_RAW);
+  intel_gpgpu_setup_bti(gpgpu, gpgpu->printf_b.bo, 0, size, bti, I965_SURFACEFORMAT_RAW,
+                        cl_gpgpu_get_cache_ctrl());
   return 0;
 }
 
@@ -2611,6 +2655,7 @@ intel_set_gpgpu_callbacks(int device_id)
     cl_gpgpu_bind_image = (cl_gpgpu_bind_image_cb *) intel_gpgpu_bind_image_gen8;
     intel_gpgpu_set_L3 = intel_gpgpu_set_L3_gen8;
     cl_gpgpu_get_cache_ctrl = (cl_gpgpu_get_cache_ctrl_cb *)intel_gpgpu_get_cache_ctrl_gen8;
+    intel_gpgpu_get_buf_cache_ctrl = intel_gpgpu_get_buf_cache_ctrl_gen8;
     intel_gpgpu_get_scratch_index = intel_gpgpu_get_scratch_index_gen8;
     intel_gpgpu_post_action = intel_gpgpu_post_action_gen7; //BDW need not restore SLM, same as gen7
     intel_gpgpu_read_ts_reg = intel_gpgpu_read_ts_reg_gen7;
@@ -2634,6 +2679,7 @@ intel_set_gpgpu_callbacks(int device_id)
     cl_gpgpu_bind_image_for_vme = (cl_gpgpu_bind_image_cb *) intel_gpgpu_bind_image_for_vme_gen9;
     intel_gpgpu_set_L3 = intel_gpgpu_set_L3_gen8;
     cl_gpgpu_get_cache_ctrl = (cl_gpgpu_get_cache_ctrl_cb *)intel_gpgpu_get_cache_ctrl_gen9;
+    intel_gpgpu_get_buf_cache_ctrl = intel_gpgpu_get_buf_cache_ctrl_default;
     intel_gpgpu_get_scratch_index = intel_gpgpu_get_scratch_index_gen8;
     intel_gpgpu_post_action = intel_gpgpu_post_action_gen7; //SKL need not restore SLM, same as gen7
     intel_gpgpu_read_ts_reg = intel_gpgpu_read_ts_reg_gen7;
@@ -2666,6 +2712,7 @@ intel_set_gpgpu_callbacks(int device_id)
     cl_gpgpu_bind_image = (cl_gpgpu_bind_image_cb *) intel_gpgpu_bind_image_gen75;
     intel_gpgpu_set_L3 = intel_gpgpu_set_L3_gen75;
     cl_gpgpu_get_cache_ctrl = (cl_gpgpu_get_cache_ctrl_cb *)intel_gpgpu_get_cache_ctrl_gen75;
+    intel_gpgpu_get_buf_cache_ctrl = intel_gpgpu_get_buf_cache_ctrl_default;
     intel_gpgpu_get_scratch_index = intel_gpgpu_get_scratch_index_gen75;
     intel_gpgpu_post_action = intel_gpgpu_post_action_gen75;
     intel_gpgpu_read_ts_reg = intel_gpgpu_read_ts_reg_gen7; //HSW same as ivb
@@ -2683,6 +2730,7 @@ intel_set_gpgpu_callbacks(int device_id)
       intel_gpgpu_read_ts_reg = intel_gpgpu_read_ts_reg_gen7;
     }
     cl_gpgpu_get_cache_ctrl = (cl_gpgpu_get_cache_ctrl_cb *)intel_gpgpu_get_cache_ctrl_gen7;
+    intel_gpgpu_get_buf_cache_ctrl = intel_gpgpu_get_buf_cache_ctrl_default;
     intel_gpgpu_get_scratch_index = intel_gpgpu_get_scratch_index_gen7;
     intel_gpgpu_post_action = intel_gpgpu_post_action_gen7;
     intel_gpgpu_setup_bti = intel_gpgpu_setup_bti_gen7;
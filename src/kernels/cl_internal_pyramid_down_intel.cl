@@ -0,0 +1,16 @@
+/* Next level of an image pyramid: dst is half the size of src and each of its
+ * pixels is the average of a 2x2 block of src. Sampling with a linear filter
+ * at the shared corner of the 4 pixels lets the sampler do the average, so
+ * src must have a normalized or float channel type. */
+kernel void pyramid_down_intel(__read_only image2d_t src, __write_only image2d_t dst)
+{
+  const sampler_t sampler = CLK_NORMALIZED_COORDS_FALSE |
+                            CLK_ADDRESS_CLAMP_TO_EDGE |
+                            CLK_FILTER_LINEAR;
+  int x = get_global_id(0), y = get_global_id(1);
+
+  if (x >= get_image_width(dst) || y >= get_image_height(dst))
+    return;
+  float4 color = read_imagef(src, sampler, (float2)(2 * x + 1, 2 * y + 1));
+  write_imagef(dst, (int2)(x, y), color);
+}
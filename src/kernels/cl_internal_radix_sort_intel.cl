@@ -0,0 +1,90 @@
+/* One pass of a stable LSD radix sort of (key, value) pairs on the 4 bits
+ * digit starting at bit shift:
+ *  1. radix_sort_histogram_*_intel counts the digits of each work group in
+ *     hist[digit * get_num_groups(0) + get_group_id(0)] (16 entries per group)
+ *  2. hist is turned into offsets by an exclusive scan, see
+ *     scan_exclusive_add_uint_intel
+ *  3. radix_sort_scatter_*_intel moves the pairs to their place for this digit
+ * Both kernels must run with the same global and local sizes. Sorting 32 bits
+ * keys takes 8 passes, 64 bits keys 16 passes, swapping src and dst between
+ * the passes. */
+kernel void radix_sort_histogram_uint_intel(global const uint *keys, global uint *hist,
+                                            uint n, uint shift)
+{
+  size_t gid = get_global_id(0);
+  uint valid = gid < n;
+  uint digit = valid ? (keys[gid] >> shift) & 0xf : 0;
+  uint group_num = get_num_groups(0);
+  uint d;
+
+  for (d = 0; d < 16; d++) {
+    uint count = work_group_reduce_add((uint)(valid && digit == d));
+    if (get_local_id(0) == 0)
+      hist[d * group_num + get_group_id(0)] = count;
+  }
+}
+
+kernel void radix_sort_scatter_uint_intel(global const uint *src_keys, global const uint *src_values,
+                                          global uint *dst_keys, global uint *dst_values,
+                                          global const uint *offsets, uint n, uint shift)
+{
+  size_t gid = get_global_id(0);
+  uint valid = gid < n;
+  uint key = valid ? src_keys[gid] : 0;
+  uint digit = (key >> shift) & 0xf;
+  uint group_num = get_num_groups(0);
+  uint pos = 0;
+  uint d;
+
+  /* The rank among the work items with the same digit keeps the sort stable */
+  for (d = 0; d < 16; d++) {
+    uint flag = valid && digit == d;
+    uint rank = work_group_scan_exclusive_add(flag);
+    if (flag)
+      pos = offsets[d * group_num + get_group_id(0)] + rank;
+  }
+  if (valid) {
+    dst_keys[pos] = key;
+    dst_values[pos] = src_values[gid];
+  }
+}
+
+kernel void radix_sort_histogram_ulong_intel(global const ulong *keys, global uint *hist,
+                                             uint n, uint shift)
+{
+  size_t gid = get_global_id(0);
+  uint valid = gid < n;
+  uint digit = valid ? (uint)(keys[gid] >> shift) & 0xf : 0;
+  uint group_num = get_num_groups(0);
+  uint d;
+
+  for (d = 0; d < 16; d++) {
+    uint count = work_group_reduce_add((uint)(valid && digit == d));
+    if (get_local_id(0) == 0)
+      hist[d * group_num + get_group_id(0)] = count;
+  }
+}
+
+kernel void radix_sort_scatter_ulong_intel(global const ulong *src_keys, global const uint *src_values,
+                                           global ulong *dst_keys, global uint *dst_values,
+                                           global const uint *offsets, uint n, uint shift)
+{
+  size_t gid = get_global_id(0);
+  uint valid = gid < n;
+  ulong key = valid ? src_keys[gid] : 0;
+  uint digit = (uint)(key >> shift) & 0xf;
+  uint group_num = get_num_groups(0);
+  uint pos = 0;
+  uint d;
+
+  for (d = 0; d < 16; d++) {
+    uint flag = valid && digit == d;
+    uint rank = work_group_scan_exclusive_add(flag);
+    if (flag)
+      pos = offsets[d * group_num + get_group_id(0)] + rank;
+  }
+  if (valid) {
+    dst_keys[pos] = key;
+    dst_values[pos] = src_values[gid];
+  }
+}
@@ -0,0 +1,38 @@
+/* Sum of each segment of src. Segment i spans [segment_offsets[i],
+ * segment_offsets[i+1]), so segment_offsets holds segment_num + 1 entries.
+ * Work groups loop over the segments, any global size works. */
+kernel void reduce_segments_add_float_intel(global const float *src,
+                                            global const uint *segment_offsets,
+                                            global float *dst, uint segment_num)
+{
+  uint segment;
+  for (segment = get_group_id(0); segment < segment_num; segment += get_num_groups(0)) {
+    uint begin = segment_offsets[segment];
+    uint end = segment_offsets[segment + 1];
+    float sum = 0.0f;
+    uint i;
+    for (i = begin + get_local_id(0); i < end; i += get_local_size(0))
+      sum += src[i];
+    sum = work_group_reduce_add(sum);
+    if (get_local_id(0) == 0)
+      dst[segment] = sum;
+  }
+}
+
+kernel void reduce_segments_add_uint_intel(global const uint *src,
+                                           global const uint *segment_offsets,
+                                           global uint *dst, uint segment_num)
+{
+  uint segment;
+  for (segment = get_group_id(0); segment < segment_num; segment += get_num_groups(0)) {
+    uint begin = segment_offsets[segment];
+    uint end = segment_offsets[segment + 1];
+    uint sum = 0;
+    uint i;
+    for (i = begin + get_local_id(0); i < end; i += get_local_size(0))
+      sum += src[i];
+    sum = work_group_reduce_add(sum);
+    if (get_local_id(0) == 0)
+      dst[segment] = sum;
+  }
+}
@@ -0,0 +1,39 @@
+/* Prefix sums of n uints. Each work group scans its part of src and writes
+ * the total of the group to group_sums[get_group_id(0)]. For more than one
+ * work group, scan group_sums with scan_exclusive_add_uint_intel and add the
+ * result back with scan_add_group_offsets_uint_intel. */
+kernel void scan_inclusive_add_uint_intel(global const uint *src, global uint *dst,
+                                          global uint *group_sums, uint n)
+{
+  size_t gid = get_global_id(0);
+  uint value = gid < n ? src[gid] : 0;
+  uint sum = work_group_scan_inclusive_add(value);
+
+  if (gid < n)
+    dst[gid] = sum;
+  if (get_local_id(0) == get_local_size(0) - 1)
+    group_sums[get_group_id(0)] = sum;
+}
+
+kernel void scan_exclusive_add_uint_intel(global const uint *src, global uint *dst,
+                                          global uint *group_sums, uint n)
+{
+  size_t gid = get_global_id(0);
+  uint value = gid < n ? src[gid] : 0;
+  uint sum = work_group_scan_exclusive_add(value);
+
+  if (gid < n)
+    dst[gid] = sum;
+  if (get_local_id(0) == get_local_size(0) - 1)
+    group_sums[get_group_id(0)] = sum + value;
+}
+
+/* group_offsets is the exclusive scan of the group sums, the local size must
+ * be the one the first pass ran with */
+kernel void scan_add_group_offsets_uint_intel(global uint *dst,
+                                              global const uint *group_offsets, uint n)
+{
+  size_t gid = get_global_id(0);
+  if (gid < n)
+    dst[gid] += group_offsets[get_group_id(0)];
+}
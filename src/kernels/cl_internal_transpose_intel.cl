@@ -0,0 +1,23 @@
+/* dst (width rows of height floats) = transpose of src (height rows of width
+ * floats). Tiles go through SLM so that both the reads and the writes are
+ * contiguous. The local size must be square and at most 16x16, and the global
+ * size a multiple of it in both dimensions. */
+kernel void transpose_float_intel(global const float *src, global float *dst,
+                                  uint width, uint height)
+{
+  local float tile[16][17];
+  uint tile_sz = get_local_size(0);
+  uint lx = get_local_id(0), ly = get_local_id(1);
+  uint x = get_group_id(0) * tile_sz + lx;
+  uint y = get_group_id(1) * tile_sz + ly;
+
+  if (x < width && y < height)
+    tile[ly][lx] = src[y * width + x];
+  barrier(CLK_LOCAL_MEM_FENCE);
+
+  /* Same tile seen from the destination */
+  x = get_group_id(1) * tile_sz + lx;
+  y = get_group_id(0) * tile_sz + ly;
+  if (x < height && y < width)
+    dst[y * height + x] = tile[lx][ly];
+}
@@ -111,6 +111,7 @@ LOCAL_SRC_FILES:= \
   compiler_insn_selection_masked_min_max.cpp \
   compiler_load_bool_imm.cpp \
   compiler_global_memory_barrier.cpp \
+  compiler_barrier_no_slm.cpp \
   compiler_local_memory_two_ptr.cpp \
   compiler_local_memory_barrier.cpp \
   compiler_local_memory_barrier_wg64.cpp \
@@ -169,6 +170,8 @@ LOCAL_SRC_FILES:= \
   compiler_long_cmp.cpp \
   compiler_long_bitcast.cpp \
   compiler_half.cpp \
+  compiler_vloada_half.cpp \
+  compiler_build_cache.cpp \
   compiler_function_argument3.cpp \
   compiler_function_qualifiers.cpp \
   compiler_bool_cross_basic_block.cpp \
@@ -0,0 +1,195 @@
+#include "utest_helper.hpp"
+#include <string.h>
+#include <vector>
+#include <algorithm>
+
+static cl_program builtin_primitives_program(void)
+{
+  const char *names = "scan_exclusive_add_uint_intel;"
+                      "scan_add_group_offsets_uint_intel;"
+                      "radix_sort_histogram_uint_intel;"
+                      "radix_sort_scatter_uint_intel;"
+                      "transpose_float_intel";
+  cl_int err = CL_SUCCESS;
+  cl_program prog = clCreateProgramWithBuiltInKernels(ctx, 1, &device, names, &err);
+  OCL_ASSERT(err == CL_SUCCESS && prog != NULL);
+  return prog;
+}
+
+static size_t builtin_group_size(cl_kernel k)
+{
+  size_t sz[3] = {0};
+  OCL_CALL(clGetKernelWorkGroupInfo, k, device, CL_KERNEL_COMPILE_WORK_GROUP_SIZE,
+           sizeof(sz), sz, NULL);
+  OCL_ASSERT(sz[0] != 0);
+  return sz[0];
+}
+
+/* In place exclusive scan of n uints, the group sums are scanned recursively */
+static void builtin_scan(cl_program prog, cl_mem data, cl_uint n)
+{
+  cl_int err = CL_SUCCESS;
+  cl_kernel scan = clCreateKernel(prog, "scan_exclusive_add_uint_intel", &err);
+  OCL_ASSERT(scan != NULL);
+  const size_t local_sz = builtin_group_size(scan);
+  const cl_uint group_num = (n + local_sz - 1) / local_sz;
+  const size_t global_sz = n;
+  cl_mem sums = clCreateBuffer(ctx, 0, group_num * sizeof(cl_uint), NULL, &err);
+  OCL_ASSERT(sums != NULL);
+
+  /* No local size, the tuned one is used */
+  OCL_CALL(clSetKernelArg, scan, 0, sizeof(cl_mem), &data);
+  OCL_CALL(clSetKernelArg, scan, 1, sizeof(cl_mem), &data);
+  OCL_CALL(clSetKernelArg, scan, 2, sizeof(cl_mem), &sums);
+  OCL_CALL(clSetKernelArg, scan, 3, sizeof(cl_uint), &n);
+  OCL_CALL(clEnqueueNDRangeKernel, queue, scan, 1, NULL, &global_sz, NULL, 0, NULL, NULL);
+
+  if (group_num > 1) {
+    builtin_scan(prog, sums, group_num);
+    cl_kernel add = clCreateKernel(prog, "scan_add_group_offsets_uint_intel", &err);
+    OCL_ASSERT(add != NULL);
+    OCL_CALL(clSetKernelArg, add, 0, sizeof(cl_mem), &data);
+    OCL_CALL(clSetKernelArg, add, 1, sizeof(cl_mem), &sums);
+    OCL_CALL(clSetKernelArg, add, 2, sizeof(cl_uint), &n);
+    OCL_CALL(clEnqueueNDRangeKernel, queue, add, 1, NULL, &global_sz, &local_sz, 0, NULL, NULL);
+    clReleaseKernel(add);
+  }
+  OCL_CALL(clFinish, queue);
+  clReleaseMemObject(sums);
+  clReleaseKernel(scan);
+}
+
+void builtin_kernel_scan_intel(void)
+{
+  const cl_uint n = 5000;
+  std::vector<cl_uint> src(n), dst(n);
+  cl_program prog = builtin_primitives_program();
+  cl_int err = CL_SUCCESS;
+
+  for (cl_uint i = 0; i < n; ++i)
+    src[i] = rand() & 0xff;
+  cl_mem data = clCreateBuffer(ctx, CL_MEM_COPY_HOST_PTR, n * sizeof(cl_uint), &src[0], &err);
+  OCL_ASSERT(data != NULL);
+
+  builtin_scan(prog, data, n);
+  OCL_CALL(clEnqueueReadBuffer, queue, data, CL_TRUE, 0, n * sizeof(cl_uint), &dst[0], 0, NULL, NULL);
+
+  cl_uint sum = 0;
+  for (cl_uint i = 0; i < n; ++i) {
+    OCL_ASSERT(dst[i] == sum);
+    sum += src[i];
+  }
+  clReleaseMemObject(data);
+  clReleaseProgram(prog);
+}
+
+MAKE_UTEST_FROM_FUNCTION(builtin_kernel_scan_intel);
+
+void builtin_kernel_radix_sort_intel(void)
+{
+  const cl_uint n = 3000;
+  std::vector<cl_uint> keys(n), values(n), sorted_keys(n), sorted_values(n);
+  cl_program prog = builtin_primitives_program();
+  cl_int err = CL_SUCCESS;
+
+  for (cl_uint i = 0; i < n; ++i) {
+    keys[i] = ((cl_uint)rand() << 16) ^ rand();
+    values[i] = i;
+  }
+
+  cl_kernel hist_k = clCreateKernel(prog, "radix_sort_histogram_uint_intel", &err);
+  OCL_ASSERT(hist_k != NULL);
+  cl_kernel scatter_k = clCreateKernel(prog, "radix_sort_scatter_uint_intel", &err);
+  OCL_ASSERT(scatter_k != NULL);
+
+  /* Both kernels must use the same groups */
+  const size_t local_sz = std::min(builtin_group_size(hist_k), builtin_group_size(scatter_k));
+  const size_t global_sz = n;
+  const cl_uint hist_n = 16 * ((n + local_sz - 1) / local_sz);
+  cl_mem k[2], v[2], hist;
+  k[0] = clCreateBuffer(ctx, CL_MEM_COPY_HOST_PTR, n * sizeof(cl_uint), &keys[0], &err);
+  v[0] = clCreateBuffer(ctx, CL_MEM_COPY_HOST_PTR, n * sizeof(cl_uint), &values[0], &err);
+  k[1] = clCreateBuffer(ctx, 0, n * sizeof(cl_uint), NULL, &err);
+  v[1] = clCreateBuffer(ctx, 0, n * sizeof(cl_uint), NULL, &err);
+  hist = clCreateBuffer(ctx, 0, hist_n * sizeof(cl_uint), NULL, &err);
+  OCL_ASSERT(k[0] && v[0] && k[1] && v[1] && hist);
+
+  for (cl_uint shift = 0; shift < 32; shift += 4) {
+    const int from = (shift / 4) & 1, to = from ^ 1;
+    OCL_CALL(clSetKernelArg, hist_k, 0, sizeof(cl_mem), &k[from]);
+    OCL_CALL(clSetKernelArg, hist_k, 1, sizeof(cl_mem), &hist);
+    OCL_CALL(clSetKernelArg, hist_k, 2, sizeof(cl_uint), &n);
+    OCL_CALL(clSetKernelArg, hist_k, 3, sizeof(cl_uint), &shift);
+    OCL_CALL(clEnqueueNDRangeKernel, queue, hist_k, 1, NULL, &global_sz, &local_sz, 0, NULL, NULL);
+    builtin_scan(prog, hist, hist_n);
+    OCL_CALL(clSetKernelArg, scatter_k, 0, sizeof(cl_mem), &k[from]);
+    OCL_CALL(clSetKernelArg, scatter_k, 1, sizeof(cl_mem), &v[from]);
+    OCL_CALL(clSetKernelArg, scatter_k, 2, sizeof(cl_mem), &k[to]);
+    OCL_CALL(clSetKernelArg, scatter_k, 3, sizeof(cl_mem), &v[to]);
+    OCL_CALL(clSetKernelArg, scatter_k, 4, sizeof(cl_mem), &hist);
+    OCL_CALL(clSetKernelArg, scatter_k, 5, sizeof(cl_uint), &n);
+    OCL_CALL(clSetKernelArg, scatter_k, 6, sizeof(cl_uint), &shift);
+    OCL_CALL(clEnqueueNDRangeKernel, queue, scatter_k, 1, NULL, &global_sz, &local_sz, 0, NULL, NULL);
+  }
+  /* 8 passes, the result is back in the first buffers */
+  OCL_CALL(clEnqueueReadBuffer, queue, k[0], CL_TRUE, 0, n * sizeof(cl_uint), &sorted_keys[0], 0, NULL, NULL);
+  OCL_CALL(clEnqueueReadBuffer, queue, v[0], CL_TRUE, 0, n * sizeof(cl_uint), &sorted_values[0], 0, NULL, NULL);
+
+  for (cl_uint i = 0; i < n; ++i) {
+    OCL_ASSERT(sorted_keys[i] == keys[sorted_values[i]]);
+    if (i > 0) {
+      OCL_ASSERT(sorted_keys[i - 1] <= sorted_keys[i]);
+      /* Stable */
+      if (sorted_keys[i - 1] == sorted_keys[i])
+        OCL_ASSERT(sorted_values[i - 1] < sorted_values[i]);
+    }
+  }
+
+  for (int i = 0; i < 2; ++i) {
+    clReleaseMemObject(k[i]);
+    clReleaseMemObject(v[i]);
+  }
+  clReleaseMemObject(hist);
+  clReleaseKernel(hist_k);
+  clReleaseKernel(scatter_k);
+  clReleaseProgram(prog);
+}
+
+MAKE_UTEST_FROM_FUNCTION(builtin_kernel_radix_sort_intel);
+
+void builtin_kernel_transpose_intel(void)
+{
+  const cl_uint w = 100, h = 37;
+  std::vector<float> src(w * h), dst(w * h);
+  cl_program prog = builtin_primitives_program();
+  cl_int err = CL_SUCCESS;
+
+  for (cl_uint i = 0; i < w * h; ++i)
+    src[i] = (float)i;
+  cl_kernel transpose = clCreateKernel(prog, "transpose_float_intel", &err);
+  OCL_ASSERT(transpose != NULL);
+  cl_mem src_buf = clCreateBuffer(ctx, CL_MEM_COPY_HOST_PTR, w * h * sizeof(float), &src[0], &err);
+  cl_mem dst_buf = clCreateBuffer(ctx, 0, w * h * sizeof(float), NULL, &err);
+  OCL_ASSERT(src_buf && dst_buf);
+
+  /* The global size is rounded up to the tile the kernel runs with */
+  const size_t tile = builtin_group_size(transpose);
+  const size_t global_sz[2] = {(w + tile - 1) / tile * tile, (h + tile - 1) / tile * tile};
+  OCL_CALL(clSetKernelArg, transpose, 0, sizeof(cl_mem), &src_buf);
+  OCL_CALL(clSetKernelArg, transpose, 1, sizeof(cl_mem), &dst_buf);
+  OCL_CALL(clSetKernelArg, transpose, 2, sizeof(cl_uint), &w);
+  OCL_CALL(clSetKernelArg, transpose, 3, sizeof(cl_uint), &h);
+  OCL_CALL(clEnqueueNDRangeKernel, queue, transpose, 2, NULL, global_sz, NULL, 0, NULL, NULL);
+  OCL_CALL(clEnqueueReadBuffer, queue, dst_buf, CL_TRUE, 0, w * h * sizeof(float), &dst[0], 0, NULL, NULL);
+
+  for (cl_uint y = 0; y < h; ++y)
+    for (cl_uint x = 0; x < w; ++x)
+      OCL_ASSERT(dst[x * h + y] == src[y * w + x]);
+
+  clReleaseMemObject(src_buf);
+  clReleaseMemObject(dst_buf);
+  clReleaseKernel(transpose);
+  clReleaseProgram(prog);
+}
+
+MAKE_UTEST_FROM_FUNCTION(builtin_kernel_transpose_intel);
@@ -0,0 +1,42 @@
+#include "utest_helper.hpp"
+#include <string.h>
+
+static void run_and_check(cl_kernel k, size_t n)
+{
+  OCL_CALL(clEnqueueNDRangeKernel, queue, k, 1, NULL, globals, locals, 0, NULL, NULL);
+  OCL_MAP_BUFFER(0);
+  int32_t *dst = (int32_t*)buf_data[0];
+  for (uint32_t i = 0; i < n; i += locals[0])
+    for (uint32_t j = 0; j < locals[0]; ++j)
+      OCL_ASSERT(dst[i + j] == (int32_t)(i + locals[0] - 1 - j));
+  memset(dst, 0, n * sizeof(int32_t));
+  OCL_UNMAP_BUFFER(0);
+}
+
+static void compiler_barrier_no_slm(void)
+{
+  const size_t n = 16*1024;
+  cl_int err;
+
+  // Setup kernels and buffers
+  OCL_CREATE_KERNEL("compiler_barrier_no_slm");
+  cl_kernel local_kernel = clCreateKernel(program, "compiler_barrier_no_slm_local", &err);
+  OCL_ASSERT(err == CL_SUCCESS);
+  OCL_CREATE_BUFFER(buf[0], 0, n * sizeof(int32_t), NULL);
+  OCL_CREATE_BUFFER(buf[1], 0, n * sizeof(int32_t), NULL);
+  OCL_SET_ARG(0, sizeof(cl_mem), &buf[0]);
+  OCL_SET_ARG(1, sizeof(cl_mem), &buf[1]);
+  OCL_CALL(clSetKernelArg, local_kernel, 0, sizeof(cl_mem), &buf[0]);
+
+  // The barrier only kernel runs without SLM, before and after a kernel
+  // using it
+  globals[0] = n;
+  locals[0] = 256;
+  run_and_check(kernel, n);
+  run_and_check(local_kernel, n);
+  run_and_check(kernel, n);
+
+  clReleaseKernel(local_kernel);
+}
+
+MAKE_UTEST_FROM_FUNCTION(compiler_barrier_no_slm);
@@ -0,0 +1,65 @@
+#include <string.h>
+#include "utest_helper.hpp"
+
+static const char *build_cache_source =
+  "__kernel __attribute__((reqd_work_group_size(16, 1, 1)))\n"
+  "void compiler_build_cache(__global int *dst, int x)\n"
+  "{\n"
+  "  int id = get_global_id(0);\n"
+  "  dst[id] = id * x;\n"
+  "}\n";
+
+static cl_kernel build_cache_kernel(cl_program *prog)
+{
+  cl_int err;
+  *prog = clCreateProgramWithSource(ctx, 1, &build_cache_source, NULL, &err);
+  OCL_ASSERT(err == CL_SUCCESS);
+  OCL_CALL(clBuildProgram, *prog, 1, &device, NULL, NULL, NULL);
+  cl_kernel k = clCreateKernel(*prog, "compiler_build_cache", &err);
+  OCL_ASSERT(err == CL_SUCCESS);
+  return k;
+}
+
+static void build_cache_run(cl_kernel k, int x)
+{
+  const size_t n = 64, local_sz = 16;
+  cl_int err;
+  cl_mem dst = clCreateBuffer(ctx, 0, n * sizeof(int), NULL, &err);
+  OCL_ASSERT(err == CL_SUCCESS);
+  OCL_CALL(clSetKernelArg, k, 0, sizeof(cl_mem), &dst);
+  OCL_CALL(clSetKernelArg, k, 1, sizeof(int), &x);
+  OCL_CALL(clEnqueueNDRangeKernel, queue, k, 1, NULL, &n, &local_sz, 0, NULL, NULL);
+  int *p = (int *)clEnqueueMapBuffer(queue, dst, CL_TRUE, CL_MAP_READ, 0, n * sizeof(int),
+                                     0, NULL, NULL, &err);
+  OCL_ASSERT(err == CL_SUCCESS);
+  for (size_t i = 0; i < n; ++i)
+    OCL_ASSERT(p[i] == (int)i * x);
+  OCL_CALL(clEnqueueUnmapMemObject, queue, dst, p, 0, NULL, NULL);
+  clReleaseMemObject(dst);
+}
+
+/* The second program is built from the same source and may come from the
+ * build cache and share the code of the first one. It must keep the kernel
+ * attributes and outlive the first program */
+void compiler_build_cache(void)
+{
+  cl_program prog[2];
+  cl_kernel k[2];
+  char attrs[2][256];
+
+  for (int i = 0; i < 2; ++i) {
+    k[i] = build_cache_kernel(&prog[i]);
+    OCL_CALL(clGetKernelInfo, k[i], CL_KERNEL_ATTRIBUTES, sizeof(attrs[i]), attrs[i], NULL);
+  }
+  OCL_ASSERT(strstr(attrs[0], "reqd_work_group_size") != NULL);
+  OCL_ASSERT(strcmp(attrs[0], attrs[1]) == 0);
+
+  build_cache_run(k[0], 3);
+  clReleaseKernel(k[0]);
+  clReleaseProgram(prog[0]);
+  build_cache_run(k[1], 5);
+  clReleaseKernel(k[1]);
+  clReleaseProgram(prog[1]);
+}
+
+MAKE_UTEST_FROM_FUNCTION(compiler_build_cache);
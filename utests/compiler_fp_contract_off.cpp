@@ -0,0 +1,35 @@
+#include "utest_helper.hpp"
+
+/* Without FP_CONTRACT the product must be rounded before the add, a MAD
+ * would give a different result for most of the inputs */
+void compiler_fp_contract_off(void)
+{
+  const size_t n = 64;
+  float cpu_src[3][64];
+
+  OCL_CREATE_KERNEL("compiler_fp_contract_off");
+  for (int i = 0; i < 4; ++i) {
+    OCL_CREATE_BUFFER(buf[i], 0, n * sizeof(float), NULL);
+    OCL_SET_ARG(i, sizeof(cl_mem), &buf[i]);
+  }
+  globals[0] = n;
+  locals[0] = 16;
+
+  for (int i = 0; i < 3; ++i) {
+    OCL_MAP_BUFFER(i);
+    for (size_t j = 0; j < n; ++j)
+      cpu_src[i][j] = ((float*)buf_data[i])[j] = 1.f + (float)rand() / (float)RAND_MAX;
+    OCL_UNMAP_BUFFER(i);
+  }
+  OCL_NDRANGE(1);
+
+  OCL_MAP_BUFFER(3);
+  for (size_t j = 0; j < n; ++j) {
+    volatile float m = cpu_src[0][j] * cpu_src[1][j];
+    const float expected = m + cpu_src[2][j];
+    OCL_ASSERT(((float*)buf_data[3])[j] == expected);
+  }
+  OCL_UNMAP_BUFFER(3);
+}
+
+MAKE_UTEST_FROM_FUNCTION(compiler_fp_contract_off);
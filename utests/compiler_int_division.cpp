@@ -0,0 +1,69 @@
+#include "utest_helper.hpp"
+
+/* Divisions by constants and by uniform kernel arguments are strength
+ * reduced by the compiler, compare them with the CPU */
+void compiler_int_division(void)
+{
+  const size_t n = 256;
+  const cl_uint ud = 12345;
+  const cl_int id = -37;
+  cl_uint cpu_u[256];
+  cl_int cpu_i[256];
+  cl_ulong cpu_l[256];
+
+  OCL_CREATE_KERNEL("compiler_int_division");
+  OCL_CREATE_BUFFER(buf[0], 0, n * sizeof(cl_uint), NULL);
+  OCL_CREATE_BUFFER(buf[1], 0, n * sizeof(cl_int), NULL);
+  OCL_CREATE_BUFFER(buf[2], 0, n * sizeof(cl_ulong), NULL);
+  OCL_CREATE_BUFFER(buf[3], 0, 6 * n * sizeof(cl_uint), NULL);
+  OCL_CREATE_BUFFER(buf[4], 0, 6 * n * sizeof(cl_int), NULL);
+  OCL_CREATE_BUFFER(buf[5], 0, 2 * n * sizeof(cl_ulong), NULL);
+  for (int i = 0; i < 6; ++i)
+    OCL_SET_ARG(i, sizeof(cl_mem), &buf[i]);
+  OCL_SET_ARG(6, sizeof(cl_uint), &ud);
+  OCL_SET_ARG(7, sizeof(cl_int), &id);
+  globals[0] = n;
+  locals[0] = 16;
+
+  OCL_MAP_BUFFER(0);
+  OCL_MAP_BUFFER(1);
+  OCL_MAP_BUFFER(2);
+  for (size_t i = 0; i < n; ++i) {
+    cpu_u[i] = ((cl_uint*)buf_data[0])[i] = i < 4 ? 0xffffffffu - i : ((cl_uint)rand() << 16) ^ rand();
+    cpu_i[i] = ((cl_int*)buf_data[1])[i] = i < 4 ? (cl_int)(0x80000000u + i) : ((cl_int)rand() << 16) ^ rand();
+    cpu_l[i] = ((cl_ulong*)buf_data[2])[i] = i < 4 ? ~(cl_ulong)i :
+               ((cl_ulong)rand() << 48) ^ ((cl_ulong)rand() << 24) ^ rand();
+  }
+  OCL_UNMAP_BUFFER(0);
+  OCL_UNMAP_BUFFER(1);
+  OCL_UNMAP_BUFFER(2);
+  OCL_NDRANGE(1);
+
+  OCL_MAP_BUFFER(3);
+  OCL_MAP_BUFFER(4);
+  OCL_MAP_BUFFER(5);
+  for (size_t i = 0; i < n; ++i) {
+    const cl_uint *u = (cl_uint*)buf_data[3] + 6 * i;
+    const cl_int *s = (cl_int*)buf_data[4] + 6 * i;
+    const cl_ulong *l = (cl_ulong*)buf_data[5] + 2 * i;
+    OCL_ASSERT(u[0] == cpu_u[i] / 7);
+    OCL_ASSERT(u[1] == cpu_u[i] % 10);
+    OCL_ASSERT(u[2] == cpu_u[i] / ud);
+    OCL_ASSERT(u[3] == cpu_u[i] % ud);
+    OCL_ASSERT(u[4] == cpu_u[i] / 0x80000001u);
+    OCL_ASSERT(u[5] == cpu_u[i] / (ud * 3));
+    OCL_ASSERT(s[0] == cpu_i[i] / 7);
+    OCL_ASSERT(s[1] == cpu_i[i] % -10);
+    OCL_ASSERT(s[2] == cpu_i[i] / 16);
+    OCL_ASSERT(s[3] == cpu_i[i] / id);
+    OCL_ASSERT(s[4] == cpu_i[i] % id);
+    OCL_ASSERT(s[5] == cpu_i[i] / -8);
+    OCL_ASSERT(l[0] == cpu_l[i] / 1000003);
+    OCL_ASSERT(l[1] == cpu_l[i] % 12345678901ul);
+  }
+  OCL_UNMAP_BUFFER(3);
+  OCL_UNMAP_BUFFER(4);
+  OCL_UNMAP_BUFFER(5);
+}
+
+MAKE_UTEST_FROM_FUNCTION(compiler_int_division);
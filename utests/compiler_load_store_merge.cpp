@@ -0,0 +1,49 @@
+#include "utest_helper.hpp"
+#include <string.h>
+
+void compiler_load_store_merge(void)
+{
+  const size_t n = 64;
+  int cpu_src[4 * 64];
+
+  OCL_CREATE_KERNEL("compiler_load_store_merge");
+  OCL_CREATE_BUFFER(buf[0], 0, 4 * n * sizeof(int), NULL);
+  OCL_CREATE_BUFFER(buf[1], 0, 4 * n * sizeof(int), NULL);
+  OCL_CREATE_BUFFER(buf[2], 0, n * sizeof(float), NULL);
+  OCL_SET_ARG(0, sizeof(cl_mem), &buf[0]);
+  OCL_SET_ARG(1, sizeof(cl_mem), &buf[1]);
+  OCL_SET_ARG(2, sizeof(cl_mem), &buf[2]);
+  OCL_SET_ARG(3, 16 * 2 * sizeof(int), NULL);
+  globals[0] = n;
+  locals[0] = 16;
+
+  OCL_MAP_BUFFER(0);
+  for (size_t i = 0; i < n; ++i) {
+    ((int*)buf_data[0])[4 * i] = cpu_src[4 * i] = rand() & 0xffff;
+    ((float*)buf_data[0])[4 * i + 1] = (float)(rand() & 0xff);
+    cpu_src[4 * i + 1] = ((int*)buf_data[0])[4 * i + 1];
+    ((int*)buf_data[0])[4 * i + 2] = cpu_src[4 * i + 2] = rand() & 0xff;
+    ((int*)buf_data[0])[4 * i + 3] = cpu_src[4 * i + 3] = rand() & 0xff;
+  }
+  OCL_UNMAP_BUFFER(0);
+  OCL_NDRANGE(1);
+
+  OCL_MAP_BUFFER(1);
+  OCL_MAP_BUFFER(2);
+  for (size_t i = 0; i < n; ++i) {
+    const int a = cpu_src[4 * i];
+    const int c = (a & 1) ? a * 3 : a + 5;
+    const int d = cpu_src[4 * i + 2], e = cpu_src[4 * i + 3];
+    float b;
+    memcpy(&b, &cpu_src[4 * i + 1], sizeof(b));
+    OCL_ASSERT(((int*)buf_data[1])[4 * i] == a + c);
+    OCL_ASSERT(((float*)buf_data[1])[4 * i + 1] == b * 2.0f);
+    OCL_ASSERT(((int*)buf_data[1])[4 * i + 2] == d - e);
+    OCL_ASSERT(((int*)buf_data[1])[4 * i + 3] == c);
+    OCL_ASSERT(((float*)buf_data[2])[i] == (d > e ? 2.0f : 1.0f));
+  }
+  OCL_UNMAP_BUFFER(1);
+  OCL_UNMAP_BUFFER(2);
+}
+
+MAKE_UTEST_FROM_FUNCTION(compiler_load_store_merge);
@@ -0,0 +1,47 @@
+#include "utest_helper.hpp"
+
+void compiler_loop_pipelining(void)
+{
+  const int n = 37;
+  const size_t w = 64;
+
+  // Setup kernel and buffers
+  OCL_CREATE_KERNEL("compiler_loop_pipelining");
+  OCL_CREATE_BUFFER(buf[0], 0, w * sizeof(int32_t), NULL);
+  OCL_CREATE_BUFFER(buf[1], 0, w * n * sizeof(int32_t), NULL);
+  OCL_CREATE_BUFFER(buf[2], 0, n * sizeof(int32_t), NULL);
+  OCL_SET_ARG(0, sizeof(cl_mem), &buf[0]);
+  OCL_SET_ARG(1, sizeof(cl_mem), &buf[1]);
+  OCL_SET_ARG(2, sizeof(cl_mem), &buf[2]);
+  OCL_SET_ARG(3, sizeof(int), &n);
+
+  OCL_MAP_BUFFER(1);
+  for (uint32_t i = 0; i < w * n; ++i)
+    ((int32_t*)buf_data[1])[i] = (i * 7) % 13 - 6;
+  OCL_UNMAP_BUFFER(1);
+  OCL_MAP_BUFFER(2);
+  for (int i = 0; i < n; ++i)
+    ((int32_t*)buf_data[2])[i] = i - 10;
+  OCL_UNMAP_BUFFER(2);
+
+  globals[0] = w;
+  locals[0] = 16;
+  OCL_NDRANGE(1);
+
+  // The loads of the last iteration are issued one iteration ahead and read
+  // past the end of the buffers, the result must not change
+  OCL_MAP_BUFFER(0);
+  OCL_MAP_BUFFER(1);
+  OCL_MAP_BUFFER(2);
+  for (uint32_t id = 0; id < w; ++id) {
+    int32_t sum = 0;
+    for (int i = 0; i < n; ++i)
+      sum += ((int32_t*)buf_data[1])[id * n + i] * ((int32_t*)buf_data[2])[i];
+    OCL_ASSERT(((int32_t*)buf_data[0])[id] == sum);
+  }
+  OCL_UNMAP_BUFFER(2);
+  OCL_UNMAP_BUFFER(1);
+  OCL_UNMAP_BUFFER(0);
+}
+
+MAKE_UTEST_FROM_FUNCTION(compiler_loop_pipelining);
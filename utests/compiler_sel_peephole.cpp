@@ -0,0 +1,42 @@
+#include "utest_helper.hpp"
+#include <cmath>
+
+/* Source modifiers, clamps and selects the peephole pass of the instruction
+ * selection rewrites, the results must not change */
+void compiler_sel_peephole(void)
+{
+  const size_t n = 64;
+  float cpu_src[2][64];
+
+  OCL_CREATE_KERNEL("compiler_sel_peephole");
+  OCL_CREATE_BUFFER(buf[0], 0, n * sizeof(float), NULL);
+  OCL_CREATE_BUFFER(buf[1], 0, n * sizeof(float), NULL);
+  OCL_CREATE_BUFFER(buf[2], 0, n * 4 * sizeof(float), NULL);
+  OCL_SET_ARG(0, sizeof(cl_mem), &buf[0]);
+  OCL_SET_ARG(1, sizeof(cl_mem), &buf[1]);
+  OCL_SET_ARG(2, sizeof(cl_mem), &buf[2]);
+  globals[0] = n;
+  locals[0] = 16;
+
+  for (int i = 0; i < 2; ++i) {
+    OCL_MAP_BUFFER(i);
+    for (size_t j = 0; j < n; ++j)
+      cpu_src[i][j] = ((float*)buf_data[i])[j] = 2.f * (float)rand() / (float)RAND_MAX - 1.f;
+    OCL_UNMAP_BUFFER(i);
+  }
+  OCL_NDRANGE(1);
+
+  OCL_MAP_BUFFER(2);
+  for (size_t j = 0; j < n; ++j) {
+    const float a = cpu_src[0][j], b = cpu_src[1][j];
+    const float *r = (float*)buf_data[2] + 4 * j;
+    float w = -fabsf(a) + b;
+    OCL_ASSERT(r[0] == fminf(fmaxf(a + b, 0.f), 1.f));
+    OCL_ASSERT(r[1] == fabsf(a) * -b);
+    OCL_ASSERT(r[2] == (a > b ? a - b : a * b));
+    OCL_ASSERT(r[3] == (a > b ? -w : w));
+  }
+  OCL_UNMAP_BUFFER(2);
+}
+
+MAKE_UTEST_FROM_FUNCTION(compiler_sel_peephole);
@@ -0,0 +1,57 @@
+#include <cstring>
+#include "utest_helper.hpp"
+
+/* The aligned half loads and stores move the whole vector at once, the 3
+ * components variants must leave the padding element alone */
+static void compiler_vloada_half_run(const char *name, int dim, float add, float mul)
+{
+  const size_t n = 16;
+  const int slot = dim == 3 ? 4 : dim;
+  uint16_t src[n * 4], dst[n * 4];
+
+  OCL_CREATE_KERNEL_FROM_FILE("compiler_vloada_half", name);
+  OCL_CREATE_BUFFER(buf[0], 0, n * slot * sizeof(uint16_t), NULL);
+  OCL_CREATE_BUFFER(buf[1], 0, n * slot * sizeof(uint16_t), NULL);
+  OCL_SET_ARG(0, sizeof(cl_mem), &buf[0]);
+  OCL_SET_ARG(1, sizeof(cl_mem), &buf[1]);
+  globals[0] = n;
+  locals[0] = 16;
+
+  /* Quarters between -8 and 8 stay exact in half */
+  for (uint32_t i = 0; i < n * slot; ++i)
+    src[i] = __float_to_half(as_uint(i * 0.25f - 8.0f));
+
+  OCL_MAP_BUFFER(0);
+  OCL_MAP_BUFFER(1);
+  memcpy(buf_data[0], src, n * slot * sizeof(uint16_t));
+  memset(buf_data[1], 0xff, n * slot * sizeof(uint16_t));
+  OCL_UNMAP_BUFFER(0);
+  OCL_UNMAP_BUFFER(1);
+
+  OCL_NDRANGE(1);
+
+  OCL_MAP_BUFFER(1);
+  memcpy(dst, buf_data[1], n * slot * sizeof(uint16_t));
+  OCL_UNMAP_BUFFER(1);
+  for (uint32_t i = 0; i < n * slot; ++i) {
+    if ((int)(i % slot) >= dim) {
+      OCL_ASSERT(dst[i] == 0xffff);
+      continue;
+    }
+    const float expected = (i * 0.25f - 8.0f + add) * mul;
+    OCL_ASSERT(as_float(__half_to_float(dst[i])) == expected);
+  }
+}
+
+void compiler_vloada_half4(void)
+{
+  compiler_vloada_half_run("compiler_vloada_half4", 4, 0.0f, 2.0f);
+}
+
+void compiler_vloada_half3(void)
+{
+  compiler_vloada_half_run("compiler_vloada_half3", 3, 1.0f, 1.0f);
+}
+
+MAKE_UTEST_FROM_FUNCTION(compiler_vloada_half4);
+MAKE_UTEST_FROM_FUNCTION(compiler_vloada_half3);
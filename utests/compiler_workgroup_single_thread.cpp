@@ -0,0 +1,50 @@
+#include "utest_helper.hpp"
+
+/* Barriers, SLM exchanges and work group functions of work groups small
+ * enough to run as one thread */
+void compiler_workgroup_single_thread(void)
+{
+  if (!cl_check_ocl20())
+    return;
+  const int group_num = 16;
+  const int n = group_num * 8;
+  int cpu_src[n];
+  const int bias = 42;
+
+  OCL_CREATE_KERNEL("compiler_workgroup_single_thread");
+  OCL_CREATE_BUFFER(buf[0], 0, n * sizeof(int), NULL);
+  OCL_CREATE_BUFFER(buf[1], 0, n * 5 * sizeof(int), NULL);
+  OCL_SET_ARG(0, sizeof(cl_mem), &buf[0]);
+  OCL_SET_ARG(1, sizeof(cl_mem), &buf[1]);
+  OCL_SET_ARG(2, sizeof(int), &bias);
+  globals[0] = group_num * 4;
+  globals[1] = 2;
+  locals[0] = 4;
+  locals[1] = 2;
+
+  OCL_MAP_BUFFER(0);
+  for (int i = 0; i < n; ++i)
+    cpu_src[i] = ((int*)buf_data[0])[i] = rand() % 1000 - 500;
+  OCL_UNMAP_BUFFER(0);
+  OCL_NDRANGE(2);
+
+  OCL_MAP_BUFFER(1);
+  for (int group = 0; group < group_num; ++group) {
+    const int *src = cpu_src + group * 8;
+    int sum = 0, prefix = 0;
+    for (int lid = 0; lid < 8; ++lid)
+      sum += src[lid];
+    for (int lid = 0; lid < 8; ++lid) {
+      const int *r = (int*)buf_data[1] + (group * 8 + lid) * 5;
+      OCL_ASSERT(r[0] == src[7 - ((lid + 1) & 7)]);
+      OCL_ASSERT(r[1] == sum);
+      OCL_ASSERT(r[2] == prefix);
+      OCL_ASSERT(r[3] == src[7]);
+      OCL_ASSERT(r[4] == bias);
+      prefix += src[lid];
+    }
+  }
+  OCL_UNMAP_BUFFER(1);
+}
+
+MAKE_UTEST_FROM_FUNCTION(compiler_workgroup_single_thread);
@@ -0,0 +1,39 @@
+#include "utest_helper.hpp"
+#include <string.h>
+
+/* Writes above OCL_STREAM_WRITE_MIN (16MB by default) go through the staging
+ * buffers, check a few sizes and offsets around the chunk size */
+static void test_write_buf(size_t offset, size_t sz, const uint8_t *src)
+{
+  uint8_t *dst = (uint8_t *)malloc(sz);
+  OCL_ASSERT(dst != NULL);
+
+  OCL_CALL(clEnqueueWriteBuffer, queue, buf[0], CL_TRUE, offset, sz, src, 0, NULL, NULL);
+  OCL_CALL(clEnqueueReadBuffer, queue, buf[0], CL_TRUE, offset, sz, dst, 0, NULL, NULL);
+  OCL_ASSERT(memcmp(src, dst, sz) == 0);
+  free(dst);
+}
+
+void enqueue_write_buf_large(void)
+{
+  const size_t sz = 40 * 1024 * 1024 + 3;
+  uint8_t *src = (uint8_t *)malloc(sz);
+  OCL_ASSERT(src != NULL);
+  for (size_t i = 0; i < sz; ++i)
+    src[i] = (uint8_t)(i * 7 + (i >> 12));
+
+  OCL_CREATE_BUFFER(buf[0], 0, sz + 64, NULL);
+  test_write_buf(0, sz, src);
+  test_write_buf(64, sz - 61, src + 5);
+  test_write_buf(16, 16 * 1024 * 1024, src + 16);
+
+  /* Non blocking, the host buffer stays valid until the queue is finished */
+  OCL_CALL(clEnqueueWriteBuffer, queue, buf[0], CL_FALSE, 0, sz, src, 0, NULL, NULL);
+  OCL_FINISH();
+  OCL_MAP_BUFFER(0);
+  OCL_ASSERT(memcmp(buf_data[0], src, sz) == 0);
+  OCL_UNMAP_BUFFER(0);
+  free(src);
+}
+
+MAKE_UTEST_FROM_FUNCTION(enqueue_write_buf_large);
@@ -0,0 +1,157 @@
+#!/usr/bin/python
+#
+# Static kernel resource regression check.
+#
+# Compile every utest kernel with gbe_bin_generater for each target device
+# and compare the static metrics of the generated code (instruction count,
+# send count, spill/fill count, scratch size, register usage, flag spills,
+# flag/GRF boolean moves and SIMD width)
+# against a checked-in baseline. No GPU is needed.
+#
+# usage: kernel_stats_check.py [options] -- <gbe_bin_generater command>
+#
+import os, sys, subprocess, argparse
+
+# Metrics where a higher value is a regression
+COST_METRICS = ['insn', 'send', 'spill', 'fill', 'scratch', 'grf', 'fspill', 'ffix']
+
+# One device per supported gen (IVB, HSW, BDW, SKL, BXT)
+DEFAULT_DEVICES = ['0x0162', '0x0412', '0x1616', '0x1912', '0x5a84']
+
+def parse_stats_line(line):
+  fields = line.split()
+  if len(fields) < 2 or ':' not in fields[0]:
+    return None, None
+  metrics = {}
+  for field in fields[1:]:
+    name, eq, value = field.partition('=')
+    if not eq:
+      return None, None
+    metrics[name] = int(value)
+  return fields[0], metrics
+
+def collect(generator, kernel_dir, devices, verbose):
+  stats = {}
+  failed = set()
+  kernels = sorted(f for f in os.listdir(kernel_dir) if f.endswith('.cl'))
+  for device in devices:
+    for kernel in kernels:
+      cmd = generator + ['-t' + device, '-m', kernel]
+      proc = subprocess.Popen(cmd, cwd=kernel_dir, stdout=subprocess.PIPE,
+                              stderr=subprocess.STDOUT)
+      out = proc.communicate()[0].decode('utf-8', 'replace')
+      if proc.returncode != 0:
+        sys.stdout.write('%s %s: build failed\n' % (device, kernel))
+        if verbose:
+          sys.stdout.write(out)
+        failed.add((device, kernel))
+        continue
+      for line in out.splitlines():
+        name, metrics = parse_stats_line(line)
+        if name:
+          stats[(device, name)] = metrics
+  return stats, failed
+
+# Files which are known not to build for a device are listed as
+# "<device> <file> build_failed"
+def load_baseline(path):
+  baseline = {}
+  failed = set()
+  if not os.path.exists(path):
+    return baseline, failed
+  for line in open(path):
+    line = line.strip()
+    if not line or line.startswith('#'):
+      continue
+    device, rest = line.split(None, 1)
+    if rest.endswith(' build_failed'):
+      failed.add((device, rest.split()[0]))
+      continue
+    name, metrics = parse_stats_line(rest)
+    if name:
+      baseline[(device, name)] = metrics
+  return baseline, failed
+
+def write_baseline(path, stats, failed):
+  out = open(path, 'w')
+  out.write('# Static kernel resource baseline, see kernel_stats_check.py.\n')
+  out.write('# Regenerate with "make utest_kernel_stats_update".\n')
+  for key in sorted(stats):
+    metrics = stats[key]
+    out.write('%s %s simd=%d %s\n' % (key[0], key[1], metrics['simd'],
+              ' '.join('%s=%d' % (m, metrics[m]) for m in COST_METRICS)))
+  for key in sorted(failed):
+    out.write('%s %s build_failed\n' % key)
+  out.close()
+
+def is_regression(old, new, threshold, slack):
+  if new <= old:
+    return False
+  return new - old > slack and new > old * (1.0 + threshold / 100.0)
+
+def compare(baseline, known_failed, stats, failed, devices, threshold, slack):
+  failures = []
+  # A device is only checked once its baseline is committed, it is reported
+  # so that an empty baseline does not pass silently
+  skipped = set()
+  for device in devices:
+    if not any(key[0] == device for key in baseline):
+      sys.stdout.write('SKIP %s: no baseline for this device, run '
+                       '"make utest_kernel_stats_update"\n' % device)
+      skipped.add(device)
+  for key in sorted(failed):
+    if key[0] not in skipped and key not in known_failed:
+      failures.append('%s %s: build failed' % key)
+  for key in sorted(baseline):
+    old = baseline[key]
+    if key not in stats:
+      failures.append('%s %s: kernel does not build any more' % key)
+      continue
+    new = stats[key]
+    if new['simd'] < old['simd']:
+      failures.append('%s %s: simd %d -> %d' % (key[0], key[1], old['simd'], new['simd']))
+    for m in COST_METRICS:
+      if m in old and is_regression(old[m], new[m], threshold, slack):
+        failures.append('%s %s: %s %d -> %d' % (key[0], key[1], m, old[m], new[m]))
+  for key in sorted(stats):
+    if key[0] not in skipped and key not in baseline:
+      sys.stdout.write('new kernel %s %s is not in the baseline\n' % key)
+  return failures
+
+def main():
+  parser = argparse.ArgumentParser(description='static kernel resource regression check')
+  parser.add_argument('--kernels', required=True, help='directory of the .cl kernels')
+  parser.add_argument('--baseline', required=True, help='baseline metric file')
+  parser.add_argument('--devices', default=','.join(DEFAULT_DEVICES),
+                      help='comma separated list of PCI IDs to compile for')
+  parser.add_argument('--threshold', type=float, default=5.0,
+                      help='allowed relative increase of a metric, in percent')
+  parser.add_argument('--slack', type=int, default=2,
+                      help='allowed absolute increase of a metric')
+  parser.add_argument('--update', action='store_true', help='rewrite the baseline')
+  parser.add_argument('--verbose', action='store_true')
+  parser.add_argument('generator', nargs=argparse.REMAINDER)
+  args = parser.parse_args()
+
+  generator = [g for g in args.generator if g != '--']
+  if not generator:
+    parser.error('missing gbe_bin_generater command')
+
+  devices = args.devices.split(',')
+  stats, failed = collect(generator, args.kernels, devices, args.verbose)
+  if args.update:
+    write_baseline(args.baseline, stats, failed)
+    sys.stdout.write('%d kernels written to %s\n' % (len(stats), args.baseline))
+    return 0
+
+  baseline, known_failed = load_baseline(args.baseline)
+  failures = compare(baseline, known_failed, stats, failed, devices,
+                     args.threshold, args.slack)
+  for failure in failures:
+    sys.stdout.write('REGRESSION %s\n' % failure)
+  checked = [key for key in stats if any(b[0] == key[0] for b in baseline)]
+  sys.stdout.write('%d kernels checked, %d regressions\n' % (len(checked), len(failures)))
+  return 1 if failures else 0
+
+if __name__ == '__main__':
+  sys.exit(main())
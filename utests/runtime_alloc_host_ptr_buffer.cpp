@@ -23,3 +23,47 @@ static void runtime_alloc_host_ptr_buffer(void)
 }
 
 MAKE_UTEST_FROM_FUNCTION(runtime_alloc_host_ptr_buffer);
+
+static void runtime_alloc_host_ptr_buffer_huge_pages(void)
+{
+  const size_t n = 4 * 1024 * 1024;
+  cl_int err = CL_SUCCESS;
+  const cl_context_properties props[] = {
+    CL_CONTEXT_PLATFORM, (cl_context_properties)platform,
+    CL_CONTEXT_HOST_ALLOC_PAGES_INTEL, CL_HOST_ALLOC_PAGES_TRANSPARENT_HUGE_INTEL,
+    CL_CONTEXT_HOST_ALLOC_NUMA_NODE_INTEL, 0,
+    0
+  };
+  const cl_context_properties bad_props[] = {
+    CL_CONTEXT_PLATFORM, (cl_context_properties)platform,
+    CL_CONTEXT_HOST_ALLOC_PAGES_INTEL, 3,
+    0
+  };
+
+  OCL_ASSERT(clCreateContext(bad_props, 1, &device, NULL, NULL, &err) == NULL);
+  OCL_ASSERT(err == CL_INVALID_PROPERTY);
+
+  cl_context huge_ctx = clCreateContext(props, 1, &device, NULL, NULL, &err);
+  OCL_ASSERT(err == CL_SUCCESS);
+  cl_command_queue huge_queue = clCreateCommandQueue(huge_ctx, device, 0, &err);
+  OCL_ASSERT(err == CL_SUCCESS);
+
+  uint32_t *src = (uint32_t *)malloc(n * sizeof(uint32_t));
+  uint32_t *dst = (uint32_t *)malloc(n * sizeof(uint32_t));
+  for (uint32_t i = 0; i < n; ++i)
+    src[i] = i;
+  cl_mem mem = clCreateBuffer(huge_ctx, CL_MEM_ALLOC_HOST_PTR | CL_MEM_COPY_HOST_PTR,
+                              n * sizeof(uint32_t), src, &err);
+  OCL_ASSERT(err == CL_SUCCESS);
+  OCL_CALL(clEnqueueReadBuffer, huge_queue, mem, CL_TRUE, 0, n * sizeof(uint32_t), dst, 0, NULL, NULL);
+  for (uint32_t i = 0; i < n; ++i)
+    OCL_ASSERT(dst[i] == i);
+
+  free(src);
+  free(dst);
+  clReleaseMemObject(mem);
+  clReleaseCommandQueue(huge_queue);
+  clReleaseContext(huge_ctx);
+}
+
+MAKE_UTEST_FROM_FUNCTION(runtime_alloc_host_ptr_buffer_huge_pages);
@@ -0,0 +1,112 @@
+#include "utest_helper.hpp"
+
+void runtime_kernel_fusion(void)
+{
+  const size_t n = 1024;
+  const float scale = 3.f, offset = 2.f;
+  cl_int err = CL_SUCCESS;
+  clCreateFusedKernelIntel_fn createFused;
+
+  createFused = (clCreateFusedKernelIntel_fn)clGetExtensionFunctionAddressForPlatform(platform, "clCreateFusedKernelIntel");
+  OCL_ASSERT(createFused != NULL);
+
+  OCL_CREATE_KERNEL_FROM_FILE("runtime_kernel_fusion", "runtime_kernel_fusion_scale");
+  cl_kernel offset_kernel = clCreateKernel(program, "runtime_kernel_fusion_offset", &err);
+  OCL_ASSERT(err == CL_SUCCESS);
+
+  OCL_CREATE_BUFFER(buf[0], 0, n * sizeof(float), NULL);
+  OCL_CREATE_BUFFER(buf[1], 0, n * sizeof(float), NULL);
+  OCL_CREATE_BUFFER(buf[2], 0, n * sizeof(float), NULL);
+  OCL_MAP_BUFFER(0);
+  for (uint32_t i = 0; i < n; ++i)
+    ((float*)buf_data[0])[i] = (float)i;
+  OCL_UNMAP_BUFFER(0);
+
+  // buf[0] -> scale -> buf[1] -> offset -> buf[2], buf[1] becomes one argument
+  OCL_SET_ARG(0, sizeof(cl_mem), &buf[0]);
+  OCL_SET_ARG(1, sizeof(cl_mem), &buf[1]);
+  OCL_SET_ARG(2, sizeof(float), &scale);
+  OCL_CALL(clSetKernelArg, offset_kernel, 0, sizeof(cl_mem), &buf[1]);
+  OCL_CALL(clSetKernelArg, offset_kernel, 1, sizeof(cl_mem), &buf[2]);
+  OCL_CALL(clSetKernelArg, offset_kernel, 2, sizeof(float), &offset);
+
+  cl_kernel kernels[2] = {kernel, offset_kernel};
+  OCL_ASSERT(createFused(ctx, 1, kernels, &err) == NULL && err == CL_INVALID_VALUE);
+  cl_kernel fused = createFused(ctx, 2, kernels, &err);
+  OCL_ASSERT(err == CL_SUCCESS && fused != NULL);
+  // Same sequence, the cached program is used
+  cl_kernel fused_again = createFused(ctx, 2, kernels, &err);
+  OCL_ASSERT(err == CL_SUCCESS && fused_again != NULL);
+
+  cl_uint arg_num = 0;
+  OCL_CALL(clGetKernelInfo, fused, CL_KERNEL_NUM_ARGS, sizeof(arg_num), &arg_num, NULL);
+  OCL_ASSERT(arg_num == 5);
+
+  globals[0] = n;
+  locals[0] = 16;
+  OCL_CALL(clEnqueueNDRangeKernel, queue, fused, 1, NULL, globals, locals, 0, NULL, NULL);
+  OCL_MAP_BUFFER(1);
+  OCL_MAP_BUFFER(2);
+  for (uint32_t i = 0; i < n; ++i) {
+    OCL_ASSERT(((float*)buf_data[1])[i] == i * scale);
+    OCL_ASSERT(((float*)buf_data[2])[i] == i * scale + offset);
+  }
+  OCL_UNMAP_BUFFER(1);
+  OCL_UNMAP_BUFFER(2);
+
+  clReleaseKernel(fused_again);
+  clReleaseKernel(fused);
+  clReleaseKernel(offset_kernel);
+}
+
+MAKE_UTEST_FROM_FUNCTION(runtime_kernel_fusion);
+
+/* The fused kernel outlives the context it was created in */
+void runtime_kernel_fusion_release_context_first(void)
+{
+  const char *source =
+    "__kernel void scale(__global float *dst, float s) { dst[get_global_id(0)] *= s; }\n"
+    "__kernel void offset(__global float *dst, float o) { dst[get_global_id(0)] += o; }\n";
+  const float scale = 3.f, offset = 2.f;
+  cl_int err = CL_SUCCESS;
+  clCreateFusedKernelIntel_fn createFused;
+
+  createFused = (clCreateFusedKernelIntel_fn)clGetExtensionFunctionAddressForPlatform(platform, "clCreateFusedKernelIntel");
+  OCL_ASSERT(createFused != NULL);
+
+  cl_context fusion_ctx = clCreateContext(NULL, 1, &device, NULL, NULL, &err);
+  OCL_ASSERT(err == CL_SUCCESS);
+  cl_program fusion_program = clCreateProgramWithSource(fusion_ctx, 1, &source, NULL, &err);
+  OCL_ASSERT(err == CL_SUCCESS);
+  OCL_CALL(clBuildProgram, fusion_program, 1, &device, NULL, NULL, NULL);
+  cl_kernel kernels[2];
+  kernels[0] = clCreateKernel(fusion_program, "scale", &err);
+  OCL_ASSERT(err == CL_SUCCESS);
+  kernels[1] = clCreateKernel(fusion_program, "offset", &err);
+  OCL_ASSERT(err == CL_SUCCESS);
+  cl_mem mem = clCreateBuffer(fusion_ctx, 0, 64 * sizeof(float), NULL, &err);
+  OCL_ASSERT(err == CL_SUCCESS);
+  OCL_CALL(clSetKernelArg, kernels[0], 0, sizeof(cl_mem), &mem);
+  OCL_CALL(clSetKernelArg, kernels[0], 1, sizeof(float), &scale);
+  OCL_CALL(clSetKernelArg, kernels[1], 0, sizeof(cl_mem), &mem);
+  OCL_CALL(clSetKernelArg, kernels[1], 1, sizeof(float), &offset);
+
+  cl_kernel fused = createFused(fusion_ctx, 2, kernels, &err);
+  OCL_ASSERT(err == CL_SUCCESS && fused != NULL);
+  clReleaseKernel(kernels[0]);
+  clReleaseKernel(kernels[1]);
+  clReleaseProgram(fusion_program);
+  clReleaseMemObject(mem);
+  clReleaseContext(fusion_ctx);
+
+  // The context is still alive through the fused kernel
+  cl_context kernel_ctx = NULL;
+  OCL_CALL(clGetKernelInfo, fused, CL_KERNEL_CONTEXT, sizeof(kernel_ctx), &kernel_ctx, NULL);
+  OCL_ASSERT(kernel_ctx == fusion_ctx);
+  cl_uint arg_num = 0;
+  OCL_CALL(clGetKernelInfo, fused, CL_KERNEL_NUM_ARGS, sizeof(arg_num), &arg_num, NULL);
+  OCL_ASSERT(arg_num == 3);
+  clReleaseKernel(fused);
+}
+
+MAKE_UTEST_FROM_FUNCTION(runtime_kernel_fusion_release_context_first);
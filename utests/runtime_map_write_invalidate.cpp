@@ -0,0 +1,48 @@
+#include "utest_helper.hpp"
+
+static void runtime_map_write_invalidate(void)
+{
+  const size_t n = 4096*16;
+  const size_t offset = 1000, size = 4096*4;
+  uint32_t *host, *result;
+  void *mapptr;
+
+  // Not page aligned, so the buffer is not aliased with a userptr bo
+  int ret = posix_memalign(&buf_data[0], 64, sizeof(uint32_t) * (n + 16));
+  OCL_ASSERT(ret == 0);
+  host = (uint32_t*)buf_data[0] + 16;
+  for (uint32_t i = 0; i < n; ++i) host[i] = i;
+  OCL_CREATE_BUFFER(buf[0], CL_MEM_USE_HOST_PTR, n * sizeof(uint32_t), host);
+
+  // Write through an invalidating map, the rest of the buffer is untouched
+  mapptr = clEnqueueMapBuffer(queue, buf[0], CL_TRUE, CL_MAP_WRITE_INVALIDATE_REGION,
+                              offset * sizeof(uint32_t), size * sizeof(uint32_t),
+                              0, NULL, NULL, NULL);
+  OCL_ASSERT(mapptr != NULL);
+  for (uint32_t i = 0; i < size; ++i)
+    ((uint32_t*)mapptr)[i] = 0xdead0000 + i;
+  OCL_ASSERT(clEnqueueUnmapMemObject(queue, buf[0], mapptr, 0, NULL, NULL) == CL_SUCCESS);
+
+  // A read only map does not write anything back
+  mapptr = clEnqueueMapBuffer(queue, buf[0], CL_TRUE, CL_MAP_READ, 0, n * sizeof(uint32_t),
+                              0, NULL, NULL, NULL);
+  OCL_ASSERT(mapptr != NULL);
+  OCL_ASSERT(clEnqueueUnmapMemObject(queue, buf[0], mapptr, 0, NULL, NULL) == CL_SUCCESS);
+
+  result = (uint32_t*)malloc(n * sizeof(uint32_t));
+  OCL_ASSERT(result != NULL);
+  OCL_ASSERT(clEnqueueReadBuffer(queue, buf[0], CL_TRUE, 0, n * sizeof(uint32_t),
+                                 result, 0, NULL, NULL) == CL_SUCCESS);
+  for (uint32_t i = 0; i < n; ++i) {
+    if (i >= offset && i < offset + size)
+      OCL_ASSERT(result[i] == 0xdead0000 + (i - offset));
+    else
+      OCL_ASSERT(result[i] == i);
+  }
+
+  free(result);
+  free(buf_data[0]);
+  buf_data[0] = NULL;
+}
+
+MAKE_UTEST_FROM_FUNCTION(runtime_map_write_invalidate);
@@ -1,3 +1,4 @@
+#include <cstring>
 #include "utest_helper.hpp"
 
 void runtime_set_kernel_arg(void)
@@ -28,3 +29,64 @@ void runtime_set_kernel_arg(void)
 }
 
 MAKE_UTEST_FROM_FUNCTION(runtime_set_kernel_arg);
+
+void runtime_set_kernel_args_intel(void)
+{
+  const size_t n = 16;
+  char args[sizeof(cl_mem) + sizeof(cl_float3)];
+  clSetKernelArgsIntel_fn setArgs;
+
+  cl_float3 src;
+  src.s[0] = 4; src.s[1] = 5; src.s[2] = 6;
+
+  setArgs = (clSetKernelArgsIntel_fn)clGetExtensionFunctionAddressForPlatform(platform, "clSetKernelArgsIntel");
+  OCL_ASSERT(setArgs != NULL);
+
+  OCL_CREATE_KERNEL("set_kernel_arg");
+  OCL_CREATE_BUFFER(buf[0], 0, n * sizeof(uint32_t), NULL);
+
+  // Arguments are packed in order, a wrong total size is rejected
+  memcpy(args, &buf[0], sizeof(cl_mem));
+  memcpy(args + sizeof(cl_mem), &src, sizeof(cl_float3));
+  OCL_ASSERT(setArgs(kernel, sizeof(args) - 1, args) == CL_INVALID_ARG_SIZE);
+  OCL_ASSERT(setArgs(kernel, sizeof(args), args) == CL_SUCCESS);
+
+  globals[0] = n;
+  locals[0] = 16;
+  OCL_NDRANGE(1);
+  OCL_MAP_BUFFER(0);
+  for (uint32_t i = 0; i < n; ++i)
+    OCL_ASSERT(((uint32_t*)buf_data[0])[i] == src.s[i%3]);
+  OCL_UNMAP_BUFFER(0);
+}
+
+MAKE_UTEST_FROM_FUNCTION(runtime_set_kernel_args_intel);
+
+void runtime_set_kernel_args_intel_packed(void)
+{
+  const size_t n = 16;
+  const char bias = 7;
+  char args[1 + sizeof(cl_mem)];
+  clSetKernelArgsIntel_fn setArgs;
+
+  setArgs = (clSetKernelArgsIntel_fn)clGetExtensionFunctionAddressForPlatform(platform, "clSetKernelArgsIntel");
+  OCL_ASSERT(setArgs != NULL);
+
+  OCL_CREATE_KERNEL_FROM_FILE("set_kernel_arg", "set_kernel_arg_packed");
+  OCL_CREATE_BUFFER(buf[0], 0, n * sizeof(uint32_t), NULL);
+
+  // No padding, the buffer handle is unaligned
+  args[0] = bias;
+  memcpy(args + 1, &buf[0], sizeof(cl_mem));
+  OCL_ASSERT(setArgs(kernel, sizeof(args), args) == CL_SUCCESS);
+
+  globals[0] = n;
+  locals[0] = 16;
+  OCL_NDRANGE(1);
+  OCL_MAP_BUFFER(0);
+  for (uint32_t i = 0; i < n; ++i)
+    OCL_ASSERT(((uint32_t*)buf_data[0])[i] == i + bias);
+  OCL_UNMAP_BUFFER(0);
+}
+
+MAKE_UTEST_FROM_FUNCTION(runtime_set_kernel_args_intel_packed);
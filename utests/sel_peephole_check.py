@@ -0,0 +1,90 @@
+#!/usr/bin/python
+#
+# Instruction selection peephole check.
+#
+# Compile the peephole kernels with gbe_bin_generater once with every
+# OCL_SEL_PEEPHOLE_* rule on, then once per rule with only that rule off, and
+# compare the instruction counts. A rule must never add instructions, and it
+# must remove some in the kernel written for it. No GPU is needed.
+#
+# usage: sel_peephole_check.py [options] -- <gbe_bin_generater command>
+#
+import os, sys, subprocess, argparse
+from kernel_stats_check import parse_stats_line, DEFAULT_DEVICES
+
+# Rule and the kernel which must shrink when it is on. DCE only cleans up
+# after the lowering, no kernel is guaranteed to have dead instructions.
+RULES = [('SRCMOD', 'compiler_sel_peephole_srcmod'),
+         ('SATURATE', 'compiler_sel_peephole_saturate'),
+         ('FLAG', 'compiler_sel_peephole_flag'),
+         ('DCE', None)]
+
+def build(generator, kernel, device, disabled):
+  env = dict(os.environ)
+  for rule, target in RULES:
+    env['OCL_SEL_PEEPHOLE_' + rule] = '0' if rule == disabled else '1'
+  cmd = generator + ['-t' + device, '-m', os.path.basename(kernel)]
+  proc = subprocess.Popen(cmd, cwd=os.path.dirname(os.path.abspath(kernel)), env=env,
+                          stdout=subprocess.PIPE, stderr=subprocess.STDOUT)
+  out = proc.communicate()[0].decode('utf-8', 'replace')
+  if proc.returncode != 0:
+    return None, out
+  insns = {}
+  for line in out.splitlines():
+    name, metrics = parse_stats_line(line)
+    if name:
+      insns[name.split(':', 1)[1]] = metrics['insn']
+  return insns, out
+
+def check(generator, kernel, device, verbose):
+  failures = []
+  on, out = build(generator, kernel, device, None)
+  if on is None:
+    sys.stdout.write(out if verbose else '')
+    return ['%s: build failed' % device]
+  for rule, target in RULES:
+    off, out = build(generator, kernel, device, rule)
+    if off is None:
+      sys.stdout.write(out if verbose else '')
+      failures.append('%s %s off: build failed' % (device, rule))
+      continue
+    for name in sorted(on):
+      if name not in off:
+        failures.append('%s %s %s: missing with the rule off' % (device, rule, name))
+        continue
+      if verbose:
+        sys.stdout.write('%s %s %s: insn %d on, %d off\n' %
+                         (device, rule, name, on[name], off[name]))
+      if on[name] > off[name]:
+        failures.append('%s %s %s: insn %d on > %d off' %
+                        (device, rule, name, on[name], off[name]))
+      elif name == target and on[name] == off[name]:
+        failures.append('%s %s %s: insn %d, the rule removed nothing' %
+                        (device, rule, name, on[name]))
+    if target and target not in on:
+      failures.append('%s %s: no kernel %s' % (device, rule, target))
+  return failures
+
+def main():
+  parser = argparse.ArgumentParser(description='instruction selection peephole check')
+  parser.add_argument('--kernel', required=True, help='.cl file of the peephole kernels')
+  parser.add_argument('--devices', default=','.join(DEFAULT_DEVICES),
+                      help='comma separated list of PCI IDs to compile for')
+  parser.add_argument('--verbose', action='store_true')
+  parser.add_argument('generator', nargs=argparse.REMAINDER)
+  args = parser.parse_args()
+
+  generator = [g for g in args.generator if g != '--']
+  if not generator:
+    parser.error('missing gbe_bin_generater command')
+
+  failures = []
+  for device in args.devices.split(','):
+    failures += check(generator, args.kernel, device, args.verbose)
+  for failure in failures:
+    sys.stdout.write('FAIL %s\n' % failure)
+  sys.stdout.write('%d rules checked, %d failures\n' % (len(RULES), len(failures)))
+  return 1 if failures else 0
+
+if __name__ == '__main__':
+  sys.exit(main())